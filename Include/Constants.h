@@ -24,22 +24,45 @@ namespace Constants {
 		static bool USE_ARDUINO = true;
 		static bool USE_RECORDED_ONI = false;
 		static bool USE_IDLE_TIMER = true;
+		static bool RECORD_SESSION = false;	// Record everything into a .dkx session while the app runs, see UserSessionRecorder
+		static const double SANITIZE_REPORT_SECONDS = 60.0;	// How often the replaced NaN / infinite / denormal joint values are printed, only when there are new ones
 	};
 
 	namespace relay {
-		namespace repeater {
-			static float MIN_CUMALTIVE_DELTA_BEFORE_RECORDING = 25.0f;	// At least this much movement has to accumulate while a user is active before we start recording
+		namespace segmenter {
+			static const float ENERGY_SMOOTHING = 0.2f;		// Share of each frame's limb speed blended into the motion energy
+			static const float START_ENERGY = 0.45f;		// Meters per second, idle jitter sits around 0.2
+			static const float STOP_ENERGY = 0.3f;			// Lower than START_ENERGY so a gesture doesn't flicker on and off
+			static const int START_FRAMES = 8;				// Frames above START_ENERGY before a gesture starts
+			static const int STOP_FRAMES = 24;				// Frames below STOP_ENERGY before it ends
+			static const int LEAD_FRAMES = 8;				// Idle frames kept before and after a gesture
+			static const double MIN_SEGMENT_SECONDS = 1.0;	// Shorter gestures are dropped
+			static const double MAX_SEGMENT_SECONDS = 8.0;	// Longer ones are cut off here
+		}
+
+		namespace recorder {
+			static const bool SAVE_AS_BINARY = true;	// Save .dks recordings instead of JSON
+			static const bool COMPRESS_RECORDINGS = true;	// Delta compress .dks recordings, ~50 bytes a frame instead of 416
+			static const size_t WRITER_QUEUE_SIZE = 300;	// Frames buffered for the disk writer thread, 10 seconds at 30fps
+		}
 
-			// Record somewhere between this many frames - arbitary numbers
-			// TODO: instead, stop recording after if delta decreases?
-			static float MIN_FRAMES_TO_RECORD = 50;
-			static float MAX_FRAMES_TO_RECORD = 200;
+		namespace session {
+			static const bool RECORD_DEPTH = true;
+			static const bool RECORD_LABELS = true;
+			static const bool RECORD_RGB = true;
+			static const int DEPTH_FRAME_INTERVAL = 2;			// Depth and labels every other capture, coding a 640x480 depth map takes ~20ms of the writer thread
+			static const double RGB_KEYFRAME_SECONDS = 1.0;		// Color is only there to see what was going on
+			static const size_t WRITER_QUEUE_BYTES = 32 * 1024 * 1024;	// Uncoded bytes waiting for the writer thread, ~50 depth maps
+			static const double MAX_SESSION_SECONDS = 15 * 60;	// Then it continues in a new file, ~55000 chunks and a 1.3MB index each
 		}
 
 		namespace player {
+			static std::string GESTURE_LIBRARY = "gestures.dkl";	// Built by Tools/gesturelibrary, weightedGestures() is used without it
+			static const size_t RECORDING_CACHE_BYTES = 64 * 1024 * 1024;	// Loaded recordings kept around by the UserStreamCache
 			extern std::map<std::string, int>* weightedGestures();
 		}
 
+		static const float RECORDING_FRAME_RATE = 30.0f;				// Nominal Kinect rate, used to time recordings that have no timestamps
 		static const int FRAMES_BEFORE_CONSIDERED_REAL_USER = 10;
 		static const int FRAMES_BEFORE_PLAYING_RECORDING = 8000;
 		static const float CHANCE_OF_PLAYING_RECORDING_WHEN_IDLE = 0.00001f;
@@ -53,6 +76,27 @@ namespace Constants {
 
 	namespace UserTracker {
 		static ci::Vec3f ACTIVATION_ZONE = ci::Vec3f(0.0f, 0.0f, 3.0f);
+
+		// Re-identification - a new user id that matches someone we just lost inherits their state
+		static const int REID_CACHE_SIZE = 8;					// Lost users remembered
+		static const double REID_MAX_SECONDS = 15.0;			// OpenNI takes ~10 seconds to report a lost user
+		static const float REID_MAX_DISTANCE = 0.75f;			// meters on the floor between where they were lost and found
+		static const float REID_MAX_HEIGHT_DIFFERENCE = 0.15f;	// meters
+		static const float REID_MAX_BONE_RATIO_DIFFERENCE = 0.02f;	// mean difference of each bone's share of the total bone length
+	}
+
+	namespace GapFiller {
+		static const float FILL_BELOW_CONFIDENCE = 0.5f;	// Joints under this confidence are reconstructed
+		static const float FILLED_CONFIDENCE = 0.75f;		// Confidence given to a reconstructed joint - passes UserTracker (> 0.5) and WuCinderNITE::renderLimb (>= 0.75),
+															// stays apart from NITE's 0 / 0.5 / 1 and under LEARN_CONFIDENCE so it never teaches a bone length
+		static const float LEARN_CONFIDENCE = 1.0f;			// Both ends of a bone need this much confidence to measure its length
+		static const int BONE_SAMPLES_TO_LEARN = 30;		// Bone lengths are averaged over this many samples then left alone for the rest of the user's life
+		static const int SOLVER_ITERATIONS = 4;				// Fixed number of constraint passes per frame
+		static const int MAX_FRAMES_TO_FILL = 30;			// Give up on a joint that hasn't been seen for this long
+	}
+
+	namespace RoomTransform {
+		static const float FLOOR_SMOOTHING = 0.05f;	// How much of each new floor estimate is blended in per frame
 	}
 
 	namespace Puppeteer {
@@ -0,0 +1,81 @@
+/*
+ * GestureLibrary.h
+ *
+ *  Created on: Oct 23, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Every gesture the relay can play, packed into one file that is mapped once at startup.
+ *
+ *      	[ GESTURE_LIBRARY_HEADER ][ GESTURE_LIBRARY_ENTRY * gestureCount ][ .dks recording ][ .dks recording ] ...
+ *
+ *      	Each entry carries the gesture's name, weight, frame count and duration and the range of its recording,
+ *      	a complete binary recording (see UserStreamBinary.h) that is played in place through a UserStreamMappedSource.
+ *      	Picking a gesture never touches the filesystem. Built by Tools/gesturelibrary.
+ */
+
+#ifndef GESTURELIBRARY_H_
+#define GESTURELIBRARY_H_
+
+#include "IUserStreamSource.h"
+#include "MappedFile.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace relay {
+	static const char GESTURE_LIBRARY_MAGIC[4] = { 'D', 'K', 'G', 'L' };
+	static const uint16_t GESTURE_LIBRARY_VERSION = 1;
+	static const size_t GESTURE_LIBRARY_MAX_NAME = 64;
+
+	struct GESTURE_LIBRARY_HEADER {
+		char		magic[4];
+		uint16_t	version;
+		uint16_t	reserved;
+		uint32_t	gestureCount;
+		uint32_t	reserved2;
+		uint64_t	entriesOffset;
+	};
+
+	struct GESTURE_LIBRARY_ENTRY {
+		char		name[GESTURE_LIBRARY_MAX_NAME];	// Null terminated, the json file name the gesture was built from
+		uint32_t	weight;				// Relative chance of being picked
+		uint32_t	frameCount;
+		double		duration;
+		uint64_t	offset;				// Recording, from the start of the library
+		uint64_t	length;
+	};
+
+	struct GESTURE_INFO {
+		std::string name;
+		int weight;
+		uint32_t frameCount;
+		double duration;
+	};
+
+	class GestureLibrary {
+	public:
+		static GestureLibrary* getInstance();
+
+		bool load( const std::string &aPath );	// Maps the library and validates every recording in it
+		bool isLoaded() { return _file.get() != NULL; };
+
+		size_t getGestureCount() { return _gestures.size(); };
+		const GESTURE_INFO& getGestureInfo( size_t index ) { return _gestures[index]; };
+
+		// A fresh playback source over the mapped recording, empty if there is no gesture with that name
+		IUserStreamSource_ptr getGesture( const std::string &aName );
+
+		// Packs existing .dks recordings into a library
+		static bool write( const std::string &aPath, const std::vector<GESTURE_INFO> &gestures, const std::vector<std::string> &recordingPaths );
+
+	private:
+		GestureLibrary();
+		static GestureLibrary* mInstance;
+
+		MappedFile_ptr _file;
+		std::vector<GESTURE_INFO> _gestures;
+		std::vector<GESTURE_LIBRARY_ENTRY> _entries;
+	};
+}
+
+#endif /* GESTURELIBRARY_H_ */
@@ -26,6 +26,7 @@ namespace relay {
 		virtual void exit() = 0;
 		virtual void draw() = 0;
 		virtual bool wantsToExit() = 0;
+		virtual const char* getName() = 0;	// Shows up in session recordings when the state is entered
 		virtual SKELETON::SKELETON getSkeleton() = 0;
 
 	protected:
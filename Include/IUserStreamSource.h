@@ -0,0 +1,32 @@
+/*
+ * IUserStreamSource.h
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Random access to the frames of a recording, the UserStreamPlayer reads through one of these.
+ *      	Frames are decoded into a caller owned UserStreamFrame so a source never hands out per frame heap objects.
+ */
+
+#ifndef IUSERSTREAMSOURCE_H_
+#define IUSERSTREAMSOURCE_H_
+
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+
+namespace relay {
+	class UserStreamFrame;
+
+	class IUserStreamSource {
+	public:
+		virtual ~IUserStreamSource(){};
+
+		virtual uint32_t getFrameCount() = 0;
+		virtual double getDuration() = 0;
+		virtual bool getFrame( uint32_t index, UserStreamFrame &frame ) = 0;
+	};
+}
+
+typedef boost::shared_ptr<relay::IUserStreamSource> IUserStreamSource_ptr;
+
+#endif /* IUSERSTREAMSOURCE_H_ */
@@ -0,0 +1,40 @@
+/*
+ * MappedFile.h
+ *
+ *  Created on: Oct 23, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Read only memory mapping of a whole file, unmapped when the last shared pointer to it goes away.
+ *      	Recordings and the gesture library hand out views into one of these instead of copying.
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <boost/shared_ptr.hpp>
+#include <cstddef>
+#include <string>
+
+class MappedFile;
+typedef boost::shared_ptr<MappedFile> MappedFile_ptr;
+
+class MappedFile {
+public:
+	virtual ~MappedFile();
+
+	// Returns an empty pointer if the file can not be opened or mapped
+	static MappedFile_ptr open( const std::string &aPath );
+
+	const char* getData() { return _data; };
+	size_t getSize() { return _size; };
+	const std::string& getPath() { return _path; };
+
+private:
+	MappedFile();
+
+	const char* _data;
+	size_t _size;
+	std::string _path;
+};
+
+#endif /* MAPPEDFILE_H_ */
@@ -6,6 +6,7 @@
 #include "cinder/Matrix33.h"
 #include "cinder/Matrix44.h"
 #include "SkeletonStruct.h"
+#include "SkeletonJointSet.h"
 
 #include "ArduinoCommandInterface.h"
 
@@ -16,6 +17,15 @@ public:
 	Puppeteer();
 	virtual ~Puppeteer();
 
+	// Joints read by update()
+	typedef SKELETON::JointSet<
+		JOINT_BIT(XN_SKEL_NECK) | JOINT_BIT(XN_SKEL_TORSO) |
+		JOINT_BIT(XN_SKEL_LEFT_SHOULDER) | JOINT_BIT(XN_SKEL_LEFT_ELBOW) | JOINT_BIT(XN_SKEL_LEFT_HAND) |
+		JOINT_BIT(XN_SKEL_RIGHT_SHOULDER) | JOINT_BIT(XN_SKEL_RIGHT_ELBOW) | JOINT_BIT(XN_SKEL_RIGHT_HAND) |
+		JOINT_BIT(XN_SKEL_LEFT_HIP) | JOINT_BIT(XN_SKEL_LEFT_KNEE) |
+		JOINT_BIT(XN_SKEL_RIGHT_HIP) | JOINT_BIT(XN_SKEL_RIGHT_KNEE)
+	> PuppeteerJoints;
+
 	void update(SKELETON::SKELETON& skeleton);
 	void draw();
 private:
@@ -44,5 +54,7 @@ private:
 	int mUserNoneFrames;
 };
 
+ASSERT_JOINTS_ARE_CAPTURED(Puppeteer::PuppeteerJoints);
+
 } /* namespace puppetier */
 #endif /* PUPPETIER_H_ */
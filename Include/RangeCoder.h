@@ -0,0 +1,196 @@
+/*
+ * RangeCoder.h
+ *
+ *  Created on: Oct 22, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Small adaptive binary range coder (the LZMA flavour) used to entropy code recordings.
+ *      	Every bit is coded against an 11 bit probability that adapts as it is used, integers are binarized
+ *      	with a bit tree over their bit length followed by raw low bits - see RangeIntegerModel.
+ */
+
+#ifndef RANGECODER_H_
+#define RANGECODER_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace relay {
+	static const int RANGE_PROBABILITY_BITS = 11;
+	static const uint16_t RANGE_PROBABILITY_ONE = 1 << RANGE_PROBABILITY_BITS;
+	static const uint16_t RANGE_PROBABILITY_HALF = RANGE_PROBABILITY_ONE / 2;
+	static const int RANGE_ADAPT_SHIFT = 5;
+	static const uint32_t RANGE_TOP = 1 << 24;
+
+	class RangeEncoder {
+	public:
+		RangeEncoder( std::vector<uint8_t> &aOutput ) : _output( aOutput ) {
+			_low = 0;
+			_range = 0xFFFFFFFF;
+			_cache = 0;
+			_cacheSize = 1;
+		}
+
+		inline void encodeBit( uint16_t &probability, int bit ) {
+			uint32_t bound = ( _range >> RANGE_PROBABILITY_BITS ) * probability;
+			if( bit == 0 ) {
+				_range = bound;
+				probability += ( RANGE_PROBABILITY_ONE - probability ) >> RANGE_ADAPT_SHIFT;
+			} else {
+				_low += bound;
+				_range -= bound;
+				probability -= probability >> RANGE_ADAPT_SHIFT;
+			}
+			while( _range < RANGE_TOP ) {
+				_range <<= 8;
+				shiftLow();
+			}
+		}
+
+		inline void encodeDirectBits( uint32_t value, int count ) {
+			while( count-- > 0 ) {
+				_range >>= 1;
+				if( ( value >> count ) & 1 ) _low += _range;
+				while( _range < RANGE_TOP ) {
+					_range <<= 8;
+					shiftLow();
+				}
+			}
+		}
+
+		void flush() {
+			for( int i = 0; i < 5; ++i ) shiftLow();
+		}
+
+	private:
+		inline void shiftLow() {
+			if( (uint32_t)_low < 0xFF000000 || ( _low >> 32 ) != 0 ) {
+				uint8_t carry = (uint8_t)( _low >> 32 );
+				uint8_t temp = _cache;
+				do {
+					_output.push_back( (uint8_t)( temp + carry ) );
+					temp = 0xFF;
+				} while( --_cacheSize != 0 );
+				_cache = (uint8_t)( _low >> 24 );
+			}
+			_cacheSize++;
+			_low = ( _low & 0x00FFFFFF ) << 8;
+		}
+
+		std::vector<uint8_t> &_output;
+		uint64_t _low;
+		uint32_t _range;
+		uint8_t _cache;
+		uint64_t _cacheSize;
+	};
+
+	class RangeDecoder {
+	public:
+		RangeDecoder( const uint8_t *aData, size_t aLength ) {
+			_current = aData;
+			_end = aData + aLength;
+			_range = 0xFFFFFFFF;
+			_code = 0;
+			for( int i = 0; i < 5; ++i ) _code = ( _code << 8 ) | nextByte();
+		}
+
+		inline int decodeBit( uint16_t &probability ) {
+			uint32_t bound = ( _range >> RANGE_PROBABILITY_BITS ) * probability;
+			int bit;
+			if( _code < bound ) {
+				_range = bound;
+				probability += ( RANGE_PROBABILITY_ONE - probability ) >> RANGE_ADAPT_SHIFT;
+				bit = 0;
+			} else {
+				_code -= bound;
+				_range -= bound;
+				probability -= probability >> RANGE_ADAPT_SHIFT;
+				bit = 1;
+			}
+			if( _range < RANGE_TOP ) {
+				_range <<= 8;
+				_code = ( _code << 8 ) | nextByte();
+			}
+			return bit;
+		}
+
+		inline uint32_t decodeDirectBits( int count ) {
+			uint32_t value = 0;
+			while( count-- > 0 ) {
+				_range >>= 1;
+				uint32_t bit = _code >= _range ? 1 : 0;
+				if( bit ) _code -= _range;
+				value = ( value << 1 ) | bit;
+				if( _range < RANGE_TOP ) {
+					_range <<= 8;
+					_code = ( _code << 8 ) | nextByte();
+				}
+			}
+			return value;
+		}
+
+		// True if the decoder read past the end of its input, the data was truncated or corrupt
+		bool isOverrun() { return _current > _end; };
+
+	private:
+		inline uint8_t nextByte() {
+			// Past the end reads zeros, isOverrun() reports it
+			return _current < _end ? *_current++ : ( ++_current, 0 );
+		}
+
+		const uint8_t *_current;
+		const uint8_t *_end;
+		uint32_t _range;
+		uint32_t _code;
+	};
+
+	/**
+	 * Adaptive model for signed integers. The zigzagged value is split into its bit length,
+	 * coded with a bit tree so small residuals cost a fraction of a bit, and the bits below the leading one sent raw.
+	 */
+	class RangeIntegerModel {
+	public:
+		RangeIntegerModel() { reset(); };
+
+		void reset() {
+			for( int i = 0; i < TREE_SIZE; ++i ) _lengthTree[i] = RANGE_PROBABILITY_HALF;
+		}
+
+		inline void encode( RangeEncoder &encoder, int32_t value ) {
+			uint32_t zigzag = ( (uint32_t)value << 1 ) ^ (uint32_t)( value >> 31 );
+			int length = 0;
+			while( length < 32 && ( zigzag >> length ) != 0 ) ++length;
+
+			int node = 1;
+			for( int i = LENGTH_BITS - 1; i >= 0; --i ) {
+				int bit = ( length >> i ) & 1;
+				encoder.encodeBit( _lengthTree[node], bit );
+				node = ( node << 1 ) | bit;
+			}
+			if( length > 1 ) encoder.encodeDirectBits( zigzag, length - 1 );
+		}
+
+		inline int32_t decode( RangeDecoder &decoder ) {
+			int node = 1;
+			for( int i = 0; i < LENGTH_BITS; ++i ) {
+				node = ( node << 1 ) | decoder.decodeBit( _lengthTree[node] );
+			}
+			int length = node - TREE_SIZE;
+			if( length > 32 ) length = 32;	// Only corrupt data gets here
+
+			uint32_t zigzag = 0;
+			if( length == 1 ) zigzag = 1;
+			else if( length > 1 ) zigzag = ( 1u << ( length - 1 ) ) | decoder.decodeDirectBits( length - 1 );
+
+			return (int32_t)( zigzag >> 1 ) ^ -(int32_t)( zigzag & 1 );
+		}
+
+	private:
+		static const int LENGTH_BITS = 6;	// Bit lengths 0-32
+		static const int TREE_SIZE = 1 << LENGTH_BITS;
+		uint16_t _lengthTree[TREE_SIZE];
+	};
+}
+
+#endif /* RANGECODER_H_ */
@@ -0,0 +1,24 @@
+/*
+ * SkeletonBlend.h
+ *
+ *  Created on: Oct 26, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Interpolates between two skeletons, used to play recordings back at any frame rate.
+ *      	The torso is lerped, every other tracked joint is placed from its parent along a normalized blend
+ *      	of the two bone directions with a lerped bone length - so limbs swing instead of shrinking through
+ *      	each other on fast moves. Joints only confident in one of the skeletons are taken from that one.
+ */
+
+#pragma once
+#ifndef SKELETONBLEND_H_
+#define SKELETONBLEND_H_
+
+#include "SkeletonStruct.h"
+
+namespace SKELETON {
+	// 'amount' of 0 is 'from', 1 is 'to'
+	void blend( const SKELETON &from, const SKELETON &to, float amount, SKELETON &result );
+}
+
+#endif /* SKELETONBLEND_H_ */
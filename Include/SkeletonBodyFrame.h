@@ -0,0 +1,42 @@
+/*
+ * SkeletonBodyFrame.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Orthonormal frame attached to a user's upper body, built directly from the shoulders, neck and torso
+ *      	with cross products.
+ *      	The spine is kept exactly, the shoulder line is made perpendicular to it.
+ *      	computeBodyFrames() does every user at once, four at a time in SSE registers, WuCinderNITE keeps
+ *      	the result next to its skeletons so any consumer of the live users can read body relative positions.
+ *      	Puppeteer builds its own frame, its skeleton may come from playback rather than the live users.
+ */
+
+#pragma once
+#ifndef SKELETONBODYFRAME_H_
+#define SKELETONBODYFRAME_H_
+
+#include "cinder/Vector.h"
+#include "SkeletonStruct.h"
+
+namespace SKELETON {
+	struct BODY_FRAME {
+		BODY_FRAME():isValid(false){};
+		bool isValid;			// false if the skeleton was not tracked or the joints were degenerate
+		ci::Vec3f origin;		// torso
+		ci::Vec3f axisHoriz;	// right shoulder towards left shoulder, made perpendicular to axisVert
+		ci::Vec3f axisVert;		// torso towards neck
+		ci::Vec3f normal;		// axisHoriz x axisVert, the direction the chest faces
+
+		// Rotates a vector into body space: x points out of the right side, y up the spine, z out of the back
+		// (the frame Puppeteer used to build from a quaternion and two rotation matrices)
+		ci::Vec3f toBody( const ci::Vec3f &v ) const {
+			return ci::Vec3f( -axisHoriz.dot( v ), axisVert.dot( v ), -normal.dot( v ) );
+		}
+	};
+
+	void computeBodyFrame( const SKELETON &skeleton, BODY_FRAME &frame );
+	void computeBodyFrames( const SKELETON *skeletons, BODY_FRAME *frames, int count );
+}
+
+#endif /* SKELETONBODYFRAME_H_ */
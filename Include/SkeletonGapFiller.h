@@ -0,0 +1,51 @@
+/*
+ * SkeletonGapFiller.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Reconstructs missing or low confidence joints for a single tracked user.
+ *      	Bone lengths are learned once per user from confident frames, a missing joint is then
+ *      	carried along with its confident neighbours from where it was last frame and pulled back onto
+ *      	its learned bone lengths by a small fixed-iteration constraint solver.
+ *      	WuCinderNITE runs one of these per user slot so everything downstream sees continuous data.
+ *      	Reconstructed joints get Constants::GapFiller::FILLED_CONFIDENCE, which UserTracker, the skeleton
+ *      	debug draw, Puppeteer, blending and the recorders all accept like a confident joint.
+ */
+
+#pragma once
+#ifndef SKELETONGAPFILLER_H_
+#define SKELETONGAPFILLER_H_
+
+#include "cinder/Vector.h"
+#include "SkeletonStruct.h"
+
+class SkeletonGapFiller {
+public:
+	static const int NUM_BONES = 16;
+	static const int BONES[NUM_BONES][2];	// Pairs of XnSkeletonJoint connected by a bone
+
+	SkeletonGapFiller();
+
+	void reset();	// Forget the learned bone lengths and history, call when the user slot changes hands
+	void process( SKELETON::SKELETON &skeleton );	// Fills in low confidence joints in place
+
+	bool hasLearnedBones() const;
+	float getBoneLength( int bone ) const { return _boneLength[bone]; };
+	int getBoneSamples( int bone ) const { return _boneSamples[bone]; };
+	int getFilledJointCount() const { return _filledJoints; };
+
+private:
+	void learnBoneLengths( const SKELETON::SKELETON &skeleton );
+	void solveConstraints( SKELETON::SKELETON &skeleton, const bool *isFilled );
+
+	float		_boneLength[NUM_BONES];
+	int			_boneSamples[NUM_BONES];
+
+	bool		_hasHistory;
+	ci::Vec3f	_lastPosition[SKELETON::MAX_JOINTS];		// Output of the previous frame
+	int			_framesSinceConfident[SKELETON::MAX_JOINTS];
+	int			_filledJoints;								// Number of joints filled in on the last call to process
+};
+
+#endif /* SKELETONGAPFILLER_H_ */
@@ -0,0 +1,97 @@
+/*
+ * SkeletonJointSet.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Compile-time joint subsets.
+ *      	Each consumer of skeleton data only reads a handful of the MAX_JOINTS joints,
+ *      	a JointSet lets it declare which ones as a bitmask so copies and loops over the skeleton
+ *      	are unrolled by the compiler and only ever touch those joints.
+ *
+ *      	typedef SKELETON::JointSet< JOINT_BIT(XN_SKEL_HEAD) | JOINT_BIT(XN_SKEL_NECK) > HeadJoints;
+ *      	HeadJoints::copy( source, destination );
+ */
+
+#pragma once
+#ifndef SKELETONJOINTSET_H_
+#define SKELETONJOINTSET_H_
+
+#include "SkeletonStruct.h"
+#include <XnTypes.h>
+#include <boost/static_assert.hpp>
+
+#define JOINT_BIT(__JOINT__) (1u << (__JOINT__))
+
+namespace SKELETON {
+	namespace detail {
+		// Walks every joint index at compile time, the 'if' is on a constant so it disappears
+		template<unsigned int MASK, int JOINT>
+		struct JointLoop {
+			template<class VISITOR>
+			static inline void visit( VISITOR &visitor ) {
+				if( MASK & JOINT_BIT(JOINT) ) visitor( JOINT );
+				JointLoop<MASK, JOINT + 1>::visit( visitor );
+			}
+
+			static inline void copy( const SKELETON &source, SKELETON &destination ) {
+				if( MASK & JOINT_BIT(JOINT) ) destination.joints[JOINT] = source.joints[JOINT];
+				JointLoop<MASK, JOINT + 1>::copy( source, destination );
+			}
+
+			static inline void clearConfidence( SKELETON &skeleton ) {
+				if( MASK & JOINT_BIT(JOINT) ) skeleton.joints[JOINT].confidence = 0;
+				JointLoop<MASK, JOINT + 1>::clearConfidence( skeleton );
+			}
+		};
+
+		template<unsigned int MASK>
+		struct JointLoop<MASK, MAX_JOINTS> {
+			template<class VISITOR> static inline void visit( VISITOR & ) {}
+			static inline void copy( const SKELETON &, SKELETON & ) {}
+			static inline void clearConfidence( SKELETON & ) {}
+		};
+
+		template<unsigned int MASK>
+		struct BitCount { enum { value = (MASK & 1) + BitCount<(MASK >> 1)>::value }; };
+		template<>
+		struct BitCount<0> { enum { value = 0 }; };
+	}
+
+	template<unsigned int MASK>
+	struct JointSet {
+		enum {
+			mask = MASK,
+			count = detail::BitCount<MASK>::value
+		};
+
+		static inline bool contains( int joint ) { return ( MASK & JOINT_BIT(joint) ) != 0; }
+
+		// Calls visitor( jointIndex ) for every joint in the set
+		template<class VISITOR>
+		static inline void visit( VISITOR &visitor ) { detail::JointLoop<MASK, 0>::visit( visitor ); }
+
+		// Copies the tracking flag and only the joints in this set, the rest of 'destination' is left untouched
+		static inline void copy( const SKELETON &source, SKELETON &destination ) {
+			destination.isTracking = source.isTracking;
+			detail::JointLoop<MASK, 0>::copy( source, destination );
+		}
+
+		static inline void clearConfidence( SKELETON &skeleton ) { detail::JointLoop<MASK, 0>::clearConfidence( skeleton ); }
+	};
+
+	// The 15 joints NITE actually tracks - waist, collars, wrists, fingertips and ankles never receive data
+	typedef JointSet<
+		JOINT_BIT(XN_SKEL_HEAD) | JOINT_BIT(XN_SKEL_NECK) | JOINT_BIT(XN_SKEL_TORSO) |
+		JOINT_BIT(XN_SKEL_LEFT_SHOULDER) | JOINT_BIT(XN_SKEL_LEFT_ELBOW) | JOINT_BIT(XN_SKEL_LEFT_HAND) |
+		JOINT_BIT(XN_SKEL_RIGHT_SHOULDER) | JOINT_BIT(XN_SKEL_RIGHT_ELBOW) | JOINT_BIT(XN_SKEL_RIGHT_HAND) |
+		JOINT_BIT(XN_SKEL_LEFT_HIP) | JOINT_BIT(XN_SKEL_LEFT_KNEE) | JOINT_BIT(XN_SKEL_LEFT_FOOT) |
+		JOINT_BIT(XN_SKEL_RIGHT_HIP) | JOINT_BIT(XN_SKEL_RIGHT_KNEE) | JOINT_BIT(XN_SKEL_RIGHT_FOOT)
+	> NiteJoints;
+}
+
+// Consumers declare their own JointSet next to the code that uses it, and use this to make sure the capture covers it
+#define ASSERT_JOINTS_ARE_CAPTURED(__JOINTSET__) \
+	BOOST_STATIC_ASSERT( ( (unsigned int)__JOINTSET__::mask & ~(unsigned int)SKELETON::NiteJoints::mask ) == 0 )
+
+#endif /* SKELETONJOINTSET_H_ */
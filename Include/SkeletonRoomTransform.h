@@ -0,0 +1,50 @@
+/*
+ * SkeletonRoomTransform.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Floor aligned ("room") coordinate frame.
+ *      	Once per frame setFloor() builds a frame from the floor plane the SceneAnalyzer reports:
+ *      	the origin sits on the floor, y points up against gravity and z is the camera's view direction
+ *      	flattened onto the floor. transform() then moves every skeleton into it in a single SSE pass.
+ *      	Until a floor has been seen the room frame is the camera frame.
+ */
+
+#pragma once
+#ifndef SKELETONROOMTRANSFORM_H_
+#define SKELETONROOMTRANSFORM_H_
+
+#include "cinder/Vector.h"
+#include "SkeletonStruct.h"
+#include <XnTypes.h>
+
+class SkeletonRoomTransform {
+public:
+	SkeletonRoomTransform();
+
+	void setFloor( const XnPlane3D &floor );	// Floor plane in millimeters as returned by xn::SceneAnalyzer::GetFloor
+	void transform( const SKELETON::SKELETON *source, SKELETON::SKELETON *destination, int count ) const;
+
+	ci::Vec3f toRoom( const ci::Vec3f &position ) const;
+
+	bool hasFloor() const { return _hasFloor; };
+	const ci::Vec3f& getOrigin() const { return _origin; };
+	const ci::Vec3f& getUp() const { return _axis[1]; };
+
+private:
+	void updateMatrix();
+
+	bool		_hasFloor;
+	ci::Vec3f	_floorNormal;	// Smoothed floor plane, in meters
+	ci::Vec3f	_floorPoint;
+
+	ci::Vec3f	_origin;
+	ci::Vec3f	_axis[3];		// Room x, y, z expressed in camera space
+
+	// Columns of the 4x4 matrix that maps a ( confidence, x, y, z ) joint to ( confidence, x', y', z' )
+	float		_columns[4][4];
+	float		_translation[4];
+};
+
+#endif /* SKELETONROOMTRANSFORM_H_ */
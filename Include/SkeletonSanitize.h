@@ -0,0 +1,52 @@
+/*
+ * SkeletonSanitize.h
+ *
+ *  Created on: Oct 26, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Keeps NaN, infinite and denormal floats out of the skeletons.
+ *      	NITE occasionally reports NaN positions, and older recordings carry denormals like the 2.08e-41 in
+ *      	wave.json - a NaN poisons every sum it reaches and each denormal operand costs a microcode assist.
+ *      	sanitize() replaces them with 0, a joint per SSE register, at every point skeletons enter the app:
+ *      	capture (WuCinderNITE), decode (UserStreamMemorySource, UserStreamMappedSource, UserStreamJSONSource,
+ *      	UserSessionReader) and playback (UserStreamPlayer). What was replaced is counted per boundary,
+ *      	DisKinect prints the counts whenever they have grown.
+ *
+ *      	enableFlushToZero() makes the calling thread's own float math flush denormal results and operands to zero,
+ *      	the capture and loader threads turn it on when they start, the main thread in DisKinect::setup.
+ */
+
+#pragma once
+#ifndef SKELETONSANITIZE_H_
+#define SKELETONSANITIZE_H_
+
+#include "SkeletonStruct.h"
+
+namespace SKELETON {
+	enum SANITIZE_BOUNDARY {
+		SANITIZE_CAPTURE = 0,
+		SANITIZE_DECODE,
+		SANITIZE_PLAYBACK,
+		SANITIZE_BOUNDARY_COUNT
+	};
+
+	struct SANITIZE_STATS {
+		SANITIZE_STATS():skeletons(0),nans(0),infinities(0),denormals(0){};
+		unsigned long skeletons;	// Skeletons that had at least one value replaced
+		unsigned long nans;
+		unsigned long infinities;
+		unsigned long denormals;
+	};
+
+	// Zeroes every NaN, infinite or denormal confidence and position, returns how many values were replaced
+	int sanitize( SKELETON &skeleton, SANITIZE_BOUNDARY boundary );
+
+	// Totals since the app started, safe to call from any thread
+	SANITIZE_STATS getSanitizeStats( SANITIZE_BOUNDARY boundary );
+	const char* getSanitizeBoundaryName( SANITIZE_BOUNDARY boundary );
+
+	// Sets flush-to-zero and denormals-are-zero in the calling thread's MXCSR, does nothing without SSE
+	void enableFlushToZero();
+}
+
+#endif /* SKELETONSANITIZE_H_ */
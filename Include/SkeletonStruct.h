@@ -5,6 +5,8 @@
 
 #include "cinder/Vector.h"
 namespace SKELETON {
+	static const int MAX_JOINTS = 25;
+
 	struct SKELETON_JOINT {
 			SKELETON_JOINT():confidence(0.0){};
 			float confidence;
@@ -12,7 +14,7 @@ namespace SKELETON {
 	};
 	struct SKELETON {
 			bool isTracking;
-			SKELETON_JOINT joints[25];
+			SKELETON_JOINT joints[MAX_JOINTS];
 	};
 }
 #endif /* SKELETONSTRUCT_H_ */
@@ -16,6 +16,7 @@
 #define USERRELAY_H_
 
 #include "UserStreamStateManager.h"
+#include "UserStreamLoader.h"
 #include "cinder/Vector.h"
 #include "json/json.h"
 #include "cinder/app/MouseEvent.h"
@@ -55,6 +56,14 @@ namespace relay {
 		std::vector<std::string> gestures;
 		std::string getRandomGesture();
 
+		// Recordings are loaded in the background, the current state keeps running until they are ready
+		UserStreamLoad_ptr _pendingPlayback;	// Played as soon as it is ready
+		bool _isPendingFromIdleTimer;			// Queued by the idle timer rather than asked for, it gives way to an active user
+		UserStreamLoad_ptr _nextGesture;		// Prefetched while the current one plays
+		void prefetchNextGesture();
+		void playNextGesture( bool isFromIdleTimer );
+		void updatePendingPlayback();
+
 		// Debug
 		mowa::sgui::SimpleGUI* _debugGUI;
 
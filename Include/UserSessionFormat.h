@@ -0,0 +1,125 @@
+/*
+ * UserSessionFormat.h
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Multi-track session container (.dkx), everything needed to reproduce what the installation saw on one timeline:
+ *      	skeleton frames, depth and label maps, RGB keyframes and tracker / relay events.
+ *
+ *      	[ USER_SESSION_HEADER ][ chunk 0 ][ chunk 1 ] ... [ chunk N-1 ][ USER_SESSION_INDEX_ENTRY * indexCount ]
+ *
+ *      	Every chunk is a USER_SESSION_CHUNK_HEADER followed by 'length' bytes of payload, in the order they were captured,
+ *      	so timestamps only ever grow within a track. The footer index repeats each chunk header with its offset and is
+ *      	written when the session is closed, a session that was never closed (the app crashed, which is usually why
+ *      	we want it) is recovered by walking the chunk headers until one is cut short. All values are little endian.
+ *
+ *      	Payloads by track:
+ *      		USER_SESSION_TRACK_SKELETON	Every user tracked in one capture, each a USER_SESSION_SKELETON_HEADER then a .dks frame record
+ *      									(UserStreamBinary::encodeFrame) of the header's jointCount - no users means nobody was tracked
+ *      									from then on, captures where nobody is tracked are not written
+ *      		USER_SESSION_TRACK_DEPTH	USER_SESSION_IMAGE_HEADER then 16 bit millimeters
+ *      		USER_SESSION_TRACK_LABELS	USER_SESSION_IMAGE_HEADER then 16 bit NITE user ids, 0 is background
+ *      		USER_SESSION_TRACK_RGB		USER_SESSION_IMAGE_HEADER then 8 bit RGB, as the sensor delivers it (not mirrored)
+ *      		USER_SESSION_TRACK_EVENTS	UTF-8 text, 'codec' is the UserSessionEvent and 'user' the user it is about
+ *
+ *      	Images are coded with 'codec':
+ *      		USER_SESSION_CODEC_RAW		Pixels as they are
+ *      		USER_SESSION_CODEC_PREDICT	Each channel predicted from its left, top and top left neighbours (the LOCO-I median predictor),
+ *      									the residuals range coded - lossless, depth ends up around a quarter of its size
+ *      		USER_SESSION_CODEC_RUNS		Runs of equal pixels, range coded run lengths and values - label maps are almost all background
+ */
+
+#ifndef USERSESSIONFORMAT_H_
+#define USERSESSIONFORMAT_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace relay {
+	static const char USER_SESSION_MAGIC[4] = { 'D', 'K', 'S', 'X' };
+	static const uint16_t USER_SESSION_VERSION = 1;
+	static const char* const USER_SESSION_EXTENSION = ".dkx";
+
+	enum UserSessionTrack {
+		USER_SESSION_TRACK_SKELETON = 0,
+		USER_SESSION_TRACK_DEPTH,
+		USER_SESSION_TRACK_LABELS,
+		USER_SESSION_TRACK_RGB,
+		USER_SESSION_TRACK_EVENTS,
+		USER_SESSION_TRACK_COUNT
+	};
+
+	enum UserSessionCodec {
+		USER_SESSION_CODEC_RAW = 0,
+		USER_SESSION_CODEC_PREDICT = 1,
+		USER_SESSION_CODEC_RUNS = 2
+	};
+
+	enum UserSessionEvent {
+		USER_SESSION_EVENT_NEW_USER = 0,		// NITE found a user
+		USER_SESSION_EVENT_LOST_USER,			// NITE gave up on a user
+		USER_SESSION_EVENT_CALIBRATION,			// Text is "success" or "failed"
+		USER_SESSION_EVENT_STATE_CHANGE,		// Text is the name of the IUserStream entered
+		USER_SESSION_EVENT_SERIAL_MESSAGE,		// Text is what was written to the arduino
+		USER_SESSION_EVENT_MARKER				// Anything else worth finding on the timeline
+	};
+
+	struct USER_SESSION_HEADER {
+		char		magic[4];
+		uint16_t	version;
+		uint16_t	jointCount;		// Joints in each skeleton record
+		double		startTime;		// Seconds since 1970 when the session started, chunk timestamps are relative to it
+		uint64_t	indexOffset;	// Footer index, 0 if the session was never closed
+		uint32_t	indexCount;
+		uint8_t		reserved[4];
+	};
+
+	struct USER_SESSION_CHUNK_HEADER {
+		uint8_t		track;			// UserSessionTrack
+		uint8_t		codec;			// UserSessionCodec, or the UserSessionEvent of an event
+		uint16_t	user;			// NITE user id, 0 if the chunk is not about one user
+		uint32_t	length;			// Payload bytes after this header
+		double		timestamp;		// Seconds since the session started
+	};
+
+	struct USER_SESSION_INDEX_ENTRY {
+		USER_SESSION_CHUNK_HEADER chunk;
+		uint64_t	offset;			// Of the chunk header, from the start of the file
+	};
+
+	struct USER_SESSION_SKELETON_HEADER {
+		uint16_t	user;			// NITE user id
+		uint8_t		reserved[6];
+	};
+
+	struct USER_SESSION_IMAGE_HEADER {
+		uint16_t	width;
+		uint16_t	height;
+		uint8_t		channels;
+		uint8_t		bytesPerChannel;	// 1 or 2
+		uint8_t		reserved[2];
+	};
+
+	namespace UserSessionFormat {
+		bool isValidHeader( const USER_SESSION_HEADER &header, uint64_t fileSize );	// The index is checked when it is read, a bad one is recovered
+		const char* getTrackName( UserSessionTrack track );
+		const char* getEventName( UserSessionEvent event );
+
+		// Bytes of one user in a skeleton chunk
+		size_t getSkeletonStride( uint16_t jointCount );
+
+		// Bytes an image of this shape takes uncoded
+		size_t getImageSize( const USER_SESSION_IMAGE_HEADER &image );
+
+		// Appends the coded pixels to 'output', returns the codec actually used - RAW when coding would not make it smaller.
+		// 'pixels' are rows of width * channels values of bytesPerChannel bytes
+		UserSessionCodec encodeImage( const USER_SESSION_IMAGE_HEADER &image, const void *pixels, UserSessionCodec codec, std::vector<uint8_t> &output );
+
+		// 'pixels' must have getImageSize() bytes, returns false if the data is truncated or corrupt
+		bool decodeImage( const USER_SESSION_IMAGE_HEADER &image, UserSessionCodec codec, const uint8_t *data, size_t length, void *pixels );
+	}
+}
+
+#endif /* USERSESSIONFORMAT_H_ */
@@ -0,0 +1,68 @@
+/*
+ * UserSessionPlayback.h
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Plays every track of a session (.dkx) against a single playhead.
+ *      	Each track is shown as its last chunk at or before the playhead, so a depth map recorded every other frame or
+ *      	an RGB keyframe from a second ago lines up with the skeletons captured with it, the way they were seen live.
+ *      	Chunks are only decoded when a track is asked for, and only once until the playhead moves onto another chunk.
+ *      	advance() fires signalEvent for every event the playhead passes, in order, seek() jumps without firing any.
+ */
+
+#ifndef USERSESSIONPLAYBACK_H_
+#define USERSESSIONPLAYBACK_H_
+
+#include "UserSessionReader.h"
+#include <boost/signals2.hpp>
+#include <string>
+#include <vector>
+
+namespace SKELETON { struct SKELETON; }
+
+namespace relay {
+	class UserSessionPlayback {
+	public:
+		typedef boost::signals2::signal<void (const USER_SESSION_CHUNK_HEADER&, const std::string&)> UserSessionSignalEvent;
+
+		UserSessionPlayback( UserSessionReader_ptr aReader );	// Starts at 0, events at 0 fire on the first advance()
+		virtual ~UserSessionPlayback();
+
+		void seek( double time );
+		void advance( double seconds );
+
+		double getTime() { return _time; };
+		double getDuration() { return _reader->getDuration(); };
+		bool isDone() { return _time >= _reader->getDuration(); };
+		UserSessionReader_ptr getReader() { return _reader; };
+
+		// Each track at the playhead, empty or NULL before its first chunk or if the chunk is corrupt
+		const std::vector<USER_SESSION_SKELETON>& getSkeletons();
+		bool getSkeleton( uint16_t user, SKELETON::SKELETON &skeleton );
+		const uint8_t* getImage( UserSessionTrack track, USER_SESSION_IMAGE_HEADER &image );	// 16 bit values for depth and labels
+		double getChunkTime( UserSessionTrack track );	// When the chunk at the playhead was captured, -1 before the first
+		bool isCorrupt( UserSessionTrack track );		// The chunk at the playhead failed to decode
+
+		UserSessionSignalEvent signalEvent;
+
+	private:
+		struct TRACK_CURSOR {
+			int chunk;			// Into UserSessionReader::getChunks(), -1 before the first
+			int decodedChunk;	// What 'pixels' or _skeletons hold, -1 for nothing
+			bool isDecoded;		// False if decoding 'decodedChunk' failed
+			USER_SESSION_IMAGE_HEADER image;
+			std::vector<uint8_t> pixels;
+		};
+
+		void moveTo( double time, bool shouldFireEvents );
+		bool decode( UserSessionTrack track );
+
+		UserSessionReader_ptr _reader;
+		double _time;
+		TRACK_CURSOR _cursors[USER_SESSION_TRACK_COUNT];
+		std::vector<USER_SESSION_SKELETON> _skeletons;
+	};
+}
+
+#endif /* USERSESSIONPLAYBACK_H_ */
@@ -0,0 +1,71 @@
+/*
+ * UserSessionReader.h
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Reads a session (.dkx, see UserSessionFormat.h) in place from a memory mapped file.
+ *      	Opening only reads the footer index, or walks the chunk headers of a session that was never closed,
+ *      	and splits it into one time ordered list of chunks per track. Chunks are then decoded one at a time
+ *      	when asked for, findChunk() finds which one of a track is current at any point on the timeline.
+ */
+
+#ifndef USERSESSIONREADER_H_
+#define USERSESSIONREADER_H_
+
+#include "UserSessionFormat.h"
+#include "UserStreamFrame.h"
+#include "MappedFile.h"
+#include <boost/shared_ptr.hpp>
+#include <string>
+#include <vector>
+
+namespace relay {
+	struct USER_SESSION_SKELETON {
+		uint16_t user;
+		UserStreamFrame frame;
+	};
+
+	class UserSessionReader;
+	typedef boost::shared_ptr<UserSessionReader> UserSessionReader_ptr;
+
+	class UserSessionReader {
+	public:
+		virtual ~UserSessionReader();
+
+		// Returns an empty pointer if the file can not be mapped or is not a session
+		static UserSessionReader_ptr open( const std::string &aPath );
+
+		const USER_SESSION_HEADER& getHeader() { return _header; };
+		const std::string& getPath() { return _file->getPath(); };
+		bool isRecovered() { return _isRecovered; };	// The session was never closed, its chunks were found by walking the file
+		double getDuration() { return _duration; };		// Seconds from the start of the session to its last chunk
+
+		// In time order
+		const std::vector<USER_SESSION_INDEX_ENTRY>& getChunks( UserSessionTrack track ) { return _tracks[track]; };
+
+		// Index into getChunks() of the last chunk at or before 'time', -1 if the track starts later
+		int findChunk( UserSessionTrack track, double time );
+
+		// Each returns false if the chunk is not of that track or is corrupt
+		bool readSkeletons( const USER_SESSION_INDEX_ENTRY &entry, std::vector<USER_SESSION_SKELETON> &skeletons );
+		bool readImage( const USER_SESSION_INDEX_ENTRY &entry, USER_SESSION_IMAGE_HEADER &image, std::vector<uint8_t> &pixels );
+		bool readImageHeader( const USER_SESSION_INDEX_ENTRY &entry, USER_SESSION_IMAGE_HEADER &image );	// Without decoding the pixels
+		bool readEvent( const USER_SESSION_INDEX_ENTRY &entry, std::string &text );
+
+	private:
+		UserSessionReader( MappedFile_ptr aFile );
+
+		bool readIndex();
+		void recoverIndex();
+		const uint8_t* getPayload( const USER_SESSION_INDEX_ENTRY &entry );
+
+		MappedFile_ptr _file;
+		USER_SESSION_HEADER _header;
+		bool _isRecovered;
+		double _duration;
+		std::vector<USER_SESSION_INDEX_ENTRY> _tracks[USER_SESSION_TRACK_COUNT];
+	};
+}
+
+#endif /* USERSESSIONREADER_H_ */
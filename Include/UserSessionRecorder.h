@@ -0,0 +1,63 @@
+/*
+ * UserSessionRecorder.h
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Records everything the installation sees and does into a session (.dkx, see UserSessionFormat.h),
+ *      	so an incident in the field can be replayed and profiled offline.
+ *      	WuCinderNITE hands it every capture, and the tracker, the state manager and the arduino interface report
+ *      	their events, from whichever thread they run on. Which tracks are kept and how often is set in
+ *      	Constants::relay::session, all of it goes through one UserSessionWriter. Does nothing unless started.
+ *      	Every MAX_SESSION_SECONDS the session continues in a new file (Session.dkx, Session_2.dkx ...), so an installation
+ *      	left recording for days keeps its files, and each writer's in-memory index, a bounded size.
+ */
+
+#ifndef USERSESSIONRECORDER_H_
+#define USERSESSIONRECORDER_H_
+
+#include "UserSessionFormat.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+namespace SKELETON { struct SKELETON; }
+
+namespace relay {
+	class UserSessionWriter;
+
+	class UserSessionRecorder {
+	public:
+		static UserSessionRecorder* getInstance();
+		virtual ~UserSessionRecorder();
+
+		bool start( const std::string &aPath );	// Stops the session already recording, if any. Later parts are numbered after aPath
+		void stop();							// Blocks until everything queued is on disk
+		bool isRecording();
+
+		// Once per capture, with the capture's lock held. skeletons[i] is user i, maps that are NULL are skipped
+		void recordCapture( const SKELETON::SKELETON *skeletons, int count,
+				const uint16_t *depth, const uint16_t *labels, uint16_t width, uint16_t height,
+				const uint8_t *rgb, uint16_t rgbWidth, uint16_t rgbHeight );
+		void recordEvent( UserSessionEvent event, uint16_t user, const std::string &text = "" );
+
+	private:
+		UserSessionRecorder();
+		static void createInstance();
+		boost::shared_ptr<UserSessionWriter> getWriter();
+		void rotate();	// Call with _mutex locked
+
+		static UserSessionRecorder* mInstance;
+
+		// Guarded by _mutex, captures and events push with it held
+		boost::mutex _mutex;
+		boost::shared_ptr<UserSessionWriter> _writer;
+		boost::shared_ptr<UserSessionWriter> _previousWriter;	// The last part, finishing in the background
+		std::string _path;
+		int _part;
+		uint32_t _framenumber;
+		double _lastKeyframeTime;
+	};
+}
+
+#endif /* USERSESSIONRECORDER_H_ */
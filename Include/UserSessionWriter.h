@@ -0,0 +1,91 @@
+/*
+ * UserSessionWriter.h
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Writes a session (.dkx, see UserSessionFormat.h) to disk from a single background thread.
+ *      	Chunks are timestamped and copied into a queue as they are pushed, from whichever thread pushes them, so the file
+ *      	stays in timeline order. The thread codes the images and writes everything, flushing after every batch so a crash
+ *      	loses at most what was still queued. Copies are capped at a number of queued bytes, once the disk falls behind
+ *      	frames and images are dropped rather than stalling the capture thread - events are small and always kept.
+ */
+
+#ifndef USERSESSIONWRITER_H_
+#define USERSESSIONWRITER_H_
+
+#include "UserSessionFormat.h"
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace SKELETON { struct SKELETON; }
+
+namespace relay {
+	class UserSessionWriter {
+	public:
+		UserSessionWriter( const std::string &aPath, size_t aQueueBytes );
+		virtual ~UserSessionWriter();	// Finishes the file and joins the thread
+
+		// Each returns false if the chunk was dropped
+		// skeletons[i] is user i, only the tracked ones are kept. Captures with nobody tracked are skipped,
+		// but for the first one after someone was, which tells playback they are gone
+		bool pushSkeletons( const SKELETON::SKELETON *skeletons, int count, uint32_t framenumber );
+		bool pushImage( UserSessionTrack track, const USER_SESSION_IMAGE_HEADER &image, const void *pixels );
+		bool pushEvent( UserSessionEvent event, uint16_t user, const std::string &text );
+		void stop();	// Returns immediately, the thread finishes the file
+
+		double getElapsedSeconds();	// Where the next chunk would land on the timeline
+		bool isFinished() { return _isFinished; };
+		uint32_t getChunksWritten() { return _chunksWritten; };
+		uint32_t getChunksDropped() { return _chunksDropped; };
+
+	private:
+		struct PENDING_CHUNK {
+			USER_SESSION_CHUNK_HEADER header;	// 'length' is filled in once the payload is coded
+			std::vector<uint8_t> payload;		// Image header and pixels before coding
+		};
+
+		PENDING_CHUNK* beginChunk( UserSessionTrack track, uint8_t codec, uint16_t user, size_t bytes, bool canDrop );	// Call with _mutex locked
+		void endChunk( PENDING_CHUNK *chunk );	// Call with _mutex locked
+
+		void run();
+		bool openFile();
+		void writeChunk( PENDING_CHUNK &chunk );
+		void closeFile();
+
+		std::string _path;
+		boost::posix_time::ptime _startTime;
+
+		// Shared with the thread, guarded by _mutex
+		std::deque<PENDING_CHUNK*> _queue;
+		std::vector<PENDING_CHUNK*> _spareChunks;	// Written chunks are reused so images don't reallocate every frame
+		size_t _queuedBytes;
+		size_t _maxQueuedBytes;
+		bool _wasAnyoneTracked;	// In the last skeleton chunk queued
+		bool _shouldStop;
+		boost::mutex _mutex;
+		boost::condition_variable _condition;
+
+		boost::thread _thread;
+		volatile bool _isFinished;
+		volatile uint32_t _chunksWritten;
+		volatile uint32_t _chunksDropped;
+
+		// Only touched by the thread
+		std::ofstream _stream;
+		USER_SESSION_HEADER _header;
+		std::vector<USER_SESSION_INDEX_ENTRY> _index;
+		std::vector<uint8_t> _encoded;
+		uint64_t _offset;
+		uint64_t _bytesWritten;	// Payload bytes after coding
+		uint64_t _bytesPushed;	// Payload bytes before coding
+	};
+}
+
+#endif /* USERSESSIONWRITER_H_ */
@@ -0,0 +1,51 @@
+/*
+ * UserSignatureCache.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	OpenNI regularly drops a visitor and re-adds them under a new id.
+ *      	A USER_SIGNATURE is a compact description of a body (bone length ratios, height, where they
+ *      	were standing and when) plus the per user state worth keeping.
+ *      	UserTracker remembers the last few lost users here and looks for the nearest match whenever
+ *      	a new id starts tracking, so the returning visitor skips the warm-up.
+ */
+
+#pragma once
+#ifndef USERSIGNATURECACHE_H_
+#define USERSIGNATURECACHE_H_
+
+#include "cinder/Vector.h"
+#include "SkeletonGapFiller.h"
+#include <XnTypes.h>
+#include <list>
+
+struct USER_SIGNATURE {
+	USER_SIGNATURE():id(0),height(0),time(-1),wasActive(false){};
+	XnUserID	id;
+	ci::Vec2f	floorPosition;	// torso projected onto the floor, room coordinates
+	float		height;			// head above the floor
+	double		time;			// last time this user was tracked, negative if never
+	bool		wasActive;
+	SkeletonGapFiller	gapFiller;	// learned bone lengths and joint history
+};
+
+class UserSignatureCache {
+public:
+	UserSignatureCache( size_t capacity );
+
+	void add( const USER_SIGNATURE &signature );	// Most recent first, the oldest falls off the end
+	bool takeMatch( const USER_SIGNATURE &probe, double now, USER_SIGNATURE &match );	// Removes the match from the cache
+	void clear() { _signatures.clear(); };
+
+	// Lower is closer, negative if the two can not be the same person
+	static float score( const USER_SIGNATURE &probe, const USER_SIGNATURE &candidate, double now );
+	// Mean difference of each bone's share of the total length, negative if too few bones are known to both
+	static float compareBones( const SkeletonGapFiller &a, const SkeletonGapFiller &b );
+
+private:
+	size_t _capacity;
+	std::list<USER_SIGNATURE> _signatures;
+};
+
+#endif /* USERSIGNATURECACHE_H_ */
@@ -0,0 +1,139 @@
+/*
+ * UserStreamBinary.h
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Binary skeleton recording format (.dks), the compact alternative to the JSON recordings.
+ *
+ *      	[ USER_STREAM_HEADER ][ frame 0 ][ frame 1 ] ... [ frame N-1 ][ USER_STREAM_INDEX_ENTRY * indexCount ]
+ *
+ *      	With USER_STREAM_CODEC_RAW every frame is a fixed size record - USER_STREAM_FRAME_HEADER followed by jointCount
+ *      	( confidence, x, y, z ) floats - so frame i lives at dataOffset + i * frameStride and the whole
+ *      	file can be memory mapped and read in place. The footer index holds the offset and timestamp of every
+ *      	indexInterval'th frame. All values are little endian, positions are in meters.
+ *
+ *      	With USER_STREAM_CODEC_DELTA the data is a run of compressed blocks of indexInterval frames (see UserStreamDeltaCodec.h),
+ *      	each one starting at an index entry, and frameStride is 0.
+ */
+
+#ifndef USERSTREAMBINARY_H_
+#define USERSTREAMBINARY_H_
+
+#include "UserStreamFrame.h"
+#include "SkeletonJointSet.h"
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace relay {
+	static const char USER_STREAM_MAGIC[4] = { 'D', 'K', 'S', 'R' };
+	static const uint16_t USER_STREAM_VERSION = 2;	// 2 - jointMask, delta codec
+	static const uint32_t USER_STREAM_INDEX_INTERVAL = 30;
+	static const char* const USER_STREAM_BINARY_EXTENSION = ".dks";
+
+	enum UserStreamCodec {
+		USER_STREAM_CODEC_RAW = 0,	// Fixed stride frames
+		USER_STREAM_CODEC_DELTA = 1	// Compressed blocks, one per index entry
+	};
+
+	struct USER_STREAM_HEADER {
+		char		magic[4];
+		uint16_t	version;
+		uint16_t	codec;			// UserStreamCodec
+		uint16_t	jointCount;
+		uint16_t	frameStride;	// Bytes per frame record
+		float		frameRate;		// Nominal rate it was recorded at
+		float		unitsPerMeter;
+		uint32_t	frameCount;
+		double		duration;		// Seconds between the first and last frame
+		uint64_t	dataOffset;		// First frame record
+		uint64_t	indexOffset;	// Footer index, 0 if there is none
+		uint32_t	indexCount;
+		uint32_t	indexInterval;	// Frames between index entries
+		uint32_t	jointMask;		// JOINT_BIT of each stored joint, 0 in version 1 files means all of them
+		uint8_t		reserved[4];
+	};
+
+	struct USER_STREAM_FRAME_HEADER {
+		double		timestamp;		// Seconds since the recording started
+		uint32_t	framenumber;
+		uint8_t		isTracking;
+		uint8_t		reserved[3];
+	};
+
+	struct USER_STREAM_INDEX_ENTRY {
+		uint32_t	frame;
+		uint32_t	reserved;
+		double		timestamp;
+		uint64_t	offset;			// From the start of the file
+	};
+
+	namespace UserStreamBinary {
+		bool isValidHeader( const USER_STREAM_HEADER &header, uint64_t fileSize );
+		bool isValidIndex( const USER_STREAM_HEADER &header, const std::vector<USER_STREAM_INDEX_ENTRY> &index );
+		uint32_t getFrameStride( uint16_t jointCount );	// Wider than USER_STREAM_HEADER::frameStride so a corrupt jointCount can't wrap
+
+		// Delta codec, byte range and frames of a block - block i starts at index entry i
+		void getBlock( const USER_STREAM_HEADER &header, const std::vector<USER_STREAM_INDEX_ENTRY> &index, uint32_t block,
+				uint64_t &offset, uint64_t &length, uint32_t &firstFrame, uint32_t &frameCount );
+
+		// Fixed stride frame records, 'record' must have getFrameStride() bytes
+		void encodeFrame( const UserStreamFrame &frame, char *record );
+		void decodeFrame( const char *record, uint16_t jointCount, UserStreamFrame &frame );
+	}
+
+	class UserStreamBinaryWriter {
+	public:
+		UserStreamBinaryWriter();
+		virtual ~UserStreamBinaryWriter();
+
+		bool open( const std::string &aPath, float aFrameRate, UserStreamCodec aCodec = USER_STREAM_CODEC_RAW );
+		void write( const UserStreamFrame &frame );
+		bool close();	// Writes the footer index and the final header, called by the destructor if needed
+
+		bool isOpen() { return _stream.is_open(); };
+		uint32_t getFrameCount() { return _header.frameCount; };
+
+	private:
+		void addIndexEntry( const UserStreamFrame &frame );
+		void writeBlock();	// Delta codec, compresses and writes the buffered frames
+
+		std::ofstream _stream;
+		USER_STREAM_HEADER _header;
+		std::vector<USER_STREAM_INDEX_ENTRY> _index;
+		std::vector<char> _record;
+		std::vector<UserStreamFrame> _block;
+		std::vector<uint8_t> _encoded;
+		uint64_t _offset;		// Where the next frame or block is written
+		double _firstTimestamp;
+	};
+
+	class UserStreamBinaryReader {
+	public:
+		UserStreamBinaryReader();
+		virtual ~UserStreamBinaryReader();
+
+		bool open( const std::string &aPath );	// Only reads the header and the index
+		void close();
+		bool readFrame( uint32_t index, UserStreamFrame &frame );
+
+		const USER_STREAM_HEADER& getHeader() { return _header; };
+		uint32_t getFrameCount() { return _header.frameCount; };
+		double getDuration() { return _header.duration; };
+		const std::vector<USER_STREAM_INDEX_ENTRY>& getIndex() { return _index; };
+
+	private:
+		std::ifstream _stream;
+		USER_STREAM_HEADER _header;
+		std::vector<USER_STREAM_INDEX_ENTRY> _index;
+		std::vector<char> _record;
+
+		// Delta codec, the last block decoded
+		std::vector<UserStreamFrame> _blockFrames;
+		uint32_t _cachedBlock;
+	};
+}
+
+#endif /* USERSTREAMBINARY_H_ */
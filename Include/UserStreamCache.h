@@ -0,0 +1,70 @@
+/*
+ * UserStreamCache.h
+ *
+ *  Created on: Oct 24, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Process wide cache of loaded recordings, keyed by path and modification time.
+ *      	Every recording is mapped once - json ones are indexed once as well (see UserStreamJSONSource.h) -
+ *      	and every player gets its own cheap source over the shared data.
+ *      	Least recently used recordings are dropped once the cache holds more than its capacity in bytes -
+ *      	players still holding one keep it alive until they are done with it.
+ *      	Safe to call from any thread.
+ */
+
+#ifndef USERSTREAMCACHE_H_
+#define USERSTREAMCACHE_H_
+
+#include "IUserStreamSource.h"
+#include "UserStreamJSONSource.h"
+#include "MappedFile.h"
+#include <boost/thread/mutex.hpp>
+#include <ctime>
+#include <list>
+#include <string>
+
+namespace relay {
+	struct USER_STREAM_CACHE_STATS {
+		uint32_t hits;
+		uint32_t misses;
+		uint32_t evictions;
+		uint32_t entries;
+		size_t bytes;		// Held by the cache
+		size_t capacity;
+	};
+
+	class UserStreamCache {
+	public:
+		static UserStreamCache* getInstance();
+
+		// A new source over the cached recording, loading it on a miss. Empty if it can not be loaded
+		IUserStreamSource_ptr open( const std::string &aPath );
+
+		void setCapacity( size_t bytes );
+		void clear();
+		USER_STREAM_CACHE_STATS getStats();
+
+	private:
+		UserStreamCache();
+		static void createInstance();
+		static UserStreamCache* mInstance;
+
+		struct ENTRY {
+			std::string path;
+			time_t modified;
+			size_t bytes;
+			MappedFile_ptr file;
+			UserStreamJSONIndex_ptr jsonIndex;	// Json recordings only
+		};
+
+		static bool load( const std::string &aPath, ENTRY &entry );
+		static IUserStreamSource_ptr createSource( const ENTRY &entry );
+		void evict();	// Call with _mutex held
+
+		std::list<ENTRY> _entries;	// Most recently used first
+		USER_STREAM_CACHE_STATS _stats;
+		boost::mutex _mutex;
+	};
+}
+
+#endif /* USERSTREAMCACHE_H_ */
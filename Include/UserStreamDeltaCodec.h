@@ -0,0 +1,37 @@
+/*
+ * UserStreamDeltaCodec.h
+ *
+ *  Created on: Oct 22, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Inter-frame delta compression for recordings (USER_STREAM_CODEC_DELTA).
+ *      	Frames are coded in blocks that start with a keyframe, so each block decodes on its own and seeking
+ *      	only costs one block. Inside a block values are quantized, predicted from the previous frame
+ *      	(timestamps are extrapolated from the previous two) and the residuals entropy coded with an adaptive range coder.
+ *
+ *      	The codec is lossy only by quantization: positions to POSITION_QUANTUM meters, confidence to
+ *      	1 / CONFIDENCE_STEPS and timestamps to TIMESTAMP_QUANTUM seconds. NaN values are stored as zero.
+ */
+
+#ifndef USERSTREAMDELTACODEC_H_
+#define USERSTREAMDELTACODEC_H_
+
+#include "UserStreamFrame.h"
+#include <stdint.h>
+#include <vector>
+
+namespace relay {
+	namespace UserStreamDeltaCodec {
+		static const double POSITION_QUANTUM = 0.0001;	// A tenth of a millimeter, well under the Kinect's noise
+		static const double TIMESTAMP_QUANTUM = 0.0001;
+		static const int CONFIDENCE_STEPS = 1024;
+
+		// Appends 'count' frames as one block, only the joints in 'jointMask' are stored
+		void encodeBlock( const UserStreamFrame *frames, uint32_t count, uint32_t jointMask, std::vector<uint8_t> &output );
+
+		// Decodes a block written by encodeBlock, returns false if the data is truncated
+		bool decodeBlock( const uint8_t *data, size_t length, uint32_t count, uint32_t jointMask, UserStreamFrame *frames );
+	}
+}
+
+#endif /* USERSTREAMDELTACODEC_H_ */
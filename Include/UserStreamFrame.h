@@ -4,7 +4,7 @@
  *  Created on: Sep 24, 2011
  *      Author: onedayitwillmake
  *      Abstract: This class represents a single frame of UserStream data.
- *      It contains a framenumber, and a WuCinderNITE::SKELETON struct.
+ *      It contains a framenumber, a timestamp and a WuCinderNITE::SKELETON struct.
  *      It is able to output itself as a jsonstring, or create itself from a json string
  */
 
@@ -22,23 +22,30 @@ namespace SKELETON {
 }
 class WuCinderNITE;
 class UserTracker;
+namespace Json { class StreamingWriter; }
 
 namespace relay
 {
 	class UserStreamFrame
 	{
 		public:
-			UserStreamFrame( uint32_t aFramenumber, SKELETON::SKELETON &aSkeleton );
+			UserStreamFrame();
+			UserStreamFrame( uint32_t aFramenumber, SKELETON::SKELETON &aSkeleton, double aTimestamp );
 			virtual ~UserStreamFrame();
 
 			// Static creation of an instance
-			static boost::shared_ptr<UserStreamFrame> fromJSON( Json::Value json  );
+			static boost::shared_ptr<UserStreamFrame> fromJSON( const Json::Value &json );
 			// Outputs to JSON string
 			Json::Value toJSON();
+			// Streams the same document toJSON() builds, members in the same order, without building it
+			void writeJSON( Json::StreamingWriter &writer ) const;
 
 			// Sequenced framenumber of this recording
 			uint32_t framenumber;
 
+			// Seconds since the recording started
+			double timestamp;
+
 			// Skeleton data
 			SKELETON::SKELETON skeleton;
 	};
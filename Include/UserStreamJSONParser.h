@@ -0,0 +1,74 @@
+/*
+ * UserStreamJSONParser.h
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Streaming parser for JSON skeleton recordings.
+ *      	It only understands the recording schema - {root:[{framenumber, timestamp, skeletonData:{isTracking, joints:[{confidence, position:{x,y,z}}]}}]} -
+ *      	and writes straight into UserStreamFrames while it walks the text, without building a Json::Value tree.
+ *      	Unknown members are skipped, so it reads anything UserStreamFrame::fromJSON reads and decodes the same values.
+ *
+ *      	index() finds the frames of a document without decoding most of them, parseFrames() then decodes a window
+ *      	of them on demand - UserStreamJSONSource seeks through json recordings that way.
+ */
+
+#ifndef USERSTREAMJSONPARSER_H_
+#define USERSTREAMJSONPARSER_H_
+
+#include "UserStreamFrame.h"
+#include "UserStreamBinary.h"
+#include <string>
+#include <vector>
+
+namespace relay {
+	class UserStreamJSONParser {
+	public:
+		UserStreamJSONParser();
+		virtual ~UserStreamJSONParser();
+
+		// Appends every frame in the document to 'frames', returns false and sets getError() on malformed input
+		bool parse( const char *data, size_t length, std::vector<UserStreamFrame> &frames );
+		bool parseFile( const std::string &aPath, std::vector<UserStreamFrame> &frames );
+
+		// Counts the frames and records the offset and timestamp of every 'interval'th one, only those are decoded
+		bool index( const char *data, size_t length, uint32_t interval, std::vector<USER_STREAM_INDEX_ENTRY> &entries, uint32_t &frameCount );
+		// Decodes 'count' consecutive frames, the first one at an offset index() recorded
+		bool parseFrames( const char *data, size_t length, uint64_t offset, uint32_t count, UserStreamFrame *frames );
+
+		const std::string& getError() { return _error; };
+
+		// Upper bound on the frames in a document, used to preallocate
+		static size_t countFrames( const char *data, size_t length );
+
+	private:
+		// Schema
+		bool parseRecording( std::vector<UserStreamFrame> &frames );
+		bool indexRecording( uint32_t interval, std::vector<USER_STREAM_INDEX_ENTRY> &entries, uint32_t &frameCount );
+		bool parseFrame( UserStreamFrame &frame );
+		bool parseSkeleton( SKELETON::SKELETON &skeleton );
+		bool parseJoints( SKELETON::SKELETON &skeleton );
+		bool parseJoint( SKELETON::SKELETON_JOINT &joint );
+		bool parsePosition( ci::Vec3f &position );
+
+		// Tokens
+		void skipWhitespace();
+		bool expect( char c );
+		bool parseKey( const char* &key, size_t &keyLength );
+		bool parseNumber( double &value );
+		bool parseBool( bool &value );
+		bool skipString();
+		bool skipValue();
+		bool skipStructure();	// Steps over an object or array looking only at brackets and strings
+		bool beginMember( bool &isFirst, bool &hasMember, char closing );	// Consumes ',' or the closing brace
+
+		bool fail( const char *message );
+
+		const char *_begin;
+		const char *_current;
+		const char *_end;
+		std::string _error;
+	};
+}
+
+#endif /* USERSTREAMJSONPARSER_H_ */
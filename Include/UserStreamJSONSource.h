@@ -0,0 +1,60 @@
+/*
+ * UserStreamJSONSource.h
+ *
+ *  Created on: Oct 27, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over a memory mapped json recording, the json counterpart of UserStreamMappedSource.
+ *      	createIndex() makes one pass over the text that only decodes every USER_STREAM_INDEX_INTERVAL'th frame,
+ *      	which gives the frame count, the duration and where to start decoding any frame. Frames are then
+ *      	decoded a block of USER_STREAM_INDEX_INTERVAL at a time when asked for, keeping the last block, so a long
+ *      	recording opens without being parsed and scrubbing only ever decodes the frames around the playhead.
+ *      	The index is immutable and shared by every source over the same file through the UserStreamCache.
+ */
+
+#ifndef USERSTREAMJSONSOURCE_H_
+#define USERSTREAMJSONSOURCE_H_
+
+#include "IUserStreamSource.h"
+#include "UserStreamBinary.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace relay {
+	struct USER_STREAM_JSON_INDEX {
+		uint32_t frameCount;
+		uint32_t interval;			// Frames between entries
+		double duration;			// Seconds between the first and last frame
+		std::vector<USER_STREAM_INDEX_ENTRY> entries;	// Offset into the text, one entry every 'interval' frames
+	};
+	typedef boost::shared_ptr<const USER_STREAM_JSON_INDEX> UserStreamJSONIndex_ptr;
+
+	class UserStreamJSONSource : public IUserStreamSource {
+	public:
+		virtual ~UserStreamJSONSource();
+
+		// Returns an empty pointer if the file can not be mapped or is not a valid recording
+		static IUserStreamSource_ptr open( const std::string &aPath );
+		static IUserStreamSource_ptr open( MappedFile_ptr aFile, UserStreamJSONIndex_ptr anIndex );
+
+		// Returns an empty pointer if the file is not a valid recording
+		static UserStreamJSONIndex_ptr createIndex( MappedFile_ptr aFile );
+
+		uint32_t getFrameCount() { return _index->frameCount; };
+		double getDuration() { return _index->duration; };
+		bool getFrame( uint32_t index, UserStreamFrame &frame );
+
+	private:
+		UserStreamJSONSource( MappedFile_ptr aFile, UserStreamJSONIndex_ptr anIndex );
+
+		MappedFile_ptr _file;
+		UserStreamJSONIndex_ptr _index;
+
+		// The last block decoded
+		std::vector<UserStreamFrame> _blockFrames;
+		uint32_t _cachedBlock;
+	};
+}
+
+#endif /* USERSTREAMJSONSOURCE_H_ */
@@ -38,6 +38,7 @@ class UserStreamLive : public IUserStream  {
 		SKELETON::SKELETON getSkeleton();
 
 		bool wantsToExit();
+		const char* getName() { return "UserStreamLive"; };
 	private:
 		boost::signals2::connection	_signalConnectionNewUser;
 		boost::signals2::connection	_signalConnectionLostUser;
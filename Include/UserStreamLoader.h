@@ -0,0 +1,69 @@
+/*
+ * UserStreamLoader.h
+ *
+ *  Created on: Oct 25, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Loads recordings on a background thread so parsing a large json file never stalls a frame.
+ *      	load() returns a UserStreamLoad handle straight away, poll isReady() each update and take
+ *      	the source once it is. Recordings go through the UserStreamCache, so loading one ahead of time
+ *      	(prefetching) makes the later load of the same path instant.
+ */
+
+#ifndef USERSTREAMLOADER_H_
+#define USERSTREAMLOADER_H_
+
+#include "IUserStreamSource.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <deque>
+#include <string>
+
+namespace relay {
+	// Future like handle to a recording being loaded
+	class UserStreamLoad {
+	public:
+		UserStreamLoad( const std::string &aPath );
+
+		const std::string& getPath() { return _path; };
+		bool isReady();							// Finished loading, successfully or not
+		void wait();							// Blocks until isReady
+		IUserStreamSource_ptr getSource();		// Empty until ready, or if the recording could not be loaded
+
+	private:
+		friend class UserStreamLoader;
+		void setSource( IUserStreamSource_ptr aSource );
+
+		std::string _path;
+		bool _isReady;
+		IUserStreamSource_ptr _source;
+		boost::mutex _mutex;
+		boost::condition_variable _condition;
+	};
+	typedef boost::shared_ptr<UserStreamLoad> UserStreamLoad_ptr;
+
+	class UserStreamLoader {
+	public:
+		static UserStreamLoader* getInstance();
+		virtual ~UserStreamLoader();
+
+		UserStreamLoad_ptr load( const std::string &aPath );
+		UserStreamLoad_ptr loadGesture( const std::string &aName );	// From the GestureLibrary, or the resource of that name without one
+
+	private:
+		UserStreamLoader();
+		static UserStreamLoader* mInstance;
+
+		void run();
+
+		std::deque<UserStreamLoad_ptr> _queue;	// Guarded by _mutex
+		bool _shouldStop;
+		boost::mutex _mutex;
+		boost::condition_variable _condition;
+		boost::thread _thread;
+	};
+}
+
+#endif /* USERSTREAMLOADER_H_ */
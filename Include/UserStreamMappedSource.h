@@ -0,0 +1,55 @@
+/*
+ * UserStreamMappedSource.h
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over a memory mapped binary (.dks) recording, either a file of its own
+ *      	or a range inside a larger mapping such as the GestureLibrary.
+ *      	Opening only validates the header, frames are decoded in place when asked for, so switching
+ *      	recordings costs the same no matter how long they are and only touched pages become resident.
+ *      	Compressed files decode one block at a time and keep the last one.
+ */
+
+#ifndef USERSTREAMMAPPEDSOURCE_H_
+#define USERSTREAMMAPPEDSOURCE_H_
+
+#include "IUserStreamSource.h"
+#include "UserStreamBinary.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace relay {
+	class UserStreamMappedSource : public IUserStreamSource {
+	public:
+		UserStreamMappedSource();
+		virtual ~UserStreamMappedSource();
+
+		// Returns an empty pointer if the file can not be mapped or is not a valid recording
+		static IUserStreamSource_ptr open( const std::string &aPath );
+		// A recording stored at [offset, offset + length) of an already mapped file, it keeps the mapping alive
+		static IUserStreamSource_ptr open( MappedFile_ptr aFile, uint64_t anOffset, uint64_t aLength );
+
+		uint32_t getFrameCount() { return _header.frameCount; };
+		double getDuration() { return _header.duration; };
+		bool getFrame( uint32_t index, UserStreamFrame &frame );
+
+		const USER_STREAM_HEADER& getHeader() { return _header; };
+
+	private:
+		bool map( MappedFile_ptr aFile, uint64_t anOffset, uint64_t aLength );
+
+		MappedFile_ptr _file;
+		const char* _data;		// Start of the recording inside _file
+		size_t _size;
+		USER_STREAM_HEADER _header;
+
+		// Delta codec
+		std::vector<USER_STREAM_INDEX_ENTRY> _index;
+		std::vector<UserStreamFrame> _blockFrames;
+		uint32_t _cachedBlock;
+	};
+}
+
+#endif /* USERSTREAMMAPPEDSOURCE_H_ */
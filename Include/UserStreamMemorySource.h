@@ -0,0 +1,41 @@
+/*
+ * UserStreamMemorySource.h
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over frames held in memory - used for JSON recordings and the repeater.
+ *      	The frames are immutable and shared, any number of players can read the same recording.
+ */
+
+#ifndef USERSTREAMMEMORYSOURCE_H_
+#define USERSTREAMMEMORYSOURCE_H_
+
+#include "IUserStreamSource.h"
+#include "UserStreamFrame.h"
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace Json { class Value; }
+
+namespace relay {
+	typedef boost::shared_ptr< const std::vector<UserStreamFrame> > UserStreamFrames_ptr;
+
+	class UserStreamMemorySource : public IUserStreamSource {
+	public:
+		UserStreamMemorySource( UserStreamFrames_ptr someFrames );
+		virtual ~UserStreamMemorySource();
+
+		// Creates a source from a {root:[ frame, ... ]} json recording
+		static IUserStreamSource_ptr fromJSON( const Json::Value &json );
+
+		uint32_t getFrameCount() { return _frames->size(); };
+		double getDuration();
+		bool getFrame( uint32_t index, UserStreamFrame &frame );
+
+	private:
+		UserStreamFrames_ptr _frames;
+	};
+}
+
+#endif /* USERSTREAMMEMORYSOURCE_H_ */
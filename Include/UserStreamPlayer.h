@@ -5,7 +5,7 @@
  *      Author: mariogonzalez
  *      Abstract:
  *      	 This represents one of the states in the UserStreamStateManager
- *      	 It is responsible for playing a json skeleton recording
+ *      	 It is responsible for playing a json or binary (.dks) skeleton recording
  */
 
 #ifndef USERSTREAMPLAYER_H_
@@ -13,6 +13,8 @@
 
 #include "IUserStream.h"
 #include "UserStreamFrame.h"
+#include "IUserStreamSource.h"
+#include "UserStreamLoader.h"
 #include "json/value.h"
 #include "cinder/app/MouseEvent.h"
 #include "cinder/app/FileDropEvent.h"
@@ -43,8 +45,10 @@ namespace relay {
 		void play();
 		void pause();
 		void restart();
-		bool isDone() { return _currentFrame >= _totalframes; };
+		bool isDone();
+		void seek( double seconds );		// Playhead position from the start of the recording
 		bool wantsToExit() { return isDone(); };
+		const char* getName() { return "UserStreamPlayer"; };
 
 		///// CALLBACKS
 		bool onToggleRecordingClicked( ci::app::MouseEvent event );
@@ -52,18 +56,41 @@ namespace relay {
 		int filedropCallbackId;
 
 		///// ACCESSORS
-		void setJson( const std::string &aPath );
+		void setGesture( const std::string &aName );		// From the GestureLibrary, or the resource of that name without one
+		void setRecording( const std::string &aPath );	// Json or binary (.dks), shared through the UserStreamCache
 		void setJson( Json::Value *aJsonValue );
+		void setSource( IUserStreamSource_ptr aSource );
 
 		int getCurrentFrame() { return _currentFrame; }
 		int getTotalFrames() { return _totalframes; }
+		double getDuration() { return _duration; }
+		double getPlayhead() { return _playhead; }
+		void setPlaybackRate( float aRate ) { _rate = aRate; };	// 1 is recorded speed, negative plays in reverse
+		float getPlaybackRate() { return _rate; };
 
 	private:
 		PlayerState _state;
 		bool _shouldLoop;
-		int _currentFrame;
+		int _currentFrame;				// Frame at or before the playhead, shown and set by _frameSlider
+		int _displayedFrame;			// _currentFrame as of the last update, a difference means the slider moved
 		int _totalframes;
-		std::vector< UserStreamFrame_ptr > _recording;
+		IUserStreamSource_ptr _source;	// Read only view of a recording shared with other players
+		UserStreamLoad_ptr _pendingLoad;	// Dropped file, played as soon as it is ready
+
+		// Playback is driven by the recorded timestamps, not by how often update is called
+		double _playhead;				// Seconds from the first frame
+		double _duration;
+		double _startTimestamp;			// Timestamp of the first frame
+		double _lastUpdateTime;
+		float _rate;
+
+		// The two frames either side of the playhead, kept between calls since the source may have to decode them
+		UserStreamFrame _frames[2];
+		int _frameIndex;				// Index of _frames[0], -1 if none
+
+		uint32_t findFrame( double seconds );	// Last frame at or before 'seconds'
+		double getFrameTime( uint32_t index );
+		void loadFrames( uint32_t index );
 
 		// GUI
 		mowa::sgui::LabelControl* _label;	// Label that displays crrent state
@@ -73,10 +100,6 @@ namespace relay {
 		mowa::sgui::SimpleGUI* _gui;		// SimpleGUI instance
 
 		boost::ptr_vector< mowa::sgui::Control > _miscGuis;
-
-		Json::Value _json;
-		std::string _jsonString;
-		void parseJson( Json::Value* aJsonValue );
 	};
 }
 
@@ -6,6 +6,8 @@
  *      Abstract:
  *      	 This represents one of the states in the UserStreamStateManager
  *      	 It is able to record a user stream from the Kinect and outputing it as a JSON string
+ *      	 By default frames are streamed to disk by a UserStreamWriter as they are recorded,
+ *      	 the repeater keeps them in memory instead so it can play them straight back
  *      	 It relies on a UserStreamLive instance for kinect data
  */
 
@@ -18,6 +20,9 @@
 #include "IUserStream.h"
 #include "UserStreamLive.h"
 #include "UserStreamFrame.h"
+#include "UserStreamWriter.h"
+#include "UserStreamMemorySource.h"
+#include <boost/shared_ptr.hpp>
 #include "cinder/app/Event.h"
 #include "cinder/app/MouseEvent.h"
 
@@ -35,7 +40,7 @@ class UserStreamRecorder : public IUserStream  {
 	public:
 		enum RecorderState { NOT_RECORDERING, RECORDING };
 
-		UserStreamRecorder();
+		UserStreamRecorder( bool aShouldStreamToDisk = true );
 		virtual ~UserStreamRecorder();
 
 		void enter();
@@ -43,6 +48,7 @@ class UserStreamRecorder : public IUserStream  {
 		void draw();
 		void exit();
 		bool wantsToExit() { return false; };
+		const char* getName() { return "UserStreamRecorder"; };
 
 		Json::Value getRecordAsJSONValue();
 		SKELETON::SKELETON getSkeleton();
@@ -53,7 +59,10 @@ class UserStreamRecorder : public IUserStream  {
 		void startRecording();	// Starts recording Kinect data
 		void recordState();		// Records a single frame of user Kinect data via UserStreamFrame
 		void stopRecording();	// Stops recording Kinect data
-		void saveToDisk( std::string jsonString );	// Save to disk
+		bool saveToDisk();							// Save to disk as pretty JSON, streamed frame by frame
+		bool saveBinaryToDisk();					// Save to disk as a binary .dks recording
+		const std::vector< UserStreamFrame >& getRecording() { return _recording; };	// Empty when streaming to disk
+		UserStreamFrames_ptr takeRecording();		// Hands the in memory frames over as a shareable recording, leaving the recorder empty
 		uint32_t getFrameNumber() { return _framenumber; };
 
 		// Callbacks
@@ -62,6 +71,7 @@ class UserStreamRecorder : public IUserStream  {
 
 	private:
 		void setState( RecorderState aState );	// Sets the current state, modifies _label in place
+		std::string getRecordingPath();			// Timestamped path without an extension
 
 		UserStreamLive *_livestream;		// When queried for skeleton data we just send whatever our livestream has
 
@@ -72,9 +82,12 @@ class UserStreamRecorder : public IUserStream  {
 
 		RecorderState _state;	// Current state - either recording or idle
 		uint32_t _framenumber;	// Current frame number of recording, set to zero on start
+		double _startTime;		// Elapsed seconds when the recording started, frames are timestamped relative to it
 
-
-		std::vector< UserStreamFrame_ptr > _recording;	// Stores frames during recording
+		bool _shouldStreamToDisk;
+		boost::shared_ptr<UserStreamWriter> _writer;	// Streams the current recording to disk, kept alive until the next one so stopping never blocks
+		static boost::shared_ptr<UserStreamWriter> _previousWriter;	// The last recorder's writer, finishing in the background until the next recorder exits
+		std::vector< UserStreamFrame > _recording;		// Stores frames during recording when not streaming
 	};
 }
 
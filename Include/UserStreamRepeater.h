@@ -5,12 +5,14 @@
  *      Author: mariogonzalez
  *      Abstract:
  *      	This state is able to record user movement, then play it back to them.
+ *      	A UserStreamSegmenter watches the live stream and the first complete gesture it cuts out is played back.
  */
 
 #ifndef USERSTREAMREPEATER_H_
 #define USERSTREAMREPEATER_H_
 
 #include "IUserStream.h"
+#include "UserStreamSegmenter.h"
 
 #include "json/json.h"
 #include "boost/bind.hpp"
@@ -46,6 +48,7 @@ namespace relay {
 			void draw();
 			void exit();
 			bool wantsToExit();
+			const char* getName() { return "UserStreamRepeater"; };
 
 			SKELETON::SKELETON getSkeleton();
 
@@ -58,15 +61,10 @@ namespace relay {
 			void setState( REPEATER_STATE aState );
 			REPEATER_STATE getState() { return _state; };
 
-			void startRecording();
-			void stopRecording();
-
-			Json::Value _recording;					// In memory json recording fed to 'player'
-			int _numberOfFramesToRecord;
-
-			float _cumalitiveDelta;
+			UserStreamSegmenter _segmenter;			// Finds where the user's gesture starts and ends
 			int _frameCounter;
-			bool canStartRecording();		// Atleast a user, and atleast some movement
+			void segmentLiveStream();				// Feeds the segmenter one live frame
+			void playSegment( UserStreamFrames_ptr aSegment );
 
 			boost::signals2::connection	_signalConnectionNewUser;
 			boost::signals2::connection	_signalConnectionLostUser;
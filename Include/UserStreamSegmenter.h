@@ -0,0 +1,50 @@
+/*
+ * UserStreamSegmenter.h
+ *
+ *  Created on: Oct 27, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Cuts gestures out of a live stream of frames.
+ *      	Each frame's motion energy is the speed of the fastest limbs relative to the torso, smoothed over a few frames.
+ *      	A gesture starts once the energy stays above START_ENERGY for a while and ends once it stays below the lower
+ *      	STOP_ENERGY for a while, the gap between the two keeps a pause mid gesture from splitting it.
+ *      	Idle frames before and after are trimmed down to a short lead in and out, and the segment is rebased to start at zero.
+ */
+
+#ifndef USERSTREAMSEGMENTER_H_
+#define USERSTREAMSEGMENTER_H_
+
+#include "UserStreamFrame.h"
+#include "UserStreamMemorySource.h"
+#include <deque>
+#include <vector>
+
+namespace relay {
+	class UserStreamSegmenter {
+	public:
+		UserStreamSegmenter();
+
+		void reset();
+		bool push( const UserStreamFrame &frame );	// Returns true when it completes a segment, collect it with takeSegment
+		bool flush();								// Ends the current gesture early, same return as push
+		UserStreamFrames_ptr takeSegment();
+
+		bool isInGesture() { return _isInGesture; };
+		float getEnergy() { return _energy; };
+
+	private:
+		float measureEnergy( const UserStreamFrame &previous, const UserStreamFrame &frame );
+		bool endGesture();
+
+		float _energy;				// Smoothed, meters per second
+		bool _isInGesture;
+		int _framesAbove;			// Consecutive frames above START_ENERGY while idle
+		int _framesBelow;			// Consecutive frames below STOP_ENERGY while in a gesture
+
+		std::deque<UserStreamFrame> _history;	// Lead in kept while idle
+		std::vector<UserStreamFrame> _gesture;	// Frames since the gesture started, lead in included
+		UserStreamFrames_ptr _segment;			// Last completed gesture
+	};
+}
+
+#endif /* USERSTREAMSEGMENTER_H_ */
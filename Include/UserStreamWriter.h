@@ -0,0 +1,71 @@
+/*
+ * UserStreamWriter.h
+ *
+ *  Created on: Oct 21, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Writes a recording to disk while it is being made.
+ *      	Frames are copied into a fixed size queue on the main thread and a background thread encodes them
+ *      	as binary (.dks) or compact JSON streamed through a Json::StreamingWriter, so memory stays constant and stopping never waits on the disk.
+ *      	If the disk falls behind and the queue fills up, new frames are dropped rather than stalling the caller.
+ */
+
+#ifndef USERSTREAMWRITER_H_
+#define USERSTREAMWRITER_H_
+
+#include "UserStreamFrame.h"
+#include "UserStreamBinary.h"
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <string>
+#include <vector>
+
+namespace Json { class StreamingWriter; }
+
+namespace relay {
+	class UserStreamWriter {
+	public:
+		enum Format { FORMAT_BINARY, FORMAT_JSON };
+
+		UserStreamWriter( const std::string &aPath, Format aFormat, size_t aQueueSize );
+		virtual ~UserStreamWriter();	// Finishes the file and joins the thread
+
+		bool push( const UserStreamFrame &frame );	// Returns false if the frame was dropped
+		void stop();								// Returns immediately, the thread finishes the file
+
+		bool isFinished() { return _isFinished; };
+		uint32_t getFramesWritten() { return _framesWritten; };
+		uint32_t getFramesDropped() { return _framesDropped; };
+
+	private:
+		void run();
+		bool openFile();
+		void writeFrame( UserStreamFrame &frame );
+		void closeFile();
+
+		std::string _path;
+		Format _format;
+
+		// Ring buffer shared with the thread, guarded by _mutex
+		std::vector<UserStreamFrame> _queue;
+		size_t _head;
+		size_t _count;
+		bool _shouldStop;
+		boost::mutex _mutex;
+		boost::condition_variable _condition;
+
+		boost::thread _thread;
+		volatile bool _isFinished;
+		volatile uint32_t _framesWritten;
+		volatile uint32_t _framesDropped;
+
+		// Only touched by the thread
+		UserStreamBinaryWriter _binaryWriter;
+		int _jsonFd;
+		boost::scoped_ptr<Json::StreamingWriter> _jsonWriter;	// Frames go straight through its buffer to _jsonFd
+	};
+}
+
+#endif /* USERSTREAMWRITER_H_ */
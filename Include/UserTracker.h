@@ -18,6 +18,8 @@
 #include <XnTypes.h>
 
 #include "WuCinderNITE.h"
+#include "SkeletonJointSet.h"
+#include "UserSignatureCache.h"
 
 class UserTracker {
 public:
@@ -32,12 +34,23 @@ public:
 	unsigned int	activeTickTotlerance;
 	ci::Vec3f	activationZone;
 
+	bool wasReidentified(XnUserID nId);	// true if nId was matched to a recently lost user and inherited their state
+
 	float totalDist;
-	float getTotalDist() { return totalDist > 1.5e+05 ? 0 : totalDist; }; // Temp fix to prevent it from taking NaN values into account causing bad readouts
+	float getTotalDist() { return totalDist; }; // Skeletons are sanitized at capture, see SkeletonSanitize.h
+
+	// Joints read by update() - only these are copied out of the shared skeletons while holding the lock,
+	// the rest of update() works on the copy without it. The torso comes from WuCinderNITE::roomSkeletons instead
+	typedef SKELETON::JointSet<
+		JOINT_BIT(XN_SKEL_LEFT_SHOULDER) | JOINT_BIT(XN_SKEL_RIGHT_SHOULDER) |
+		JOINT_BIT(XN_SKEL_LEFT_HAND) | JOINT_BIT(XN_SKEL_RIGHT_HAND) |
+		JOINT_BIT(XN_SKEL_LEFT_KNEE) | JOINT_BIT(XN_SKEL_RIGHT_KNEE)
+	> TrackerJoints;
 
 private:
 	struct UserInfo {
-		UserInfo(XnUserID nId):id(nId),isActive(false),motionAtZeroDuration(0){};
+		UserInfo(XnUserID nId):id(nId),isActive(false),distanceFromActivationZone(0),motionAtZeroDuration(0),
+				isIdentified(false),wasReidentified(false),height(0),lastTrackedTime(-1){};
 		XnUserID	id;
 		bool		isActive;
 		float		distanceFromActivationZone;
@@ -46,6 +59,14 @@ private:
 		ci::Vec3f	shoulderL, handL, kneeL;
 		ci::Vec3f	shoulderR, handR, kneeR;
 		ci::Vec3f	torso;
+		ci::Vec3f	roomTorso;	// torso in floor aligned coordinates, used for the activation zone test
+
+		bool		isIdentified;		// re-identification has been attempted
+		bool		wasReidentified;	// and succeeded
+		float		height;				// head above the floor
+		double		lastTrackedTime;
+
+		SKELETON::SKELETON	skeleton; // snapshot of TrackerJoints taken at the start of update
 
 		bool operator<(const UserInfo& other) {
 //			if (distanceFromActivationZone < 0.25f) {
@@ -62,6 +83,11 @@ private:
 
 	void onNewUser(XnUserID nId);
 	void onLostUser(XnUserID nId);
+	void removeUser(XnUserID nId, bool remember);
+
+	USER_SIGNATURE makeSignature(const UserInfo& user);
+	void reidentify(UserInfo& user, double now);
+	UserSignatureCache	mSignatures;	// recently lost users
 
 	ci::Font	mFont;
 
@@ -72,4 +98,6 @@ private:
 
 };
 
+ASSERT_JOINTS_ARE_CAPTURED(UserTracker::TrackerJoints);
+
 #endif /* USERTRACKER_H_ */
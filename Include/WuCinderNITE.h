@@ -16,6 +16,9 @@
 #include "cinder/gl/Texture.h"
 
 #include "SkeletonStruct.h"
+#include "SkeletonGapFiller.h"
+#include "SkeletonRoomTransform.h"
+#include "SkeletonBodyFrame.h"
 
 #include <boost/thread/thread.hpp>
 #include <boost/shared_ptr.hpp>
@@ -92,8 +95,11 @@ public:
 	 */
 	bool				useSingleCalibrationMode;	// default true
 	bool				waitForTrackingToSingalNewUser;	// default true
+	bool				useGapFilling;	// default true - reconstruct low confidence joints, see SkeletonGapFiller
 
 	SKELETON::SKELETON	skeletons[MAX_USERS];
+	SKELETON::SKELETON	roomSkeletons[MAX_USERS];	// 'skeletons' in floor aligned coordinates, y is height above the floor
+	SKELETON::BODY_FRAME	bodyFrames[MAX_USERS];	// Upper body frame of each user in 'skeletons', see SkeletonBodyFrame
 
 	unsigned short		maxDepth;
 	XnMapOutputMode		mMapMode;
@@ -104,6 +110,8 @@ public:
 	boost::mutex		mMutexImageSurface;
 	ci::Surface8u		mImageSurface;
 
+	const SkeletonRoomTransform& getRoomTransform() { return mRoomTransform; };
+	SkeletonGapFiller& getGapFiller(XnUserID nId) { return mGapFillers[nId]; };	// Lock mMutex while using it
 	bool isThreaded() { return mThread != NULL; }
 	bool hasColorImage() { return mUseColorImage; };
 
@@ -124,6 +132,7 @@ protected:
 
 	bool				mNeedPoseForCalibration;
 	bool				mIsCalibrated;
+	bool				mIsCalibrationFileCached;	// mCalibrationFile has been read into calibration slot 0
 	bool				mUseColorImage;
 	bool				mUseDepthMap;
 	std::string			mCalibrationFile;
@@ -142,6 +151,9 @@ protected:
 	ci::Surface8u		mDepthSurface;
 	float 				mDepthHistogram[MAX_DEPTH];
 
+	SkeletonGapFiller	mGapFillers[MAX_USERS];	// One per user slot, reset whenever the slot changes hands
+	SkeletonRoomTransform	mRoomTransform;	// Rebuilt from mFloor every update
+
 	XnChar				mCalibrationPose[20];
 	XnCallbackHandle	hUserCBs, hCalibrationPhasesCBs, hCalibrationCompleteCBs, hPoseCBs;
 
@@ -19,10 +19,24 @@
 /// Only has effects if JSON_VALUE_USE_INTERNAL_MAP is defined.
 //#  define JSON_USE_SIMPLE_INTERNAL_ALLOCATOR 1
 
+/// If defined, objects and arrays are stored as flat sorted blocks instead of std::map,
+/// and member names are interned in one process wide table (they are never released).
+/// Lookups by member name then compare pointers. Inserting a member invalidates references
+/// to the other members of that object, so code such as obj["b"] = obj["a"] reads a
+/// moved or freed member. Only define it for code known not to hold on to one across an insertion.
+//# define JSON_USE_FLAT_OBJECTS 1
+
 /// If defined, indicates that Json use exception to report invalid type manipulation
 /// instead of C assert macro.
 # define JSON_USE_EXCEPTION 1
 
+/// Storage class for per thread state (the current ValueArena).
+# if defined(_MSC_VER)
+#  define JSON_THREAD_LOCAL __declspec(thread)
+# else
+#  define JSON_THREAD_LOCAL __thread
+# endif
+
 # ifdef JSON_IN_CPPTL
 #  include <cpptl/config.h>
 #  ifndef JSON_USE_CPPTL
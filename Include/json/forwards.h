@@ -19,6 +19,7 @@ namespace Json {
    typedef int Int;
    typedef unsigned int UInt;
    class StaticString;
+   class ValueArena;
    class Path;
    class PathArgument;
    class Value;
@@ -44,7 +44,11 @@ namespace Json {
                   bool collectComments = true );
 
       /** \brief Read a Value from a <a HREF="http://www.json.org">JSON</a> document.
-       * \param document UTF-8 encoded string containing the document to read.
+       *
+       * The document is read in place, without a copy, so it can be a mapped file.
+       * It must outlive the call to getFormatedErrorMessages(), which points into it.
+       * \param beginDoc Pointer on the beginning of the UTF-8 encoded string of the document to read.
+       * \param endDoc Pointer on the end of the UTF-8 encoded string of the document to read.
        * \param root [out] Contains the root value of the document if it was
        *             successfully parsed.
        * \param collectComments \c true to collect comment and allow writing them back during
@@ -165,6 +169,15 @@ namespace Json {
       bool collectComments_;
    };
 
+   /** \brief Converts the number in [begin, end) to the nearest double.
+    *
+    * Does not depend on the C locale and needs no zero terminated copy, so
+    * it can read numbers in place. Accepts an optional sign, digits with an
+    * optional fraction, and an optional exponent.
+    * \return \c false, leaving value unchanged, if [begin, end) is not entirely a number.
+    */
+   bool JSON_API charsToDouble( const char *begin, const char *end, double &value );
+
    /** \brief Read from 'sin' into 'root'.
 
     Always keep comments from the input JSON.
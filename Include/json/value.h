@@ -4,6 +4,8 @@
 # include "forwards.h"
 # include <string>
 # include <vector>
+# include <cstddef>
+# include <new>
 
 # ifndef JSON_USE_CPPTL_SMALLMAP
 #  include <map>
@@ -81,6 +83,168 @@ namespace Json {
       const char *str_;
    };
 
+   /** \brief Bump allocator owning the nodes, member names and strings of whole documents.
+    *
+    * While a ValueArena::Scope is alive on a thread, every object, array, member name and
+    * string created on that thread is carved out of the arena instead of being allocated
+    * one by one, and releasing them is a no-op. The memory is handed back in one shot when
+    * the arena is destroyed, so the arena must outlive every value built in it.
+    * Copying a value outside of the scope copies it out of the arena.
+    * Members added to a container, and values assigned to them, come from the container's
+    * own arena, or the heap, whichever scope is current: a document built outside of the
+    * scope can be changed inside of it and outlive the arena.
+    *
+    * Example of usage:
+    * \code
+    * Json::ValueArena arena;
+    * Json::Value root;
+    * {
+    *    Json::ValueArena::Scope scope( arena );
+    *    reader.parse( document, root );
+    * }
+    * \endcode
+    */
+   class JSON_API ValueArena
+   {
+   public:
+      enum { defaultChunkSize = 64 * 1024 };
+
+      /// Makes an arena current on this thread until the scope ends. Scopes nest.
+      class JSON_API Scope
+      {
+      public:
+         explicit Scope( ValueArena &arena );
+         ~Scope();
+      private:
+         Scope( const Scope & );
+         Scope &operator =( const Scope & );
+         ValueArena *previous_;
+      };
+
+      explicit ValueArena( size_t chunkSize = defaultChunkSize );
+      ~ValueArena();
+
+      void *allocate( size_t size );
+      char *duplicate( const char *value, unsigned int length );
+
+      /// Bytes handed out, and bytes reserved from the heap to hand them out.
+      size_t allocatedBytes() const;
+      size_t reservedBytes() const;
+
+      /// The arena of the innermost Scope on this thread, 0 if there is none.
+      static ValueArena *current();
+
+   private:
+      ValueArena( const ValueArena & );
+      ValueArena &operator =( const ValueArena & );
+
+      struct Chunk
+      {
+         Chunk *next_;
+         size_t size_;
+      };
+
+      Chunk *chunks_;
+      char *cursor_;
+      char *end_;
+      size_t chunkSize_;
+      size_t allocatedBytes_;
+      size_t reservedBytes_;
+   };
+
+   /** \brief STL allocator for the containers inside Value.
+    *
+    * Allocates from the arena it was created with, or from the heap without one.
+    * Containers are given the arena that was current when their value was created.
+    */
+   template<typename T>
+   class ArenaAllocator
+   {
+   public:
+      typedef T value_type;
+      typedef T *pointer;
+      typedef const T *const_pointer;
+      typedef T &reference;
+      typedef const T &const_reference;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+
+      template<typename U>
+      struct rebind
+      {
+         typedef ArenaAllocator<U> other;
+      };
+
+      ArenaAllocator( ValueArena *arena = 0 )
+         : arena_( arena )
+      {
+      }
+
+      template<typename U>
+      ArenaAllocator( const ArenaAllocator<U> &other )
+         : arena_( other.arena() )
+      {
+      }
+
+      pointer allocate( size_type count, const void * = 0 )
+      {
+         if ( arena_ )
+            return static_cast<pointer>( arena_->allocate( count * sizeof(T) ) );
+         return static_cast<pointer>( ::operator new( count * sizeof(T) ) );
+      }
+
+      void deallocate( pointer p, size_type )
+      {
+         if ( !arena_ )
+            ::operator delete( p );
+      }
+
+      void construct( pointer p, const T &value )
+      {
+         new ( static_cast<void *>( p ) ) T( value );
+      }
+
+      void destroy( pointer p )
+      {
+         p->~T();
+      }
+
+      pointer address( reference value ) const
+      {
+         return &value;
+      }
+
+      const_pointer address( const_reference value ) const
+      {
+         return &value;
+      }
+
+      size_type max_size() const
+      {
+         return size_type(-1) / sizeof(T);
+      }
+
+      ValueArena *arena() const
+      {
+         return arena_;
+      }
+
+   private:
+      ValueArena *arena_;
+   };
+
+   template<typename T, typename U>
+   inline bool operator ==( const ArenaAllocator<T> &a, const ArenaAllocator<U> &b )
+   {
+      return a.arena() == b.arena();
+   }
+
+   template<typename T, typename U>
+   inline bool operator !=( const ArenaAllocator<T> &a, const ArenaAllocator<U> &b )
+   {
+      return a.arena() != b.arena();
+   }
+
    /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
     *
     * This class is a discriminated union wrapper that can represents a:
@@ -138,7 +302,8 @@ namespace Json {
          {
             noDuplication = 0,
             duplicate,
-            duplicateOnCopy
+            duplicateOnCopy,
+            duplicateInArena     ///< Owned by a ValueArena, duplicated on copy but never released
          };
          CZString( int index );
          CZString( const char *cstr, DuplicationPolicy allocate );
@@ -157,8 +322,60 @@ namespace Json {
       };
 
    public:
-#  ifndef JSON_USE_CPPTL_SMALLMAP
-      typedef std::map<CZString, Value> ObjectValues;
+#  if defined(JSON_USE_FLAT_OBJECTS)
+      /** \brief Members or elements kept sorted in one contiguous block.
+       *
+       * Implements the part of the std::map interface Value relies on. Elements are
+       * relocated with memcpy when the block grows, CZString and Value never point
+       * into themselves so this is safe. Unlike std::map, inserting a member
+       * invalidates references to the other members of the same object.
+       */
+      class ObjectValues
+      {
+      public:
+         typedef std::pair<CZString, Value> value_type;
+         typedef value_type *iterator;
+         typedef const value_type *const_iterator;
+         typedef std::less<CZString> key_compare;
+         typedef ArenaAllocator<value_type> allocator_type;
+         typedef size_t size_type;
+
+         ObjectValues( const key_compare &compare = key_compare(),
+                       const allocator_type &allocator = allocator_type() );
+         ~ObjectValues();
+
+         iterator begin() { return data_; }
+         iterator end() { return data_ + size_; }
+         const_iterator begin() const { return data_; }
+         const_iterator end() const { return data_ + size_; }
+         size_type size() const { return size_; }
+         bool empty() const { return size_ == 0; }
+         allocator_type get_allocator() const { return allocator_type( arena_ ); }
+
+         void clear();
+         iterator find( const CZString &key );
+         const_iterator find( const CZString &key ) const;
+         iterator lower_bound( const CZString &key );
+         iterator insert( iterator position, const value_type &value );
+         void insert( const_iterator first, const_iterator last );   ///< Appends, [first, last) must sort after every element
+         void erase( iterator position );
+         size_type erase( const CZString &key );
+
+         bool operator ==( const ObjectValues &other ) const;
+         bool operator <( const ObjectValues &other ) const;
+
+      private:
+         ObjectValues( const ObjectValues & );
+         ObjectValues &operator =( const ObjectValues & );
+         void reserve( size_type capacity );
+
+         value_type *data_;
+         size_type size_;
+         size_type capacity_;
+         ValueArena *arena_;
+      };
+#  elif !defined(JSON_USE_CPPTL_SMALLMAP)
+      typedef std::map<CZString, Value, std::less<CZString>, ArenaAllocator< std::pair<const CZString, Value> > > ObjectValues;
 #  else
       typedef CppTL::SmallMap<CZString, Value> ObjectValues;
 #  endif // ifndef JSON_USE_CPPTL_SMALLMAP
@@ -438,6 +655,7 @@ namespace Json {
       } value_;
       ValueType type_ : 8;
       int allocated_ : 1;     // Notes: if declared as bool, bitfield is useless.
+      unsigned int heapOwned_ : 1;       // element of a heap container, never takes memory from an arena.
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
       unsigned int itemIsUsed_ : 1;      // used by the ValueInternalMap container.
       int memberNameIsStatic_ : 1;       // used by the ValueInternalMap container.
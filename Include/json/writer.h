@@ -157,6 +157,110 @@ namespace Json {
       bool addChildValues_;
    };
 
+   /** \brief Writes <a HREF="http://www.json.org">JSON</a> to a file descriptor as it is produced,
+    *         without building a Value or a std::string of the document.
+    *
+    * Output goes through a fixed size buffer and write(), so memory stays bounded
+    * however large the document grows. Calls must nest the way the document does:
+    * \code
+    * Json::StreamingWriter writer( fd );
+    * writer.beginObject();
+    * writer.key( "root" );
+    * writer.beginArray();
+    * writer.value( 1.5 );
+    * writer.endArray();
+    * writer.endObject();
+    * if ( !writer.flush() )
+    *    // the disk is full, or the descriptor was closed
+    * \endcode
+    * The compact style produces the same text as FastWriter. The pretty style
+    * puts every member and element on its own line, indented like StyledWriter.
+    * The file descriptor is not closed by the writer.
+    */
+   class JSON_API StreamingWriter
+   {
+   public:
+      enum Style
+      {
+         compact = 0,
+         pretty
+      };
+
+      StreamingWriter( int fd, 
+                       Style style = compact, 
+                       unsigned int bufferSize = 64 * 1024 );
+      /// Flushes whatever is still buffered.
+      ~StreamingWriter();
+
+      void beginObject();
+      void endObject();
+      void beginArray();
+      void endArray();
+
+      /// Name of the next member, inside an object only.
+      void key( const char *name );
+      void key( const std::string &name );
+
+      void value( Int value );
+      void value( UInt value );
+      void value( double value );
+      void value( bool value );
+      void value( const char *value );
+      void value( const std::string &value );
+      void null();
+      /// Streams a whole Value, walking its members in place.
+      void value( const Value &root );
+
+      /// Writes the buffered output.
+      /// \return \c false if this or any earlier write failed.
+      bool flush();
+      bool good() const;
+
+   private:
+      StreamingWriter( const StreamingWriter & );
+      StreamingWriter &operator =( const StreamingWriter & );
+
+      struct Scope
+      {
+         bool isObject_;
+         bool isEmpty_;
+      };
+      typedef std::vector<Scope> Scopes;
+
+      void beginValue();
+      void endValue();
+      void open( char bracket, bool isObject );
+      void close( char bracket, bool isObject );
+      void writeNewLine();
+      void writeQuoted( const char *text );
+      void write( const char *text, size_t length );
+      void write( char c );
+      void writeToFd( const char *data, size_t length );
+      char *reserve( size_t length );
+
+      Scopes scopes_;
+      std::vector<char> buffer_;
+      size_t used_;
+      int fd_;
+      Style style_;
+      bool hasKey_;
+      bool failed_;
+   };
+
+   /// Size of a buffer that fits any valueToChars() output, terminating zero included.
+   enum { valueToCharsBufferSize = 32 };
+
+   /** \brief Writes the JSON form of value at buffer, zero terminated, without allocating.
+    *
+    * Doubles are written with the shortest digits that read back to the same double,
+    * and always with a '.' or an exponent so they read back as realValue.
+    * \param buffer At least #valueToCharsBufferSize chars.
+    * \return Pointer to the terminating zero.
+    */
+   char JSON_API *valueToChars( Int value, char *buffer );
+   char JSON_API *valueToChars( UInt value, char *buffer );
+   char JSON_API *valueToChars( double value, char *buffer );
+
    std::string JSON_API valueToString( Int value );
    std::string JSON_API valueToString( UInt value );
    std::string JSON_API valueToString( double value );
@@ -1,10 +1,14 @@
 #include <json/reader.h>
 #include <json/value.h>
 #include <utility>
+#include <algorithm>
+#include <clocale>
 #include <cstdio>
+#include <cstdlib>
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
 #if _MSC_VER >= 1400 // VC++ 8.0
@@ -103,6 +107,256 @@ static std::string codePointToUTF8(unsigned int cp)
 }
 
 
+// Decimal to double conversion
+// //////////////////////////////////////////////////////////////////
+// Eisel-Lemire, from Daniel Lemire, "Number Parsing at a Gigabyte per
+// Second" (2021): a decimal mantissa of up to 19 digits times a 128 bits
+// approximation of 5^q settles the correctly rounded double with integer
+// arithmetic. Decimals with more digits, or the very rare products that
+// are too close to call, go through strtod.
+
+# include "json_powersoffive.inl"
+
+typedef unsigned long long UInt64Bits;
+
+static const UInt64Bits doubleHiddenBit = 0x0010000000000000ULL;
+static const UInt64Bits doubleInfinityBits = 0x7FF0000000000000ULL;
+static const UInt64Bits doubleSignBit = 0x8000000000000000ULL;
+static const int maxMantissaDigits = 19;   // 10^19 - 1 < 2^64
+
+// Exactly representable powers of ten, for the single operation fast path.
+static const double exactPowersOfTen[] = {
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const int maxExactPowerOfTen = 22;
+
+
+static void multiplyFull( UInt64Bits a, UInt64Bits b, UInt64Bits &high, UInt64Bits &low )
+{
+#if defined(__SIZEOF_INT128__)
+   __extension__ typedef unsigned __int128 UInt128Bits;
+   UInt128Bits product = UInt128Bits( a ) * b;
+   high = UInt64Bits( product >> 64 );
+   low = UInt64Bits( product );
+#else
+   const UInt64Bits mask32 = 0xFFFFFFFFULL;
+   UInt64Bits ll = ( a & mask32 ) * ( b & mask32 );
+   UInt64Bits lh = ( a & mask32 ) * ( b >> 32 );
+   UInt64Bits hl = ( a >> 32 ) * ( b & mask32 );
+   UInt64Bits hh = ( a >> 32 ) * ( b >> 32 );
+   UInt64Bits middle = ( ll >> 32 ) + ( lh & mask32 ) + hl;   // can not overflow
+   low = ( middle << 32 ) | ( ll & mask32 );
+   high = hh + ( middle >> 32 ) + ( lh >> 32 );
+#endif
+}
+
+
+static int leadingZeros( UInt64Bits value )
+{
+#if defined(__GNUC__)
+   return __builtin_clzll( value );
+#else
+   int count = 0;
+   while ( !( value & doubleSignBit ) )
+   {
+      value <<= 1;
+      ++count;
+   }
+   return count;
+#endif
+}
+
+
+// Bits of the double nearest to w * 10^q, for w != 0. Returns false when
+// the truncated 5^q leaves the rounding undecided.
+static bool eiselLemire( UInt64Bits w, int q, UInt64Bits &bits )
+{
+   if ( q < smallestPowerOfFive )
+   {
+      bits = 0;
+      return true;
+   }
+   if ( q > largestPowerOfFive )
+   {
+      bits = doubleInfinityBits;
+      return true;
+   }
+
+   const int zeros = leadingZeros( w );
+   w <<= zeros;
+   const UInt64Bits *power = powersOfFive[q - smallestPowerOfFive];
+   UInt64Bits high, low;
+   multiplyFull( w, power[0], high, low );
+   if ( ( high & 0x1FF ) == 0x1FF )
+   {
+      // The 9 bits below the 55 kept are all ones, a carry from the low word may reach them
+      UInt64Bits secondHigh, secondLow;
+      multiplyFull( w, power[1], secondHigh, secondLow );
+      low += secondHigh;
+      if ( secondHigh > low )
+         ++high;
+   }
+   // 5^q is exact for q in [0, 55] and its reciprocal exact enough for q in [-27, 0)
+   if ( low == ~UInt64Bits( 0 )  &&  ( q < -27  ||  q > 55 ) )
+      return false;
+
+   const int upperBit = int( high >> 63 );
+   const int shift = upperBit + 9;
+   UInt64Bits mantissa = high >> shift;
+   int exponent = ( ( ( 152170 + 65536 ) * q ) >> 16 ) + 63 + upperBit - zeros + 1023;   // floor(q * log2(10))
+
+   if ( exponent <= 0 )
+   {
+      // Denormal, which may still round up to the smallest normal
+      if ( 1 - exponent >= 64 )
+      {
+         bits = 0;
+         return true;
+      }
+      mantissa >>= 1 - exponent;
+      mantissa += mantissa & 1;
+      mantissa >>= 1;
+      exponent = mantissa < doubleHiddenBit ? 0 : 1;
+      bits = ( UInt64Bits( exponent ) << 52 ) | ( mantissa & ( doubleHiddenBit - 1 ) );
+      return true;
+   }
+
+   // Only these powers of ten can make w * 10^q fall exactly half way; round to even
+   if ( low <= 1  &&  q >= -4  &&  q <= 23  &&  ( mantissa & 3 ) == 1  &&  ( mantissa << shift ) == high )
+      mantissa &= ~UInt64Bits( 1 );
+   mantissa += mantissa & 1;
+   mantissa >>= 1;
+   if ( mantissa >= ( doubleHiddenBit << 1 ) )
+   {
+      mantissa = doubleHiddenBit;
+      ++exponent;
+   }
+   if ( exponent >= 0x7FF )
+   {
+      bits = doubleInfinityBits;
+      return true;
+   }
+   bits = ( UInt64Bits( exponent ) << 52 ) | ( mantissa & ( doubleHiddenBit - 1 ) );
+   return true;
+}
+
+
+// strtod reads the C locale's decimal point, so '.' is swapped for it first.
+static double decodeDecimalWithStrtod( const char *begin, const char *end )
+{
+   std::string number( begin, end );
+   const char decimalPoint = *localeconv()->decimal_point;
+   if ( decimalPoint != '.' )
+      std::replace( number.begin(), number.end(), '.', decimalPoint );
+   return strtod( number.c_str(), 0 );
+}
+
+
+bool 
+charsToDouble( const char *begin, const char *end, double &value )
+{
+   const char *current = begin;
+   bool isNegative = false;
+   if ( current != end  &&  ( *current == '-'  ||  *current == '+' ) )
+      isNegative = *current++ == '-';
+
+   // The first 19 significant digits go into mantissa, the others only
+   // mark it as truncated.
+   UInt64Bits mantissa = 0;
+   int digits = 0;
+   int exponent = 0;
+   bool hasDigits = false;
+   bool isTruncated = false;
+   for ( ; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current )
+   {
+      hasDigits = true;
+      if ( digits < maxMantissaDigits )
+      {
+         mantissa = mantissa * 10 + UInt64Bits( *current - '0' );
+         if ( mantissa )
+            ++digits;
+      }
+      else
+      {
+         ++exponent;
+         isTruncated = isTruncated  ||  *current != '0';
+      }
+   }
+   if ( current != end  &&  *current == '.' )
+   {
+      for ( ++current; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current )
+      {
+         hasDigits = true;
+         if ( digits < maxMantissaDigits )
+         {
+            mantissa = mantissa * 10 + UInt64Bits( *current - '0' );
+            if ( mantissa )
+               ++digits;
+            --exponent;
+         }
+         else
+            isTruncated = isTruncated  ||  *current != '0';
+      }
+   }
+   if ( !hasDigits )
+      return false;
+   if ( current != end  &&  ( *current == 'e'  ||  *current == 'E' ) )
+   {
+      ++current;
+      bool isExponentNegative = false;
+      if ( current != end  &&  ( *current == '-'  ||  *current == '+' ) )
+         isExponentNegative = *current++ == '-';
+      if ( current == end  ||  *current < '0'  ||  *current > '9' )
+         return false;
+      int explicitExponent = 0;
+      for ( ; current != end  &&  *current >= '0'  &&  *current <= '9'; ++current )
+      {
+         if ( explicitExponent < 100000 )   // far past the double range either way
+            explicitExponent = explicitExponent * 10 + ( *current - '0' );
+      }
+      exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+   }
+   if ( current != end )
+      return false;
+
+   if ( mantissa == 0 )
+   {
+      value = isNegative ? -0.0 : 0.0;
+      return true;
+   }
+
+   // A single correctly rounded operation when both operands are exact
+   if ( !isTruncated  &&  mantissa <= ( doubleHiddenBit << 1 )
+        &&  exponent >= -maxExactPowerOfTen  &&  exponent <= maxExactPowerOfTen )
+   {
+      value = double( mantissa );
+      value = exponent < 0 ? value / exactPowersOfTen[-exponent] : value * exactPowersOfTen[exponent];
+      if ( isNegative )
+         value = -value;
+      return true;
+   }
+
+   UInt64Bits bits;
+   bool isDecided = eiselLemire( mantissa, exponent, bits );
+   if ( isDecided  &&  isTruncated )
+   {
+      // The exact value lies between mantissa and mantissa + 1
+      UInt64Bits upperBits;
+      isDecided = eiselLemire( mantissa + 1, exponent, upperBits )  &&  upperBits == bits;
+   }
+   if ( !isDecided )
+   {
+      value = decodeDecimalWithStrtod( begin, end );
+      return true;
+   }
+   if ( isNegative )
+      bits |= doubleSignBit;
+   memcpy( &value, &bits, sizeof(value) );
+   return true;
+}
+
+
 // Class Reader
 // //////////////////////////////////////////////////////////////////
 
@@ -135,16 +389,32 @@ Reader::parse( std::istream& sin,
                Value &root,
                bool collectComments )
 {
-   //std::istream_iterator<char> begin(sin);
-   //std::istream_iterator<char> end;
-   // Those would allow streamed input from a file, if parse() were a
-   // template function.
-
-   // Since std::string is reference-counted, this at least does not
-   // create an extra copy.
-   std::string doc;
-   std::getline(sin, doc, (char)EOF);
-   return parse( doc, root, collectComments );
+   // Read straight into document_, which is what parse() runs over, so
+   // the text is copied once. Seekable streams are read in a single block.
+   document_.clear();
+   const std::istream::pos_type unknown( -1 );
+   std::istream::pos_type start = sin.tellg();
+   std::istream::pos_type end = unknown;
+   if ( start != unknown )
+   {
+      sin.seekg( 0, std::ios::end );
+      end = sin.tellg();
+      sin.seekg( start );
+   }
+   if ( start != unknown  &&  end != unknown )
+   {
+      document_.resize( size_t( end - start ) );
+      if ( !document_.empty() )
+         sin.read( &document_[0], document_.size() );
+      document_.resize( size_t( sin.gcount() ) );
+   }
+   else
+   {
+      sin.clear();
+      document_.assign( std::istreambuf_iterator<char>( sin ), std::istreambuf_iterator<char>() );
+   }
+   const char *begin = document_.data();
+   return parse( begin, begin + document_.length(), root, collectComments );
 }
 
 bool 
@@ -481,7 +751,12 @@ Reader::readObject( Token &tokenStart )
 {
    Token tokenName;
    std::string name;
-   currentValue() = Value( objectValue );
+#ifdef JSON_USE_FLAT_OBJECTS
+   std::string previousName;
+   bool hasPrevious = false;
+#endif
+   Value init( objectValue );   // Swapped in rather than assigned, assignment would copy it
+   currentValue().swap( init );
    while ( readToken( tokenName ) )
    {
       bool initialTokenOk = true;
@@ -506,11 +781,23 @@ Reader::readObject( Token &tokenStart )
                                     tokenObjectEnd );
       }
       Value &value = currentValue()[ name ];
+#ifdef JSON_USE_FLAT_OBJECTS
+      // The insertion may have moved the previous member, which comments still attach to
+      if ( collectComments_  &&  hasPrevious )
+         lastValue_ = &currentValue()[ previousName ];
+#endif
       nodes_.push( &value );
       bool ok = readValue();
       nodes_.pop();
       if ( !ok ) // error already set
          return recoverFromError( tokenObjectEnd );
+#ifdef JSON_USE_FLAT_OBJECTS
+      if ( collectComments_ )
+      {
+         previousName = name;
+         hasPrevious = true;
+      }
+#endif
 
       Token comma;
       if ( !readToken( comma )
@@ -538,7 +825,8 @@ Reader::readObject( Token &tokenStart )
 bool 
 Reader::readArray( Token &tokenStart )
 {
-   currentValue() = Value( arrayValue );
+   Value init( arrayValue );
+   currentValue().swap( init );
    skipSpaces();
    if ( *current_ == ']' ) // empty array
    {
@@ -550,6 +838,11 @@ Reader::readArray( Token &tokenStart )
    while ( true )
    {
       Value &value = currentValue()[ index++ ];
+#ifdef JSON_USE_FLAT_OBJECTS
+      // The insertion may have moved the previous element, which comments still attach to
+      if ( collectComments_  &&  index > 1 )
+         lastValue_ = &currentValue()[ index - 2 ];
+#endif
       nodes_.push( &value );
       bool ok = readValue();
       nodes_.pop();
@@ -594,7 +887,7 @@ Reader::decodeNumber( Token &token )
    bool isNegative = *current == '-';
    if ( isNegative )
       ++current;
-   Value::UInt threshold = (isNegative ? Value::UInt(-Value::minInt) 
+   Value::UInt threshold = (isNegative ? Value::UInt(Value::maxInt) + 1 
                                        : Value::maxUInt) / 10;
    Value::UInt value = 0;
    while ( current < token.end_ )
@@ -619,24 +912,8 @@ Reader::decodeNumber( Token &token )
 bool 
 Reader::decodeDouble( Token &token )
 {
-   double value = 0;
-   const int bufferSize = 32;
-   int count;
-   int length = int(token.end_ - token.start_);
-   if ( length <= bufferSize )
-   {
-      Char buffer[bufferSize];
-      memcpy( buffer, token.start_, length );
-      buffer[length] = 0;
-      count = sscanf( buffer, "%lf", &value );
-   }
-   else
-   {
-      std::string buffer( token.start_, token.end_ );
-      count = sscanf( buffer.c_str(), "%lf", &value );
-   }
-
-   if ( count != 1 )
+   double value;
+   if ( !charsToDouble( token.start_, token.end_, value ) )
       return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
    currentValue() = value;
    return true;
@@ -649,7 +926,8 @@ Reader::decodeString( Token &token )
    std::string decoded;
    if ( !decodeString( token, decoded ) )
       return false;
-   currentValue() = decoded;
+   Value decodedValue( decoded );
+   currentValue().swap( decodedValue );
    return true;
 }
 
@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 #ifdef JSON_USE_CPPTL
 # include <cpptl/conststring.h>
 #endif
@@ -111,6 +112,171 @@ static struct DummyValueAllocatorInitializer {
 
 
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+static JSON_THREAD_LOCAL ValueArena *currentArena = 0;
+
+ValueArena::Scope::Scope( ValueArena &arena )
+   : previous_( currentArena )
+{
+   currentArena = &arena;
+}
+
+ValueArena::Scope::~Scope()
+{
+   currentArena = previous_;
+}
+
+ValueArena::ValueArena( size_t chunkSize )
+   : chunks_( 0 )
+   , cursor_( 0 )
+   , end_( 0 )
+   , chunkSize_( chunkSize )
+   , allocatedBytes_( 0 )
+   , reservedBytes_( 0 )
+{
+}
+
+// Makes an arena current, or none, while building values that belong to a given container
+class ScopedArena
+{
+public:
+   explicit ScopedArena( ValueArena *arena )
+      : previous_( currentArena )
+   {
+      currentArena = arena;
+   }
+
+   ~ScopedArena()
+   {
+      currentArena = previous_;
+   }
+
+private:
+   ValueArena *previous_;
+};
+
+ValueArena::~ValueArena()
+{
+   while ( chunks_ )
+   {
+      Chunk *next = chunks_->next_;
+      free( chunks_ );
+      chunks_ = next;
+   }
+}
+
+void *
+ValueArena::allocate( size_t size )
+{
+   const size_t alignment = sizeof(double);
+   size = ( size + alignment - 1 ) & ~( alignment - 1 );
+
+   if ( size > size_t( end_ - cursor_ ) )
+   {
+      // Oversized requests get a chunk of their own, the current one keeps its free space
+      const size_t headerSize = ( sizeof(Chunk) + alignment - 1 ) & ~( alignment - 1 );
+      size_t chunkSize = size > chunkSize_ / 4 ? size : chunkSize_;
+      Chunk *chunk = static_cast<Chunk *>( malloc( headerSize + chunkSize ) );
+      if ( !chunk )
+         throw std::bad_alloc();
+      chunk->size_ = headerSize + chunkSize;
+      chunk->next_ = chunks_;
+      chunks_ = chunk;
+      reservedBytes_ += chunk->size_;
+
+      char *data = reinterpret_cast<char *>( chunk ) + headerSize;
+      if ( chunkSize != chunkSize_ )
+      {
+         allocatedBytes_ += size;
+         return data;
+      }
+      cursor_ = data;
+      end_ = data + chunkSize;
+   }
+
+   void *block = cursor_;
+   cursor_ += size;
+   allocatedBytes_ += size;
+   return block;
+}
+
+char *
+ValueArena::duplicate( const char *value, unsigned int length )
+{
+   char *newString = static_cast<char *>( allocate( length + 1 ) );
+   memcpy( newString, value, length );
+   newString[length] = 0;
+   return newString;
+}
+
+size_t
+ValueArena::allocatedBytes() const
+{
+   return allocatedBytes_;
+}
+
+size_t
+ValueArena::reservedBytes() const
+{
+   return reservedBytes_;
+}
+
+ValueArena *
+ValueArena::current()
+{
+   return currentArena;
+}
+
+
+// Strings and containers of values created inside a ValueArena::Scope come from the arena
+static char *
+duplicateStringValue( const char *value, unsigned int length = ValueAllocator::unknown )
+{
+   ValueArena *arena = ValueArena::current();
+   if ( !arena )
+      return valueAllocator()->duplicateStringValue( value, length );
+   if ( length == ValueAllocator::unknown )
+      length = (unsigned int)strlen( value );
+   return arena->duplicate( value, length );
+}
+
+# ifndef JSON_VALUE_USE_INTERNAL_MAP
+static Value::ObjectValues *
+newObjectValues()
+{
+   ValueArena *arena = ValueArena::current();
+   Value::ObjectValues::allocator_type allocator( arena );
+   if ( arena )
+      return new ( arena->allocate( sizeof(Value::ObjectValues) ) ) Value::ObjectValues( Value::ObjectValues::key_compare(), allocator );
+   return new Value::ObjectValues( Value::ObjectValues::key_compare(), allocator );
+}
+
+template<typename T>
+static inline void
+destruct( T *object )
+{
+   object->~T();
+}
+
+static void
+deleteObjectValues( Value::ObjectValues *values )
+{
+   if ( values->get_allocator().arena() )
+      destruct( values );
+   else
+      delete values;
+}
+# endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
+
+
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -159,6 +325,130 @@ Value::CommentInfo::setComment( const char *text )
 }
 
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// Member name interning
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+# ifdef JSON_USE_FLAT_OBJECTS
+
+// Every member name is stored once for the life of the process, so two names are
+// equal exactly when their pointers are. Open addressing, guarded by a spin lock
+// since values may be built on several threads.
+static const char **internTable = 0;
+static size_t internCapacity = 0;
+static size_t internCount = 0;
+static volatile long internLock = 0;
+
+// Stands in for a name that was never interned, so no member can match it
+static const char notInterned[] = "";
+
+class InternLock
+{
+public:
+   InternLock()
+   {
+#  if defined(_MSC_VER)
+      while ( _InterlockedExchange( &internLock, 1 ) )
+         ;
+#  else
+      while ( __sync_lock_test_and_set( &internLock, 1 ) )
+         ;
+#  endif
+   }
+
+   ~InternLock()
+   {
+#  if defined(_MSC_VER)
+      _InterlockedExchange( &internLock, 0 );
+#  else
+      __sync_lock_release( &internLock );
+#  endif
+   }
+};
+
+static inline size_t
+hashMemberName( const char *name, size_t length )
+{
+   size_t hash = 2166136261u;
+   for ( size_t index = 0; index < length; ++index )
+      hash = ( hash ^ (unsigned char)name[index] ) * 16777619u;
+   return hash;
+}
+
+// Slot holding 'name', or the empty slot it would go in. Call with the lock held.
+static const char **
+findInternSlot( const char *name, size_t length )
+{
+   size_t mask = internCapacity - 1;
+   size_t slot = hashMemberName( name, length ) & mask;
+   while ( internTable[slot] )
+   {
+      const char *candidate = internTable[slot];
+      if ( strncmp( candidate, name, length ) == 0  &&  candidate[length] == 0 )
+         break;
+      slot = ( slot + 1 ) & mask;
+   }
+   return &internTable[slot];
+}
+
+static void
+growInternTable()
+{
+   const char **oldTable = internTable;
+   size_t oldCapacity = internCapacity;
+
+   internCapacity = oldCapacity ? oldCapacity * 2 : 256;
+   internTable = static_cast<const char **>( calloc( internCapacity, sizeof(const char *) ) );
+   if ( !internTable )
+      throw std::bad_alloc();
+
+   for ( size_t index = 0; index < oldCapacity; ++index )
+   {
+      if ( oldTable[index] )
+         *findInternSlot( oldTable[index], strlen( oldTable[index] ) ) = oldTable[index];
+   }
+   free( oldTable );
+}
+
+// The canonical copy of 'name', added if it isn't interned yet
+static const char *
+internMemberName( const char *name )
+{
+   size_t length = strlen( name );
+   InternLock lock;
+   if ( ( internCount + 1 ) * 2 > internCapacity )
+      growInternTable();
+
+   const char **slot = findInternSlot( name, length );
+   if ( !*slot )
+   {
+      char *copy = static_cast<char *>( malloc( length + 1 ) );
+      if ( !copy )
+         throw std::bad_alloc();
+      memcpy( copy, name, length + 1 );
+      *slot = copy;
+      ++internCount;
+   }
+   return *slot;
+}
+
+// The canonical copy of 'name', or notInterned if no member was ever called that
+static const char *
+findMemberName( const char *name )
+{
+   InternLock lock;
+   if ( !internTable )
+      return notInterned;
+   const char *interned = *findInternSlot( name, strlen( name ) );
+   return interned ? interned : notInterned;
+}
+
+# endif // ifdef JSON_USE_FLAT_OBJECTS
+
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -178,19 +468,35 @@ Value::CZString::CZString( int index )
 }
 
 Value::CZString::CZString( const char *cstr, DuplicationPolicy allocate )
-   : cstr_( allocate == duplicate ? valueAllocator()->makeMemberName(cstr) 
-                                  : cstr )
+   : cstr_( cstr )
    , index_( allocate )
 {
+# ifdef JSON_USE_FLAT_OBJECTS
+   // Interned names are shared and never released, lookups only find existing ones
+   cstr_ = allocate == noDuplication ? findMemberName( cstr ) : internMemberName( cstr );
+   index_ = noDuplication;
+   return;
+# endif
+   if ( allocate == duplicate )
+   {
+      ValueArena *arena = ValueArena::current();
+      cstr_ = arena ? arena->duplicate( cstr, (unsigned int)strlen( cstr ) )
+                    : valueAllocator()->makeMemberName( cstr );
+      index_ = arena ? duplicateInArena : duplicate;
+   }
 }
 
 Value::CZString::CZString( const CZString &other )
-: cstr_( other.index_ != noDuplication &&  other.cstr_ != 0
-                ?  valueAllocator()->makeMemberName( other.cstr_ )
-                : other.cstr_ )
-   , index_( other.cstr_ ? (other.index_ == noDuplication ? noDuplication : duplicate)
-                         : other.index_ )
+   : cstr_( other.cstr_ )
+   , index_( other.index_ )
 {
+   if ( other.cstr_  &&  other.index_ != noDuplication )
+   {
+      ValueArena *arena = ValueArena::current();
+      cstr_ = arena ? arena->duplicate( other.cstr_, (unsigned int)strlen( other.cstr_ ) )
+                    : valueAllocator()->makeMemberName( other.cstr_ );
+      index_ = arena ? duplicateInArena : duplicate;
+   }
 }
 
 Value::CZString::~CZString()
@@ -225,6 +531,10 @@ Value::CZString::operator<( const CZString &other ) const
 bool 
 Value::CZString::operator==( const CZString &other ) const 
 {
+# ifdef JSON_USE_FLAT_OBJECTS
+   if ( cstr_ )
+      return cstr_ == other.cstr_;
+# endif
    if ( cstr_ )
       return strcmp( cstr_, other.cstr_ ) == 0;
    return index_ == other.index_;
@@ -253,6 +563,178 @@ Value::CZString::isStaticString() const
 #endif // ifndef JSON_VALUE_USE_INTERNAL_MAP
 
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::ObjectValues
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+#ifdef JSON_USE_FLAT_OBJECTS
+
+Value::ObjectValues::ObjectValues( const key_compare &, const allocator_type &allocator )
+   : data_( 0 )
+   , size_( 0 )
+   , capacity_( 0 )
+   , arena_( allocator.arena() )
+{
+}
+
+Value::ObjectValues::~ObjectValues()
+{
+   clear();
+   if ( !arena_ )
+      free( data_ );
+}
+
+void 
+Value::ObjectValues::reserve( size_type capacity )
+{
+   if ( capacity <= capacity_ )
+      return;
+
+   value_type *data = static_cast<value_type *>( arena_ ? arena_->allocate( capacity * sizeof(value_type) )
+                                                        : malloc( capacity * sizeof(value_type) ) );
+   if ( !data )
+      throw std::bad_alloc();
+   if ( size_ )
+      memcpy( static_cast<void *>( data ), data_, size_ * sizeof(value_type) );
+   if ( !arena_ )
+      free( data_ );
+   data_ = data;
+   capacity_ = capacity;
+}
+
+void 
+Value::ObjectValues::clear()
+{
+   for ( size_type index = 0; index < size_; ++index )
+      data_[index].~value_type();
+   size_ = 0;
+}
+
+Value::ObjectValues::iterator 
+Value::ObjectValues::find( const CZString &key )
+{
+   iterator it = lower_bound( key );
+   return it != end()  &&  (*it).first == key ? it : end();
+}
+
+Value::ObjectValues::const_iterator 
+Value::ObjectValues::find( const CZString &key ) const
+{
+   return const_cast<ObjectValues *>( this )->find( key );
+}
+
+Value::ObjectValues::iterator 
+Value::ObjectValues::lower_bound( const CZString &key )
+{
+   // Appending elements and names in document order is the common case
+   if ( size_ == 0  ||  data_[size_ - 1].first < key )
+      return end();
+
+   // Objects are small, comparing interned pointers beats a binary search of strcmp
+   if ( key.c_str()  &&  size_ <= 16 )
+   {
+      for ( iterator it = begin(); it != end(); ++it )
+      {
+         if ( (*it).first == key )
+            return it;
+      }
+   }
+
+   size_type first = 0;
+   size_type count = size_;
+   while ( count > 0 )
+   {
+      size_type half = count / 2;
+      if ( data_[first + half].first < key )
+      {
+         first += half + 1;
+         count -= half + 1;
+      }
+      else
+         count = half;
+   }
+   return data_ + first;
+}
+
+Value::ObjectValues::iterator 
+Value::ObjectValues::insert( iterator position, const value_type &value )
+{
+   // 'value' may be one of our own elements, which growing or shifting the block would pull out from under it
+   if ( !std::less<const value_type *>()( &value, data_ )  &&  std::less<const value_type *>()( &value, data_ + size_ ) )
+   {
+      value_type copy( value );
+      return insert( position, copy );
+   }
+
+   // 'position' is a lower_bound hint, it is invalidated by a reallocation
+   size_type index = position - data_;
+   if ( size_ == capacity_ )
+      reserve( capacity_ ? capacity_ * 2 : 4 );
+
+   value_type *slot = data_ + index;
+   if ( index < size_ )
+      memmove( static_cast<void *>( slot + 1 ), slot, ( size_ - index ) * sizeof(value_type) );
+   new ( static_cast<void *>( slot ) ) value_type( value );
+   ++size_;
+   return slot;
+}
+
+void 
+Value::ObjectValues::insert( const_iterator first, const_iterator last )
+{
+   reserve( size_ + ( last - first ) );
+   for ( ; first != last; ++first )
+   {
+      new ( static_cast<void *>( data_ + size_ ) ) value_type( *first );
+      ++size_;
+   }
+}
+
+void 
+Value::ObjectValues::erase( iterator position )
+{
+   position->~value_type();
+   size_type index = position - data_;
+   if ( index + 1 < size_ )
+      memmove( static_cast<void *>( position ), position + 1, ( size_ - index - 1 ) * sizeof(value_type) );
+   --size_;
+}
+
+Value::ObjectValues::size_type 
+Value::ObjectValues::erase( const CZString &key )
+{
+   iterator it = find( key );
+   if ( it == end() )
+      return 0;
+   erase( it );
+   return 1;
+}
+
+bool 
+Value::ObjectValues::operator ==( const ObjectValues &other ) const
+{
+   if ( size_ != other.size_ )
+      return false;
+   for ( size_type index = 0; index < size_; ++index )
+   {
+      if ( !( data_[index].first == other.data_[index].first )  ||  data_[index].second != other.data_[index].second )
+         return false;
+   }
+   return true;
+}
+
+bool 
+Value::ObjectValues::operator <( const ObjectValues &other ) const
+{
+   return std::lexicographical_compare( begin(), end(), other.begin(), other.end() );
+}
+
+#endif // ifdef JSON_USE_FLAT_OBJECTS
+
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -268,6 +750,7 @@ Value::CZString::isStaticString() const
 Value::Value( ValueType type )
    : type_( type )
    , allocated_( 0 )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -290,7 +773,7 @@ Value::Value( ValueType type )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues();
+      value_.map_ = newObjectValues();
       break;
 #else
    case arrayValue:
@@ -311,6 +794,7 @@ Value::Value( ValueType type )
 
 Value::Value( Int value )
    : type_( intValue )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -322,6 +806,7 @@ Value::Value( Int value )
 
 Value::Value( UInt value )
    : type_( uintValue )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -332,6 +817,7 @@ Value::Value( UInt value )
 
 Value::Value( double value )
    : type_( realValue )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -343,12 +829,14 @@ Value::Value( double value )
 Value::Value( const char *value )
    : type_( stringValue )
    , allocated_( true )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( value );
+   value_.string_ = duplicateStringValue( value );
+   allocated_ = !ValueArena::current();
 }
 
 
@@ -356,32 +844,37 @@ Value::Value( const char *beginValue,
               const char *endValue )
    : type_( stringValue )
    , allocated_( true )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( beginValue, 
-                                                            UInt(endValue - beginValue) );
+   value_.string_ = duplicateStringValue( beginValue, 
+                                          UInt(endValue - beginValue) );
+   allocated_ = !ValueArena::current();
 }
 
 
 Value::Value( const std::string &value )
    : type_( stringValue )
    , allocated_( true )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = valueAllocator()->duplicateStringValue( value.c_str(), 
-                                                            (unsigned int)value.length() );
+   value_.string_ = duplicateStringValue( value.c_str(), 
+                                          (unsigned int)value.length() );
+   allocated_ = !ValueArena::current();
 
 }
 
 Value::Value( const StaticString &value )
    : type_( stringValue )
    , allocated_( false )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -395,6 +888,7 @@ Value::Value( const StaticString &value )
 Value::Value( const CppTL::ConstString &value )
    : type_( stringValue )
    , allocated_( true )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -406,6 +900,7 @@ Value::Value( const CppTL::ConstString &value )
 
 Value::Value( bool value )
    : type_( booleanValue )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -417,6 +912,7 @@ Value::Value( bool value )
 
 Value::Value( const Value &other )
    : type_( other.type_ )
+   , heapOwned_( 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
@@ -434,8 +930,8 @@ Value::Value( const Value &other )
    case stringValue:
       if ( other.value_.string_ )
       {
-         value_.string_ = valueAllocator()->duplicateStringValue( other.value_.string_ );
-         allocated_ = true;
+         value_.string_ = duplicateStringValue( other.value_.string_ );
+         allocated_ = !ValueArena::current();
       }
       else
          value_.string_ = 0;
@@ -443,7 +939,14 @@ Value::Value( const Value &other )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues( *other.value_.map_ );
+      // Rebuilt rather than copied, the copy belongs to the current arena rather than to other's
+      value_.map_ = newObjectValues();
+      value_.map_->insert( other.value_.map_->begin(), other.value_.map_->end() );
+      if ( !value_.map_->get_allocator().arena() )
+      {
+         for ( ObjectValues::iterator it = value_.map_->begin(); it != value_.map_->end(); ++it )
+            (*it).second.heapOwned_ = 1;
+      }
       break;
 #else
    case arrayValue:
@@ -486,7 +989,7 @@ Value::~Value()
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      delete value_.map_;
+      deleteObjectValues( value_.map_ );
       break;
 #else
    case arrayValue:
@@ -507,6 +1010,8 @@ Value::~Value()
 Value &
 Value::operator=( const Value &other )
 {
+   // An element of a heap container could outlive the current arena
+   ScopedArena scope( heapOwned_ ? 0 : ValueArena::current() );
    Value temp( other );
    swap( temp );
    return *this;
@@ -983,8 +1488,12 @@ Value::operator[]( UInt index )
    if ( it != value_.map_->end()  &&  (*it).first == key )
       return (*it).second;
 
+   // The new element belongs to this container's arena, or the heap, not to the current one
+   ValueArena *arena = value_.map_->get_allocator().arena();
+   ScopedArena scope( arena );
    ObjectValues::value_type defaultValue( key, null );
    it = value_.map_->insert( it, defaultValue );
+   (*it).second.heapOwned_ = arena ? 0 : 1;
    return (*it).second;
 #else
    return value_.array_->resolveReference( index );
@@ -1026,15 +1535,24 @@ Value::resolveReference( const char *key,
    if ( type_ == nullValue )
       *this = Value( objectValue );
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
+# ifdef JSON_USE_FLAT_OBJECTS
+   (void)isStatic;
+   CZString actualKey( key, CZString::duplicateOnCopy );   // Interned, static or not
+# else
    CZString actualKey( key, isStatic ? CZString::noDuplication 
                                      : CZString::duplicateOnCopy );
+# endif
    ObjectValues::iterator it = value_.map_->lower_bound( actualKey );
    if ( it != value_.map_->end()  &&  (*it).first == actualKey )
       return (*it).second;
 
+   // The new member's name belongs to this container's arena, or the heap, not to the current one
+   ValueArena *arena = value_.map_->get_allocator().arena();
+   ScopedArena scope( arena );
    ObjectValues::value_type defaultValue( actualKey, null );
    it = value_.map_->insert( it, defaultValue );
    Value &value = (*it).second;
+   value.heapOwned_ = arena ? 0 : 1;
    return value;
 #else
    return value_.map_->resolveReference( key, isStatic );
@@ -1117,7 +1635,14 @@ Value::operator[]( const CppTL::ConstString &key ) const
 Value &
 Value::append( const Value &value )
 {
-   return (*this)[size()] = value;
+   // Copied first, 'value' may be an element of this array and adding the new one can move it
+   Value copy( value );
+   Value &element = (*this)[size()];
+   if ( element.heapOwned_  &&  ValueArena::current() )
+      element = copy;   // The copy came from the arena, the element belongs to the heap
+   else
+      element.swap( copy );
+   return element;
 }
 
 
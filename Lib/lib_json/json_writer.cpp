@@ -6,6 +6,12 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <errno.h>
+#if defined(_WIN32)
+# include <io.h>
+#else
+# include <unistd.h>
+#endif
 
 #if _MSC_VER >= 1400 // VC++ 8.0
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
@@ -27,79 +33,390 @@ static bool containsControlCharacter( const char* str )
    }
    return false;
 }
-static void uintToString( unsigned int value, 
+// Decimal digit pairs, so integers are converted two digits per division.
+static const char digitPairs[] =
+   "00010203040506070809"
+   "10111213141516171819"
+   "20212223242526272829"
+   "30313233343536373839"
+   "40414243444546474849"
+   "50515253545556575859"
+   "60616263646566676869"
+   "70717273747576777879"
+   "80818283848586878889"
+   "90919293949596979899";
+
+static void uintToString( unsigned int value,
                           char *&current )
 {
    *--current = 0;
-   do
+   while ( value >= 100 )
+   {
+      const char *pair = digitPairs + ( value % 100 ) * 2;
+      value /= 100;
+      *--current = pair[1];
+      *--current = pair[0];
+   }
+   if ( value >= 10 )
+   {
+      const char *pair = digitPairs + value * 2;
+      *--current = pair[1];
+      *--current = pair[0];
+   }
+   else
+      *--current = char( value ) + '0';
+}
+
+
+// Shortest round-trip double formatting
+// //////////////////////////////////////////////////////////////////
+// Grisu2, from Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers" (PLDI 2010). The digits always read back to the
+// same double, and are the shortest such digits for all but a small fraction
+// of inputs, where they are one digit longer. Only 64 bits integer arithmetic
+// is used, so unlike sprintf the output does not depend on the C locale.
+
+typedef unsigned long long UInt64Bits;
+
+static const UInt64Bits doubleSignificandMask = 0x000FFFFFFFFFFFFFULL;
+static const UInt64Bits doubleExponentMask = 0x7FF0000000000000ULL;
+static const UInt64Bits doubleSignMask = 0x8000000000000000ULL;
+static const UInt64Bits doubleHiddenBit = 0x0010000000000000ULL;
+static const int doubleSignificandSize = 52;
+static const int doubleExponentBias = 0x3FF + doubleSignificandSize;
+
+/// A 64 bits significand and binary exponent: f * 2^e.
+struct DiyFp
+{
+   DiyFp()
+   {
+   }
+
+   DiyFp( UInt64Bits significand, int exponent )
+      : f( significand )
+      , e( exponent )
+   {
+   }
+
+   UInt64Bits f;
+   int e;
+};
+
+static DiyFp diyFpFromBits( UInt64Bits bits )
+{
+   int biasedExponent = int( ( bits & doubleExponentMask ) >> doubleSignificandSize );
+   UInt64Bits significand = bits & doubleSignificandMask;
+   if ( biasedExponent != 0 )
+      return DiyFp( significand + doubleHiddenBit, biasedExponent - doubleExponentBias );
+   return DiyFp( significand, 1 - doubleExponentBias );   // denormal
+}
+
+// Upper 64 bits of the 128 bits product, rounded.
+static DiyFp diyFpMultiply( const DiyFp &a, const DiyFp &b )
+{
+   const UInt64Bits mask32 = 0xFFFFFFFFULL;
+   UInt64Bits ah = a.f >> 32, al = a.f & mask32;
+   UInt64Bits bh = b.f >> 32, bl = b.f & mask32;
+   UInt64Bits hh = ah * bh, lh = al * bh, hl = ah * bl, ll = al * bl;
+   UInt64Bits middle = ( ll >> 32 ) + ( hl & mask32 ) + ( lh & mask32 );
+   middle += 1U << 31;
+   return DiyFp( hh + ( hl >> 32 ) + ( lh >> 32 ) + ( middle >> 32 ), a.e + b.e + 64 );
+}
+
+// Shifts value left until its top bit is set.
+static DiyFp diyFpNormalize( DiyFp value )
+{
+   while ( !( value.f & doubleSignMask ) )
+   {
+      value.f <<= 1;
+      --value.e;
+   }
+   return value;
+}
+
+// The half way points m- and m+ to the neighbouring doubles: every number
+// strictly between them reads back to value. Both share m+'s exponent.
+static void diyFpBoundaries( const DiyFp &value, DiyFp &minus, DiyFp &plus )
+{
+   plus = diyFpNormalize( DiyFp( ( value.f << 1 ) + 1, value.e - 1 ) );
+   if ( value.f == doubleHiddenBit )   // the lower neighbour is closer across a power of two
+      minus = DiyFp( ( value.f << 2 ) - 1, value.e - 2 );
+   else
+      minus = DiyFp( ( value.f << 1 ) - 1, value.e - 1 );
+   minus.f <<= minus.e - plus.e;
+   minus.e = plus.e;
+}
+
+// Normalized 10^k for k = -348, -340, ... 340, rounded to 64 bits.
+static const UInt64Bits cachedPowersSignificand[] = {
+   0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+   0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+   0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+   0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+   0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+   0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+   0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+   0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+   0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+   0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+   0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+   0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+   0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+   0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+   0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+   0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+   0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+   0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+   0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+   0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+   0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+   0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const short cachedPowersExponent[] = {
+   -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+   -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+   -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+   -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+   -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+   109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+   375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+   641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+   907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+// A cached power c = 10^-k that brings the exponent of a product with c into [-60, -32].
+static DiyFp cachedPower( int e, int &k )
+{
+   double dk = ( -61 - e ) * 0.30102999566398114 + 347;   // log10(2)
+   int ik = int( dk );
+   if ( ik != dk )
+      ++ik;
+   unsigned int index = unsigned( ( ik >> 3 ) + 1 );
+   k = -( -348 + int( index << 3 ) );
+   return DiyFp( cachedPowersSignificand[index], cachedPowersExponent[index] );
+}
+
+// Moves the last digit towards w while it stays inside the safe interval.
+static void grisuRound( char *digits, int length, UInt64Bits delta, UInt64Bits rest,
+                        UInt64Bits tenKappa, UInt64Bits distance )
+{
+   while ( rest < distance  &&  delta - rest >= tenKappa  &&
+           ( rest + tenKappa < distance  ||  distance - rest > rest + tenKappa - distance ) )
+   {
+      --digits[length - 1];
+      rest += tenKappa;
+   }
+}
+
+static int countDecimalDigits( unsigned int value )
+{
+   int count = 1;
+   while ( value >= 10 )
    {
-      *--current = (value % 10) + '0';
       value /= 10;
+      ++count;
    }
-   while ( value != 0 );
+   return count;
 }
 
-std::string valueToString( Int value )
+// Generates the digits of mp, stopping as soon as the rest is within delta of it.
+static void grisuDigits( const DiyFp &w, const DiyFp &mp, UInt64Bits delta,
+                         char *digits, int &length, int &k )
+{
+   static const UInt64Bits powersOfTen[] = {
+      1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+      100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+      10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+      100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+   };
+   const DiyFp one( UInt64Bits( 1 ) << -mp.e, mp.e );
+   const UInt64Bits distance = mp.f - w.f;
+   unsigned int integral = unsigned( mp.f >> -one.e );
+   UInt64Bits fractional = mp.f & ( one.f - 1 );
+   int kappa = countDecimalDigits( integral );
+   length = 0;
+
+   while ( kappa > 0 )
+   {
+      unsigned int divisor = unsigned( powersOfTen[kappa - 1] );
+      unsigned int digit = integral / divisor;
+      integral %= divisor;
+      if ( digit  ||  length )
+         digits[length++] = char( '0' + digit );
+      --kappa;
+      UInt64Bits rest = ( UInt64Bits( integral ) << -one.e ) + fractional;
+      if ( rest <= delta )
+      {
+         k += kappa;
+         grisuRound( digits, length, delta, rest, powersOfTen[kappa] << -one.e, distance );
+         return;
+      }
+   }
+
+   while ( true )
+   {
+      fractional *= 10;
+      delta *= 10;
+      char digit = char( fractional >> -one.e );
+      if ( digit  ||  length )
+         digits[length++] = char( '0' + digit );
+      fractional &= one.f - 1;
+      --kappa;
+      if ( fractional < delta )
+      {
+         k += kappa;
+         grisuRound( digits, length, delta, fractional, one.f,
+                     -kappa < 20 ? distance * powersOfTen[-kappa] : 0 );
+         return;
+      }
+   }
+}
+
+// Writes the digits of a positive, finite, non zero double, value = digits * 10^k.
+static void grisu2( UInt64Bits bits, char *digits, int &length, int &k )
 {
-   char buffer[32];
-   char *current = buffer + sizeof(buffer);
-   bool isNegative = value < 0;
-   if ( isNegative )
-      value = -value;
-   uintToString( UInt(value), current );
-   if ( isNegative )
-      *--current = '-';
-   assert( current >= buffer );
+   const DiyFp v = diyFpFromBits( bits );
+   DiyFp minus, plus;
+   diyFpBoundaries( v, minus, plus );
+   const DiyFp c = cachedPower( plus.e, k );
+   const DiyFp w = diyFpMultiply( diyFpNormalize( v ), c );
+   DiyFp wPlus = diyFpMultiply( plus, c );
+   DiyFp wMinus = diyFpMultiply( minus, c );
+   ++wMinus.f;
+   --wPlus.f;
+   grisuDigits( w, wPlus, wPlus.f - wMinus.f, digits, length, k );
+}
+
+// Lays out the digits * 10^k held at the start of buffer. Values in
+// [1e-4, 1e17) are written in fixed notation with at least one decimal,
+// as the writer always did, the others with an exponent.
+static char *formatDecimal( char *buffer, int length, int k )
+{
+   const int point = length + k;   // 10^(point-1) <= value < 10^point
+   if ( k >= 0  &&  point <= 17 )
+   {
+      // 1234e2 -> 123400.0
+      memset( buffer + length, '0', k );
+      buffer[point] = '.';
+      buffer[point + 1] = '0';
+      return buffer + point + 2;
+   }
+   if ( 0 < point  &&  point <= 17 )
+   {
+      // 1234e-2 -> 12.34
+      memmove( buffer + point + 1, buffer + point, length - point );
+      buffer[point] = '.';
+      return buffer + length + 1;
+   }
+   if ( -4 < point  &&  point <= 0 )
+   {
+      // 1234e-6 -> 0.001234
+      const int offset = 2 - point;
+      memmove( buffer + offset, buffer, length );
+      buffer[0] = '0';
+      buffer[1] = '.';
+      memset( buffer + 2, '0', -point );
+      return buffer + offset + length;
+   }
+
+   // 1234e30 -> 1.234e+33, 1e-7 -> 1e-07
+   char *current = buffer + 1;
+   if ( length > 1 )
+   {
+      memmove( buffer + 2, buffer + 1, length - 1 );
+      buffer[1] = '.';
+      current = buffer + length + 1;
+   }
+   int exponent = point - 1;
+   *current++ = 'e';
+   *current++ = exponent < 0 ? '-' : '+';
+   if ( exponent < 0 )
+      exponent = -exponent;
+   if ( exponent >= 100 )
+   {
+      *current++ = char( '0' + exponent / 100 );
+      exponent %= 100;
+   }
+   *current++ = digitPairs[exponent * 2];
+   *current++ = digitPairs[exponent * 2 + 1];
    return current;
 }
 
 
-std::string valueToString( UInt value )
+char *valueToChars( Int value, char *buffer )
 {
-   char buffer[32];
-   char *current = buffer + sizeof(buffer);
+   if ( value < 0 )
+   {
+      *buffer++ = '-';
+      return valueToChars( UInt( 0 ) - UInt( value ), buffer );
+   }
+   return valueToChars( UInt( value ), buffer );
+}
+
+
+char *valueToChars( UInt value, char *buffer )
+{
+   char digits[16];
+   char *current = digits + sizeof(digits);
    uintToString( value, current );
-   assert( current >= buffer );
+   size_t length = digits + sizeof(digits) - 1 - current;
+   memcpy( buffer, current, length + 1 );
+   return buffer + length;
+}
+
+
+char *valueToChars( double value, char *buffer )
+{
+   UInt64Bits bits;
+   memcpy( &bits, &value, sizeof(bits) );
+   char *current = buffer;
+   if ( value != value )
+   {
+      strcpy( current, "nan" );
+      return current + 3;
+   }
+   if ( bits & doubleSignMask )
+      *current++ = '-';
+   bits &= ~doubleSignMask;
+   if ( bits == doubleExponentMask )
+   {
+      strcpy( current, "inf" );
+      return current + 3;
+   }
+   if ( bits == 0 )
+   {
+      strcpy( current, "0.0" );
+      return current + 3;
+   }
+
+   int length;
+   int k;
+   grisu2( bits, current, length, k );
+   current = formatDecimal( current, length, k );
+   *current = 0;
    return current;
 }
 
+
+std::string valueToString( Int value )
+{
+   char buffer[valueToCharsBufferSize];
+   return std::string( buffer, valueToChars( value, buffer ) );
+}
+
+
+std::string valueToString( UInt value )
+{
+   char buffer[valueToCharsBufferSize];
+   return std::string( buffer, valueToChars( value, buffer ) );
+}
+
+
 std::string valueToString( double value )
 {
-   char buffer[32];
-#if defined(_MSC_VER) && defined(__STDC_SECURE_LIB__) // Use secure version with visual studio 2005 to avoid warning. 
-   sprintf_s(buffer, sizeof(buffer), "%#.16g", value); 
-#else	
-   sprintf(buffer, "%#.16g", value); 
-#endif
-   char* ch = buffer + strlen(buffer) - 1;
-   if (*ch != '0') return buffer; // nothing to truncate, so save time
-   while(ch > buffer && *ch == '0'){
-     --ch;
-   }
-   char* last_nonzero = ch;
-   while(ch >= buffer){
-     switch(*ch){
-     case '0':
-     case '1':
-     case '2':
-     case '3':
-     case '4':
-     case '5':
-     case '6':
-     case '7':
-     case '8':
-     case '9':
-       --ch;
-       continue;
-     case '.':
-       // Truncate zeroes to save bytes in output, but keep one.
-       *(last_nonzero+2) = '\0';
-       return buffer;
-     default:
-       return buffer;
-     }
-   }
-   return buffer;
+   char buffer[valueToCharsBufferSize];
+   return std::string( buffer, valueToChars( value, buffer ) );
 }
 
 
@@ -207,19 +524,20 @@ FastWriter::write( const Value &root )
 void 
 FastWriter::writeValue( const Value &value )
 {
+   char number[valueToCharsBufferSize];
    switch ( value.type() )
    {
    case nullValue:
       document_ += "null";
       break;
    case intValue:
-      document_ += valueToString( value.asInt() );
+      document_.append( number, valueToChars( value.asInt(), number ) );
       break;
    case uintValue:
-      document_ += valueToString( value.asUInt() );
+      document_.append( number, valueToChars( value.asUInt(), number ) );
       break;
    case realValue:
-      document_ += valueToString( value.asDouble() );
+      document_.append( number, valueToChars( value.asDouble(), number ) );
       break;
    case stringValue:
       document_ += valueToQuotedString( value.asCString() );
@@ -242,19 +560,18 @@ FastWriter::writeValue( const Value &value )
       break;
    case objectValue:
       {
-         Value::Members members( value.getMemberNames() );
+         // Walks the members in place, rather than copying their names and looking each up again
          document_ += "{";
-         for ( Value::Members::iterator it = members.begin(); 
-               it != members.end(); 
+         for ( Value::const_iterator it = value.begin(); 
+               it != value.end(); 
                ++it )
          {
-            const std::string &name = *it;
-            if ( it != members.begin() )
+            if ( it != value.begin() )
                document_ += ",";
-            document_ += valueToQuotedString( name.c_str() );
+            document_ += valueToQuotedString( it.memberName() );
             document_ += yamlCompatiblityEnabled_ ? ": " 
                                                   : ":";
-            writeValue( value[name] );
+            writeValue( *it );
          }
          document_ += "}";
       }
@@ -315,23 +632,21 @@ StyledWriter::writeValue( const Value &value )
       break;
    case objectValue:
       {
-         Value::Members members( value.getMemberNames() );
-         if ( members.empty() )
+         if ( value.empty() )
             pushValue( "{}" );
          else
          {
             writeWithIndent( "{" );
             indent();
-            Value::Members::iterator it = members.begin();
+            Value::const_iterator it = value.begin();
             while ( true )
             {
-               const std::string &name = *it;
-               const Value &childValue = value[name];
+               const Value &childValue = *it;
                writeCommentBeforeValue( childValue );
-               writeWithIndent( valueToQuotedString( name.c_str() ) );
+               writeWithIndent( valueToQuotedString( it.memberName() ) );
                document_ += " : ";
                writeValue( childValue );
-               if ( ++it == members.end() )
+               if ( ++it == value.end() )
                {
                   writeCommentAfterValueOnSameLine( childValue );
                   break;
@@ -591,23 +906,21 @@ StyledStreamWriter::writeValue( const Value &value )
       break;
    case objectValue:
       {
-         Value::Members members( value.getMemberNames() );
-         if ( members.empty() )
+         if ( value.empty() )
             pushValue( "{}" );
          else
          {
             writeWithIndent( "{" );
             indent();
-            Value::Members::iterator it = members.begin();
+            Value::const_iterator it = value.begin();
             while ( true )
             {
-               const std::string &name = *it;
-               const Value &childValue = value[name];
+               const Value &childValue = *it;
                writeCommentBeforeValue( childValue );
-               writeWithIndent( valueToQuotedString( name.c_str() ) );
+               writeWithIndent( valueToQuotedString( it.memberName() ) );
                *document_ << " : ";
                writeValue( childValue );
-               if ( ++it == members.end() )
+               if ( ++it == value.end() )
                {
                   writeCommentAfterValueOnSameLine( childValue );
                   break;
@@ -818,6 +1131,378 @@ StyledStreamWriter::normalizeEOL( const std::string &text )
 }
 
 
+// Class StreamingWriter
+// //////////////////////////////////////////////////////////////////
+
+StreamingWriter::StreamingWriter( int fd, 
+                                  Style style, 
+                                  unsigned int bufferSize )
+   : buffer_( bufferSize < 2 * valueToCharsBufferSize ? 2 * valueToCharsBufferSize : bufferSize )
+   , used_( 0 )
+   , fd_( fd )
+   , style_( style )
+   , hasKey_( false )
+   , failed_( false )
+{
+}
+
+
+StreamingWriter::~StreamingWriter()
+{
+   flush();
+}
+
+
+void 
+StreamingWriter::beginObject()
+{
+   open( '{', true );
+}
+
+
+void 
+StreamingWriter::endObject()
+{
+   close( '}', true );
+}
+
+
+void 
+StreamingWriter::beginArray()
+{
+   open( '[', false );
+}
+
+
+void 
+StreamingWriter::endArray()
+{
+   close( ']', false );
+}
+
+
+void 
+StreamingWriter::key( const char *name )
+{
+   assert( !scopes_.empty()  &&  scopes_.back().isObject_  &&  !hasKey_ );
+   Scope &scope = scopes_.back();
+   if ( !scope.isEmpty_ )
+      write( ',' );
+   scope.isEmpty_ = false;
+   writeNewLine();
+   writeQuoted( name );
+   if ( style_ == pretty )
+      write( " : ", 3 );
+   else
+      write( ':' );
+   hasKey_ = true;
+}
+
+
+void 
+StreamingWriter::key( const std::string &name )
+{
+   key( name.c_str() );
+}
+
+
+void 
+StreamingWriter::value( Int value )
+{
+   beginValue();
+   char *buffer = reserve( valueToCharsBufferSize );
+   used_ += valueToChars( value, buffer ) - buffer;
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( UInt value )
+{
+   beginValue();
+   char *buffer = reserve( valueToCharsBufferSize );
+   used_ += valueToChars( value, buffer ) - buffer;
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( double value )
+{
+   beginValue();
+   char *buffer = reserve( valueToCharsBufferSize );
+   used_ += valueToChars( value, buffer ) - buffer;
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( bool value )
+{
+   beginValue();
+   if ( value )
+      write( "true", 4 );
+   else
+      write( "false", 5 );
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( const char *value )
+{
+   beginValue();
+   writeQuoted( value );
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( const std::string &value )
+{
+   this->value( value.c_str() );
+}
+
+
+void 
+StreamingWriter::null()
+{
+   beginValue();
+   write( "null", 4 );
+   endValue();
+}
+
+
+void 
+StreamingWriter::value( const Value &root )
+{
+   switch ( root.type() )
+   {
+   case nullValue:
+      null();
+      break;
+   case intValue:
+      value( root.asInt() );
+      break;
+   case uintValue:
+      value( root.asUInt() );
+      break;
+   case realValue:
+      value( root.asDouble() );
+      break;
+   case stringValue:
+      value( root.asCString() );
+      break;
+   case booleanValue:
+      value( root.asBool() );
+      break;
+   case arrayValue:
+      {
+         beginArray();
+         int size = root.size();
+         for ( int index = 0; index < size; ++index )
+            value( root[index] );
+         endArray();
+      }
+      break;
+   case objectValue:
+      beginObject();
+      for ( Value::const_iterator it = root.begin(); it != root.end(); ++it )
+      {
+         key( it.memberName() );
+         value( *it );
+      }
+      endObject();
+      break;
+   }
+}
+
+
+bool 
+StreamingWriter::flush()
+{
+   size_t length = used_;
+   used_ = 0;
+   if ( length > 0 )
+      writeToFd( &buffer_[0], length );
+   return !failed_;
+}
+
+
+bool 
+StreamingWriter::good() const
+{
+   return !failed_;
+}
+
+
+void 
+StreamingWriter::beginValue()
+{
+   if ( hasKey_ )
+   {
+      hasKey_ = false;
+      return;
+   }
+   assert( scopes_.empty()  ||  !scopes_.back().isObject_ );   // object members need a key()
+   if ( scopes_.empty() )
+      return;
+   Scope &scope = scopes_.back();
+   if ( !scope.isEmpty_ )
+      write( ',' );
+   scope.isEmpty_ = false;
+   writeNewLine();
+}
+
+
+void 
+StreamingWriter::endValue()
+{
+   // Like FastWriter and StyledWriter, a document ends with a line break
+   if ( scopes_.empty() )
+      write( '\n' );
+}
+
+
+void 
+StreamingWriter::open( char bracket, bool isObject )
+{
+   beginValue();
+   write( bracket );
+   Scope scope;
+   scope.isObject_ = isObject;
+   scope.isEmpty_ = true;
+   scopes_.push_back( scope );
+}
+
+
+void 
+StreamingWriter::close( char bracket, bool isObject )
+{
+   assert( !scopes_.empty()  &&  scopes_.back().isObject_ == isObject  &&  !hasKey_ );
+   (void)isObject;   // only checked by the assert
+   bool isEmpty = scopes_.back().isEmpty_;
+   scopes_.pop_back();
+   if ( !isEmpty )
+      writeNewLine();
+   write( bracket );
+   endValue();
+}
+
+
+void 
+StreamingWriter::writeNewLine()
+{
+   if ( style_ != pretty )
+      return;
+   const size_t indentSize = 3;
+   size_t length = 1 + scopes_.size() * indentSize;
+   if ( length > buffer_.size() )
+      length = buffer_.size();
+   char *current = reserve( length );
+   *current = '\n';
+   memset( current + 1, ' ', length - 1 );
+   used_ += length;
+}
+
+
+void 
+StreamingWriter::writeQuoted( const char *text )
+{
+   write( '"' );
+   const char *run = text;
+   for ( const char *c = text; ; ++c )
+   {
+      const char *escape;
+      switch ( *c )
+      {
+         case 0:    write( run, c - run ); write( '"' ); return;
+         case '\"': escape = "\\\""; break;
+         case '\\': escape = "\\\\"; break;
+         case '\b': escape = "\\b"; break;
+         case '\f': escape = "\\f"; break;
+         case '\n': escape = "\\n"; break;
+         case '\r': escape = "\\r"; break;
+         case '\t': escape = "\\t"; break;
+         default:
+            if ( !isControlCharacter( *c ) )
+               continue;
+            escape = 0;
+            break;
+      }
+      // Unescaped characters are copied in runs, not one at a time
+      write( run, c - run );
+      run = c + 1;
+      if ( escape )
+         write( escape, strlen( escape ) );
+      else
+      {
+         static const char hexDigits[] = "0123456789ABCDEF";
+         char unicode[6] = { '\\', 'u', '0', '0', hexDigits[( *c >> 4 ) & 0xF], hexDigits[*c & 0xF] };
+         write( unicode, sizeof(unicode) );
+      }
+   }
+}
+
+
+void 
+StreamingWriter::write( const char *text, size_t length )
+{
+   if ( used_ + length > buffer_.size() )
+   {
+      flush();
+      if ( length > buffer_.size() )
+      {
+         writeToFd( text, length );   // larger than the whole buffer, no point copying it
+         return;
+      }
+   }
+   if ( length > 0 )
+   {
+      memcpy( &buffer_[used_], text, length );
+      used_ += length;
+   }
+}
+
+
+void 
+StreamingWriter::write( char c )
+{
+   if ( used_ == buffer_.size() )
+      flush();
+   buffer_[used_++] = c;
+}
+
+
+void 
+StreamingWriter::writeToFd( const char *data, size_t length )
+{
+   while ( length > 0  &&  !failed_ )
+   {
+      // write() may take less than asked for, or be interrupted by a signal.
+      // Writing nothing at all would never end, it fails like an error does
+      int written = int( ::write( fd_, data, unsigned( length < 0x40000000 ? length : 0x40000000 ) ) );
+      if ( written <= 0 )
+      {
+         failed_ = written == 0  ||  errno != EINTR;
+         continue;
+      }
+      data += written;
+      length -= written;
+   }
+}
+
+
+// Room for length more chars at the end of the buffer, length <= buffer size.
+char *
+StreamingWriter::reserve( size_t length )
+{
+   if ( used_ + length > buffer_.size() )
+      flush();
+   return &buffer_[used_];
+}
+
+
 std::ostream& operator<<( std::ostream &sout, const Value &root )
 {
    Json::StyledStreamWriter writer;
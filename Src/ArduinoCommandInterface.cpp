@@ -4,6 +4,7 @@
 #include "cinder/Color.h"
 #include "cinder/app/App.h"
 #include "Constants.h"
+#include "UserSessionRecorder.h"
 
 ArduinoCommandInterface::~ArduinoCommandInterface() {
 	delete _gui; _gui = NULL;
@@ -105,6 +106,7 @@ void ArduinoCommandInterface::sendMessage(std::string message) {
 void ArduinoCommandInterface::sendMessageImp(std::string message, bool forceSend ) {
 	if( forceSend || !ignoreExternalSendRequest ) {
 		std::cout << "Sending message!" << message << std::endl;
+		relay::UserSessionRecorder::getInstance()->recordEvent( relay::USER_SESSION_EVENT_SERIAL_MESSAGE, 0, message );
 
 		if( serial )
 			serial->writeString(message);
@@ -7,6 +7,7 @@
 #include "cinder/Rand.h"
 #include "cinder/Camera.h"
 #include "cinder/MayaCamUI.h"
+#include "cinder/Utilities.h"
 
 #include "UserRelay.h"
 #include "Puppeteer.h"
@@ -17,8 +18,13 @@
 #include "WuCinderNITE.h"
 #include "UserTracker.h"
 #include "SkeletonStruct.h"
+#include "SkeletonSanitize.h"
 #include "Constants.h"
 #include "TimeLapseRGB.h"
+#include "UserSessionRecorder.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <sstream>
 
 using namespace ci;
 using namespace app;
@@ -34,11 +40,15 @@ public:
 	void mouseDown( MouseEvent event );
 	void mouseDrag( MouseEvent event );
 	void keyUp(KeyEvent event);
+	void reportSanitizeStats();
 
 	UserTracker* userTracker;
 	relay::UserRelay* userRelay;
 	puppeteer::Puppeteer* puppetier;
 	TimeLapseRGB* rgbSaver;
+
+	double lastSanitizeReportTime;
+	unsigned long sanitizedSkeletonsReported;
 };
 
 void DisKinect::prepareSettings( AppBasic::Settings *settings )
@@ -48,6 +58,21 @@ void DisKinect::prepareSettings( AppBasic::Settings *settings )
 
 void DisKinect::setup()
 {
+	// UserTracker, blending and the Puppeteer all run on this thread
+	SKELETON::enableFlushToZero();
+	lastSanitizeReportTime = 0;
+	sanitizedSkeletonsReported = 0;
+
+	// Started first so the session sees the sensor come up and the first state entered
+	if( Constants::Debug::RECORD_SESSION ) {
+		std::stringstream path;
+		path << getHomeDirectory() << Constants::TimeLapse::DIRECTORY_NAME << "/_sessions/Session_" << boost::posix_time::second_clock::local_time() << relay::USER_SESSION_EXTENSION;
+
+		// Create the directory here, cinder leaks when it does it from another thread
+		createDirectories( getPathDirectory( path.str() ) );
+		relay::UserSessionRecorder::getInstance()->start( path.str() );
+	}
+
 	WuCinderNITE* aNi = WuCinderNITE::getInstance();
 	if (Constants::Debug::USE_RECORDED_ONI) {
 		aNi->setup(getResourcePath("SkeletonRec.oni"));
@@ -87,6 +112,32 @@ void DisKinect::update() {
 
 	SKELETON::SKELETON skeleton = userRelay->getSkeleton();
 	puppetier->update(skeleton);
+
+	if (getElapsedSeconds() - lastSanitizeReportTime >= Constants::Debug::SANITIZE_REPORT_SECONDS) {
+		lastSanitizeReportTime = getElapsedSeconds();
+		reportSanitizeStats();
+	}
+}
+
+void DisKinect::reportSanitizeStats()
+{
+	SKELETON::SANITIZE_STATS stats[SKELETON::SANITIZE_BOUNDARY_COUNT];
+	unsigned long skeletons = 0;
+	for (int i = 0; i < SKELETON::SANITIZE_BOUNDARY_COUNT; i++) {
+		stats[i] = SKELETON::getSanitizeStats((SKELETON::SANITIZE_BOUNDARY)i);
+		skeletons += stats[i].skeletons;
+	}
+	if (skeletons == sanitizedSkeletonsReported) {
+		return;
+	}
+	sanitizedSkeletonsReported = skeletons;
+
+	console() << "sanitized skeletons -";
+	for (int i = 0; i < SKELETON::SANITIZE_BOUNDARY_COUNT; i++) {
+		console() << " " << SKELETON::getSanitizeBoundaryName((SKELETON::SANITIZE_BOUNDARY)i) << ": " << stats[i].skeletons
+				<< " (" << stats[i].nans << " NaN, " << stats[i].infinities << " inf, " << stats[i].denormals << " denormal)";
+	}
+	console() << std::endl;
 }
 
 void DisKinect::draw()
@@ -103,6 +154,7 @@ void DisKinect::shutdown()
 {
 	console() << "quitting..." << std::endl;
 	WuCinderNITE::getInstance()->stopGenerating();
+	relay::UserSessionRecorder::getInstance()->stop();
 
 	delete userRelay;
 	delete puppetier;
@@ -0,0 +1,59 @@
+/*
+ * MappedFile.cpp
+ *
+ *  Created on: Oct 23, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Read only memory mapping of a whole file, see MappedFile.h
+ */
+
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+
+MappedFile::MappedFile() {
+	_data = NULL;
+	_size = 0;
+}
+
+MappedFile::~MappedFile() {
+	if( _data && _size ) munmap( (void*)_data, _size );
+	_data = NULL;
+	_size = 0;
+}
+
+MappedFile_ptr MappedFile::open( const std::string &aPath ) {
+	int fd = ::open( aPath.c_str(), O_RDONLY );
+	if( fd < 0 ) {
+		std::cout << "MappedFile::open - Failed to open '" << aPath << "'" << std::endl;
+		return MappedFile_ptr();
+	}
+
+	struct stat info;
+	if( fstat( fd, &info ) != 0 ) {
+		::close( fd );
+		std::cout << "MappedFile::open - Failed to stat '" << aPath << "'" << std::endl;
+		return MappedFile_ptr();
+	}
+
+	MappedFile_ptr file( new MappedFile() );
+	file->_path = aPath;
+
+	// Mapping zero bytes is an error, an empty file is just an empty view
+	if( info.st_size > 0 ) {
+		void *data = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( data == MAP_FAILED ) {
+			::close( fd );
+			std::cout << "MappedFile::open - Failed to map '" << aPath << "'" << std::endl;
+			return MappedFile_ptr();
+		}
+		file->_data = (const char*)data;
+		file->_size = info.st_size;
+	}
+
+	::close( fd );	// The mapping keeps its own reference to the file
+	return file;
+}
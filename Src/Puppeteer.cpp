@@ -5,6 +5,7 @@
 #include "cinder/PolyLine.h"
 #include "cinder/Quaternion.h"
 #include "Puppeteer.h"
+#include "SkeletonBodyFrame.h"
 #include "XnTypes.h"
 #include "UserTracker.h"
 #include "Constants.h"
@@ -63,25 +64,26 @@ void Puppeteer::update(SKELETON::SKELETON& skeleton)
 	armLenR = shoulderR.distance(skeleton.joints[XN_SKEL_RIGHT_ELBOW].position)
 			+ skeleton.joints[XN_SKEL_RIGHT_ELBOW].position.distance(skeleton.joints[XN_SKEL_RIGHT_HAND].position);
 
-	// get the 3 axis aligned to the body
-	axisHoriz = (skeleton.joints[XN_SKEL_LEFT_SHOULDER].position - skeleton.joints[XN_SKEL_RIGHT_SHOULDER].position).normalized();
-	axisVert = (skeleton.joints[XN_SKEL_NECK].position - skeleton.joints[XN_SKEL_TORSO].position).normalized();
-	normal = axisHoriz.cross(axisVert).normalized();
-
-	Vec3f v1 = Vec3f(0, 0, -1).normalized();
-	Vec3f v2 = normal;
-	// align rectangular region to z-axis
-	Quatf q = Quatf( v1.cross(v2).normalized(), -acos(v1.dot(v2)) );
-	Matrix33<float> m1 = Matrix33<float>::createRotation(q.getAxis(), q.getAngle());
-	// normal aligned with z-axis but rectangular region is rotated around the z-axis, we need to undo this rotation
-	Vec3f p = m1.transformVec(axisVert);
-	float theta = atan2(p.y, p.x);
-	Matrix33<float> m2 = Matrix33<float>::createRotation(Vec3f::zAxis(), -theta + M_PI / 2.0f);
-	normalizationMatrix = m2 * m1;
-
-	handL = normalizationMatrix.transformVec(skeleton.joints[XN_SKEL_LEFT_HAND].position - shoulderL);
+	// get the 3 axis aligned to the body - normal towards -z and the spine towards +y
+	SKELETON::BODY_FRAME body;
+	SKELETON::computeBodyFrame(skeleton, body);
+	if (!body.isValid) {
+		return;
+	}
+	axisHoriz = body.axisHoriz;
+	axisVert = body.axisVert;
+	normal = body.normal;
+
+	// rows of the normalization matrix are the body axes, only needed to draw the debug bounds
+	for (int column = 0; column < 3; column++) {
+		normalizationMatrix.at(0, column) = -axisHoriz[column];
+		normalizationMatrix.at(1, column) = axisVert[column];
+		normalizationMatrix.at(2, column) = -normal[column];
+	}
+
+	handL = body.toBody(skeleton.joints[XN_SKEL_LEFT_HAND].position - shoulderL);
 	if (handL.x > 0) handL.x = 0;
-	handR = normalizationMatrix.transformVec(skeleton.joints[XN_SKEL_RIGHT_HAND].position - shoulderR);
+	handR = body.toBody(skeleton.joints[XN_SKEL_RIGHT_HAND].position - shoulderR);
 	if (handR.x < 0) handR.x = 0;
 	// ----------------------------send to arduino
 	if (cinder::app::App::get()->getElapsedSeconds() - lastUpdateTime >= updateInterval) {
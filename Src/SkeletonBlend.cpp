@@ -0,0 +1,77 @@
+/*
+ * SkeletonBlend.cpp
+ *
+ *  Created on: Oct 26, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Interpolates between two skeletons, see SkeletonBlend.h
+ */
+
+#include "SkeletonBlend.h"
+#include <XnTypes.h>
+
+namespace SKELETON {
+	namespace {
+		static const float MIN_BONE_LENGTH = 1e-4f;	// Shorter than this has no usable direction
+
+		// Tracked joints and their parent, parents always come first
+		static const int NUM_LINKS = 14;
+		static const int LINKS[NUM_LINKS][2] = {
+			{ XN_SKEL_NECK, XN_SKEL_TORSO },
+			{ XN_SKEL_HEAD, XN_SKEL_NECK },
+			{ XN_SKEL_LEFT_SHOULDER, XN_SKEL_NECK },
+			{ XN_SKEL_LEFT_ELBOW, XN_SKEL_LEFT_SHOULDER },
+			{ XN_SKEL_LEFT_HAND, XN_SKEL_LEFT_ELBOW },
+			{ XN_SKEL_RIGHT_SHOULDER, XN_SKEL_NECK },
+			{ XN_SKEL_RIGHT_ELBOW, XN_SKEL_RIGHT_SHOULDER },
+			{ XN_SKEL_RIGHT_HAND, XN_SKEL_RIGHT_ELBOW },
+			{ XN_SKEL_LEFT_HIP, XN_SKEL_TORSO },
+			{ XN_SKEL_LEFT_KNEE, XN_SKEL_LEFT_HIP },
+			{ XN_SKEL_LEFT_FOOT, XN_SKEL_LEFT_KNEE },
+			{ XN_SKEL_RIGHT_HIP, XN_SKEL_TORSO },
+			{ XN_SKEL_RIGHT_KNEE, XN_SKEL_RIGHT_HIP },
+			{ XN_SKEL_RIGHT_FOOT, XN_SKEL_RIGHT_KNEE }
+		};
+
+		inline bool isConfident( const SKELETON_JOINT &joint ) { return joint.confidence > 0; }
+	}
+
+	void blend( const SKELETON &from, const SKELETON &to, float amount, SKELETON &result ) {
+		result.isTracking = amount < 0.5f ? from.isTracking : to.isTracking;
+
+		// Plain lerp first, also covers the root and joints NITE never fills in
+		for( int i = 0; i < MAX_JOINTS; ++i ) {
+			const SKELETON_JOINT &a = from.joints[i];
+			const SKELETON_JOINT &b = to.joints[i];
+
+			if( isConfident( a ) != isConfident( b ) ) {
+				result.joints[i] = isConfident( a ) ? a : b;
+			} else {
+				result.joints[i].position = a.position.lerp( amount, b.position );
+				result.joints[i].confidence = a.confidence + ( b.confidence - a.confidence ) * amount;
+			}
+		}
+
+		// Then rebuild each limb outward from the torso
+		for( int i = 0; i < NUM_LINKS; ++i ) {
+			int joint = LINKS[i][0];
+			int parent = LINKS[i][1];
+
+			if( !isConfident( from.joints[joint] ) || !isConfident( from.joints[parent] ) ) continue;
+			if( !isConfident( to.joints[joint] ) || !isConfident( to.joints[parent] ) ) continue;
+
+			ci::Vec3f boneA = from.joints[joint].position - from.joints[parent].position;
+			ci::Vec3f boneB = to.joints[joint].position - to.joints[parent].position;
+			float lengthA = boneA.length();
+			float lengthB = boneB.length();
+			if( lengthA < MIN_BONE_LENGTH || lengthB < MIN_BONE_LENGTH ) continue;
+
+			ci::Vec3f direction = ( boneA / lengthA ).lerp( amount, boneB / lengthB );
+			float directionLength = direction.length();
+			if( directionLength < MIN_BONE_LENGTH ) continue;	// Bone flipped exactly between the two frames, keep the lerp
+
+			float length = lengthA + ( lengthB - lengthA ) * amount;
+			result.joints[joint].position = result.joints[parent].position + direction * ( length / directionLength );
+		}
+	}
+}
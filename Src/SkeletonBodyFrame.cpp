@@ -0,0 +1,117 @@
+/*
+ * SkeletonBodyFrame.cpp
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Orthonormal frame attached to a user's upper body.
+ *      	The batch version lays four users out side by side (structure of arrays) so every
+ *      	subtraction, cross product and normalization is done for all of them in one instruction.
+ */
+
+#include "SkeletonBodyFrame.h"
+#include <XnTypes.h>
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace SKELETON {
+	namespace {
+		static const float MIN_AXIS_LENGTH = 1e-4f;
+
+		bool hasBodyJoints( const SKELETON &skeleton ) {
+			return skeleton.isTracking
+				&& skeleton.joints[XN_SKEL_LEFT_SHOULDER].confidence > 0 && skeleton.joints[XN_SKEL_RIGHT_SHOULDER].confidence > 0
+				&& skeleton.joints[XN_SKEL_NECK].confidence > 0 && skeleton.joints[XN_SKEL_TORSO].confidence > 0;
+		}
+	}
+
+	void computeBodyFrame( const SKELETON &skeleton, BODY_FRAME &frame ) {
+		frame.isValid = false;
+		if( !hasBodyJoints( skeleton ) ) return;
+
+		ci::Vec3f horiz = skeleton.joints[XN_SKEL_LEFT_SHOULDER].position - skeleton.joints[XN_SKEL_RIGHT_SHOULDER].position;
+		ci::Vec3f vert = skeleton.joints[XN_SKEL_NECK].position - skeleton.joints[XN_SKEL_TORSO].position;
+		ci::Vec3f normal = horiz.cross( vert );
+
+		float vertLength = vert.length();
+		float normalLength = normal.length();
+		if( vertLength < MIN_AXIS_LENGTH || normalLength < MIN_AXIS_LENGTH ) return;
+
+		frame.origin = skeleton.joints[XN_SKEL_TORSO].position;
+		frame.axisVert = vert / vertLength;
+		frame.normal = normal / normalLength;
+		frame.axisHoriz = frame.axisVert.cross( frame.normal );
+		frame.isValid = true;
+	}
+
+	void computeBodyFrames( const SKELETON *skeletons, BODY_FRAME *frames, int count ) {
+#if defined(__SSE__)
+		// Four users per pass, unused lanes are filled with a valid dummy body so nothing divides by zero
+		for( int first = 0; first < count; first += 4 ) {
+			float hx[4], hy[4], hz[4], vx[4], vy[4], vz[4], ox[4], oy[4], oz[4];
+			bool isUsed[4];
+			for( int lane = 0; lane < 4; ++lane ) {
+				int i = first + lane;
+				isUsed[lane] = i < count && hasBodyJoints( skeletons[i] );
+				if( isUsed[lane] ) {
+					const SKELETON_JOINT *joints = skeletons[i].joints;
+					hx[lane] = joints[XN_SKEL_LEFT_SHOULDER].position.x - joints[XN_SKEL_RIGHT_SHOULDER].position.x;
+					hy[lane] = joints[XN_SKEL_LEFT_SHOULDER].position.y - joints[XN_SKEL_RIGHT_SHOULDER].position.y;
+					hz[lane] = joints[XN_SKEL_LEFT_SHOULDER].position.z - joints[XN_SKEL_RIGHT_SHOULDER].position.z;
+					vx[lane] = joints[XN_SKEL_NECK].position.x - joints[XN_SKEL_TORSO].position.x;
+					vy[lane] = joints[XN_SKEL_NECK].position.y - joints[XN_SKEL_TORSO].position.y;
+					vz[lane] = joints[XN_SKEL_NECK].position.z - joints[XN_SKEL_TORSO].position.z;
+				} else {
+					hx[lane] = 1; hy[lane] = 0; hz[lane] = 0;
+					vx[lane] = 0; vy[lane] = 1; vz[lane] = 0;
+				}
+			}
+
+			__m128 Hx = _mm_loadu_ps( hx ), Hy = _mm_loadu_ps( hy ), Hz = _mm_loadu_ps( hz );
+			__m128 Vx = _mm_loadu_ps( vx ), Vy = _mm_loadu_ps( vy ), Vz = _mm_loadu_ps( vz );
+			const __m128 minLength = _mm_set1_ps( MIN_AXIS_LENGTH );
+
+			// normal = horiz x vert
+			__m128 Nx = _mm_sub_ps( _mm_mul_ps( Hy, Vz ), _mm_mul_ps( Hz, Vy ) );
+			__m128 Ny = _mm_sub_ps( _mm_mul_ps( Hz, Vx ), _mm_mul_ps( Hx, Vz ) );
+			__m128 Nz = _mm_sub_ps( _mm_mul_ps( Hx, Vy ), _mm_mul_ps( Hy, Vx ) );
+
+			__m128 vertLength = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( Vx, Vx ), _mm_mul_ps( Vy, Vy ) ), _mm_mul_ps( Vz, Vz ) ) );
+			__m128 normalLength = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( Nx, Nx ), _mm_mul_ps( Ny, Ny ) ), _mm_mul_ps( Nz, Nz ) ) );
+			int isDegenerate = _mm_movemask_ps( _mm_or_ps( _mm_cmplt_ps( vertLength, minLength ), _mm_cmplt_ps( normalLength, minLength ) ) );
+
+			__m128 inverse = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_max_ps( vertLength, minLength ) );
+			Vx = _mm_mul_ps( Vx, inverse ); Vy = _mm_mul_ps( Vy, inverse ); Vz = _mm_mul_ps( Vz, inverse );
+			inverse = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_max_ps( normalLength, minLength ) );
+			Nx = _mm_mul_ps( Nx, inverse ); Ny = _mm_mul_ps( Ny, inverse ); Nz = _mm_mul_ps( Nz, inverse );
+
+			// The spine stays exact, horiz = vert x normal, already unit length
+			Hx = _mm_sub_ps( _mm_mul_ps( Vy, Nz ), _mm_mul_ps( Vz, Ny ) );
+			Hy = _mm_sub_ps( _mm_mul_ps( Vz, Nx ), _mm_mul_ps( Vx, Nz ) );
+			Hz = _mm_sub_ps( _mm_mul_ps( Vx, Ny ), _mm_mul_ps( Vy, Nx ) );
+
+			_mm_storeu_ps( hx, Hx ); _mm_storeu_ps( hy, Hy ); _mm_storeu_ps( hz, Hz );
+			_mm_storeu_ps( vx, Vx ); _mm_storeu_ps( vy, Vy ); _mm_storeu_ps( vz, Vz );
+			_mm_storeu_ps( ox, Nx ); _mm_storeu_ps( oy, Ny ); _mm_storeu_ps( oz, Nz );
+
+			for( int lane = 0; lane < 4 && first + lane < count; ++lane ) {
+				BODY_FRAME &frame = frames[first + lane];
+				frame.isValid = isUsed[lane] && !( isDegenerate & ( 1 << lane ) );
+				if( !frame.isValid ) continue;
+
+				frame.origin = skeletons[first + lane].joints[XN_SKEL_TORSO].position;
+				frame.axisHoriz = ci::Vec3f( hx[lane], hy[lane], hz[lane] );
+				frame.axisVert = ci::Vec3f( vx[lane], vy[lane], vz[lane] );
+				frame.normal = ci::Vec3f( ox[lane], oy[lane], oz[lane] );
+			}
+		}
+#else
+		for( int i = 0; i < count; ++i ) {
+			computeBodyFrame( skeletons[i], frames[i] );
+		}
+#endif
+	}
+}
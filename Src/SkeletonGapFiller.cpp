@@ -0,0 +1,158 @@
+/*
+ * SkeletonGapFiller.cpp
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Reconstructs missing or low confidence joints for a single tracked user.
+ *      	Bone lengths are learned once per user from confident frames, a missing joint is then
+ *      	carried along with its confident neighbours from where it was last frame and pulled back onto
+ *      	its learned bone lengths by a small fixed-iteration constraint solver.
+ */
+
+#include "SkeletonGapFiller.h"
+#include "SkeletonJointSet.h"
+#include "Constants.h"
+#include <XnTypes.h>
+
+using namespace Constants::GapFiller;
+
+const int SkeletonGapFiller::BONES[SkeletonGapFiller::NUM_BONES][2] = {
+	{ XN_SKEL_HEAD, XN_SKEL_NECK },
+	{ XN_SKEL_NECK, XN_SKEL_LEFT_SHOULDER },
+	{ XN_SKEL_LEFT_SHOULDER, XN_SKEL_LEFT_ELBOW },
+	{ XN_SKEL_LEFT_ELBOW, XN_SKEL_LEFT_HAND },
+	{ XN_SKEL_NECK, XN_SKEL_RIGHT_SHOULDER },
+	{ XN_SKEL_RIGHT_SHOULDER, XN_SKEL_RIGHT_ELBOW },
+	{ XN_SKEL_RIGHT_ELBOW, XN_SKEL_RIGHT_HAND },
+	{ XN_SKEL_LEFT_SHOULDER, XN_SKEL_TORSO },
+	{ XN_SKEL_RIGHT_SHOULDER, XN_SKEL_TORSO },
+	{ XN_SKEL_TORSO, XN_SKEL_LEFT_HIP },
+	{ XN_SKEL_LEFT_HIP, XN_SKEL_LEFT_KNEE },
+	{ XN_SKEL_LEFT_KNEE, XN_SKEL_LEFT_FOOT },
+	{ XN_SKEL_TORSO, XN_SKEL_RIGHT_HIP },
+	{ XN_SKEL_RIGHT_HIP, XN_SKEL_RIGHT_KNEE },
+	{ XN_SKEL_RIGHT_KNEE, XN_SKEL_RIGHT_FOOT },
+	{ XN_SKEL_LEFT_HIP, XN_SKEL_RIGHT_HIP }
+};
+
+SkeletonGapFiller::SkeletonGapFiller() {
+	reset();
+}
+
+void SkeletonGapFiller::reset() {
+	for( int i = 0; i < NUM_BONES; ++i ) {
+		_boneLength[i] = 0;
+		_boneSamples[i] = 0;
+	}
+
+	for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+		_lastPosition[j] = ci::Vec3f::zero();
+		_framesSinceConfident[j] = MAX_FRAMES_TO_FILL + 1;
+	}
+
+	_hasHistory = false;
+	_filledJoints = 0;
+}
+
+bool SkeletonGapFiller::hasLearnedBones() const {
+	for( int i = 0; i < NUM_BONES; ++i ) {
+		if( _boneSamples[i] < BONE_SAMPLES_TO_LEARN ) return false;
+	}
+	return true;
+}
+
+void SkeletonGapFiller::process( SKELETON::SKELETON &skeleton ) {
+	_filledJoints = 0;
+	if( !skeleton.isTracking ) return;
+
+	learnBoneLengths( skeleton );
+
+	// Decide which joints need to be reconstructed
+	bool isFilled[SKELETON::MAX_JOINTS];
+	for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+		isFilled[j] = false;
+		if( !SKELETON::NiteJoints::contains( j ) ) continue;
+
+		if( skeleton.joints[j].confidence >= FILL_BELOW_CONFIDENCE ) {
+			_framesSinceConfident[j] = 0;
+		} else if( ++_framesSinceConfident[j] <= MAX_FRAMES_TO_FILL && _hasHistory ) {
+			isFilled[j] = true;
+			++_filledJoints;
+		}
+	}
+
+	if( _filledJoints != 0 ) {
+		// Initial guess - last frame's position, moved along with whatever confident neighbours did since then
+		for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+			if( !isFilled[j] ) continue;
+
+			ci::Vec3f delta = ci::Vec3f::zero();
+			int neighbours = 0;
+			for( int i = 0; i < NUM_BONES; ++i ) {
+				int other = BONES[i][0] == j ? BONES[i][1] : ( BONES[i][1] == j ? BONES[i][0] : -1 );
+				if( other == -1 || isFilled[other] || skeleton.joints[other].confidence < FILL_BELOW_CONFIDENCE ) continue;
+
+				delta += skeleton.joints[other].position - _lastPosition[other];
+				++neighbours;
+			}
+
+			skeleton.joints[j].position = _lastPosition[j];
+			if( neighbours ) skeleton.joints[j].position += delta / (float)neighbours;
+		}
+
+		solveConstraints( skeleton, isFilled );
+
+		for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+			if( isFilled[j] ) skeleton.joints[j].confidence = FILLED_CONFIDENCE;
+		}
+	}
+
+	// Remember this frame's output for every joint we trust
+	for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+		if( isFilled[j] || skeleton.joints[j].confidence >= FILL_BELOW_CONFIDENCE ) {
+			_lastPosition[j] = skeleton.joints[j].position;
+		}
+	}
+	_hasHistory = true;
+}
+
+void SkeletonGapFiller::learnBoneLengths( const SKELETON::SKELETON &skeleton ) {
+	for( int i = 0; i < NUM_BONES; ++i ) {
+		if( _boneSamples[i] >= BONE_SAMPLES_TO_LEARN ) continue;
+
+		const SKELETON::SKELETON_JOINT &a = skeleton.joints[ BONES[i][0] ];
+		const SKELETON::SKELETON_JOINT &b = skeleton.joints[ BONES[i][1] ];
+		if( a.confidence < LEARN_CONFIDENCE || b.confidence < LEARN_CONFIDENCE ) continue;
+
+		// Running average, once we have enough samples the length is cached for the rest of this user's life
+		_boneLength[i] += ( a.position.distance( b.position ) - _boneLength[i] ) / (float)( ++_boneSamples[i] );
+	}
+}
+
+void SkeletonGapFiller::solveConstraints( SKELETON::SKELETON &skeleton, const bool *isFilled ) {
+	for( int iteration = 0; iteration < SOLVER_ITERATIONS; ++iteration ) {
+		for( int i = 0; i < NUM_BONES; ++i ) {
+			int a = BONES[i][0];
+			int b = BONES[i][1];
+			if( _boneSamples[i] == 0 || ( !isFilled[a] && !isFilled[b] ) ) continue;
+
+			ci::Vec3f &positionA = skeleton.joints[a].position;
+			ci::Vec3f &positionB = skeleton.joints[b].position;
+			ci::Vec3f delta = positionB - positionA;
+			float distance = delta.length();
+			if( distance < 1e-6f ) continue;
+
+			// Only reconstructed joints move, confident ones are the anchors
+			ci::Vec3f correction = delta * ( ( distance - _boneLength[i] ) / distance );
+			if( isFilled[a] && isFilled[b] ) {
+				positionA += correction * 0.5f;
+				positionB -= correction * 0.5f;
+			} else if( isFilled[a] ) {
+				positionA += correction;
+			} else {
+				positionB -= correction;
+			}
+		}
+	}
+}
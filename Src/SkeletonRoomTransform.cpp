@@ -0,0 +1,125 @@
+/*
+ * SkeletonRoomTransform.cpp
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Floor aligned ("room") coordinate frame.
+ *      	Joints are stored as ( confidence, x, y, z ) - 16 bytes - so each one is a single SSE register,
+ *      	the transform is a 4x4 matrix whose first column passes the confidence straight through.
+ */
+
+#include "SkeletonRoomTransform.h"
+#include "SkeletonJointSet.h"
+#include "Constants.h"
+#include <boost/static_assert.hpp>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+BOOST_STATIC_ASSERT( sizeof(SKELETON::SKELETON_JOINT) == 4 * sizeof(float) );
+
+SkeletonRoomTransform::SkeletonRoomTransform() {
+	_hasFloor = false;
+	_floorNormal = ci::Vec3f::yAxis();
+	_floorPoint = ci::Vec3f::zero();
+	_origin = ci::Vec3f::zero();
+	_axis[0] = ci::Vec3f::xAxis();
+	_axis[1] = ci::Vec3f::yAxis();
+	_axis[2] = ci::Vec3f::zAxis();
+	updateMatrix();
+}
+
+void SkeletonRoomTransform::setFloor( const XnPlane3D &floor ) {
+	ci::Vec3f normal( floor.vNormal.X, floor.vNormal.Y, floor.vNormal.Z );
+	ci::Vec3f point( floor.ptPoint.X / 1000.0f, floor.ptPoint.Y / 1000.0f, floor.ptPoint.Z / 1000.0f );
+
+	// The SceneAnalyzer reports a zero normal until it has found the floor
+	float length = normal.length();
+	if( length < 0.5f ) return;
+	normal /= length;
+	if( normal.y < 0 ) normal = -normal;
+
+	if( !_hasFloor ) {
+		_floorNormal = normal;
+		_floorPoint = point;
+		_hasFloor = true;
+	} else {
+		// The estimate jitters a little frame to frame, don't let that shake the whole room
+		using Constants::RoomTransform::FLOOR_SMOOTHING;
+		_floorNormal = ( _floorNormal + ( normal - _floorNormal ) * FLOOR_SMOOTHING ).normalized();
+		_floorPoint += ( point - _floorPoint ) * FLOOR_SMOOTHING;
+	}
+
+	// y is up, z is the camera's view direction flattened onto the floor, x completes the basis
+	ci::Vec3f forward = ci::Vec3f::zAxis() - _floorNormal * _floorNormal.z;
+	if( forward.lengthSquared() < 1e-6f ) return; // Looking straight at the floor, keep the last frame
+
+	_axis[1] = _floorNormal;
+	_axis[2] = forward.normalized();
+	_axis[0] = _axis[1].cross( _axis[2] );
+
+	// Put the origin on the floor right below the camera
+	_origin = _floorNormal * _floorPoint.dot( _floorNormal );
+	updateMatrix();
+}
+
+void SkeletonRoomTransform::updateMatrix() {
+	for( int row = 0; row < 4; ++row ) {
+		for( int column = 0; column < 4; ++column ) {
+			_columns[column][row] = 0;
+		}
+	}
+
+	// confidence passes through untouched
+	_columns[0][0] = 1;
+	_translation[0] = 0;
+
+	for( int row = 0; row < 3; ++row ) {
+		_columns[1][row + 1] = _axis[row].x;
+		_columns[2][row + 1] = _axis[row].y;
+		_columns[3][row + 1] = _axis[row].z;
+		_translation[row + 1] = -_axis[row].dot( _origin );
+	}
+}
+
+ci::Vec3f SkeletonRoomTransform::toRoom( const ci::Vec3f &position ) const {
+	ci::Vec3f local = position - _origin;
+	return ci::Vec3f( _axis[0].dot( local ), _axis[1].dot( local ), _axis[2].dot( local ) );
+}
+
+void SkeletonRoomTransform::transform( const SKELETON::SKELETON *source, SKELETON::SKELETON *destination, int count ) const {
+#if defined(__SSE__)
+	const __m128 column0 = _mm_loadu_ps( _columns[0] );
+	const __m128 column1 = _mm_loadu_ps( _columns[1] );
+	const __m128 column2 = _mm_loadu_ps( _columns[2] );
+	const __m128 column3 = _mm_loadu_ps( _columns[3] );
+	const __m128 translation = _mm_loadu_ps( _translation );
+#endif
+
+	for( int i = 0; i < count; ++i ) {
+		destination[i].isTracking = source[i].isTracking;
+		if( !source[i].isTracking ) {
+			SKELETON::NiteJoints::clearConfidence( destination[i] );
+			continue;
+		}
+
+		const float *in = reinterpret_cast<const float*>( source[i].joints );
+		float *out = reinterpret_cast<float*>( destination[i].joints );
+		for( int j = 0; j < SKELETON::MAX_JOINTS; ++j, in += 4, out += 4 ) {
+#if defined(__SSE__)
+			__m128 joint = _mm_loadu_ps( in );
+			__m128 result = _mm_add_ps( translation, _mm_mul_ps( column0, _mm_shuffle_ps( joint, joint, _MM_SHUFFLE(0, 0, 0, 0) ) ) );
+			result = _mm_add_ps( result, _mm_mul_ps( column1, _mm_shuffle_ps( joint, joint, _MM_SHUFFLE(1, 1, 1, 1) ) ) );
+			result = _mm_add_ps( result, _mm_mul_ps( column2, _mm_shuffle_ps( joint, joint, _MM_SHUFFLE(2, 2, 2, 2) ) ) );
+			result = _mm_add_ps( result, _mm_mul_ps( column3, _mm_shuffle_ps( joint, joint, _MM_SHUFFLE(3, 3, 3, 3) ) ) );
+			_mm_storeu_ps( out, result );
+#else
+			for( int row = 0; row < 4; ++row ) {
+				out[row] = _translation[row] + _columns[0][row] * in[0] + _columns[1][row] * in[1] + _columns[2][row] * in[2] + _columns[3][row] * in[3];
+			}
+#endif
+		}
+	}
+}
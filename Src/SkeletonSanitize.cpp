@@ -0,0 +1,117 @@
+/*
+ * SkeletonSanitize.cpp
+ *
+ *  Created on: Oct 26, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Values are classified on their bits with integer compares, which DAZ does not affect, so a thread
+ *      	running with enableFlushToZero() still sees and counts the denormals it is handed.
+ */
+
+#include "SkeletonSanitize.h"
+#include <boost/static_assert.hpp>
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+BOOST_STATIC_ASSERT( sizeof(SKELETON::SKELETON_JOINT) == 4 * sizeof(float) );
+
+namespace SKELETON {
+	namespace {
+		const uint32_t ABS_MASK = 0x7FFFFFFF;
+		const uint32_t SMALLEST_NORMAL = 0x00800000;	// Below this and above 0 is a denormal
+		const uint32_t INFINITY_BITS = 0x7F800000;		// Above this is a NaN
+
+		const unsigned int MXCSR_DAZ = 0x0040;
+		const unsigned int MXCSR_FTZ = 0x8000;
+
+		boost::mutex statsMutex;
+		SANITIZE_STATS stats[SANITIZE_BOUNDARY_COUNT];
+
+		void record( SANITIZE_BOUNDARY boundary, int nans, int infinities, int denormals ) {
+			boost::mutex::scoped_lock lock( statsMutex );
+			SANITIZE_STATS &boundaryStats = stats[boundary];
+			boundaryStats.skeletons++;
+			boundaryStats.nans += nans;
+			boundaryStats.infinities += infinities;
+			boundaryStats.denormals += denormals;
+		}
+
+#if defined(__SSE2__)
+		// Set lanes of a _mm_movemask_ps result
+		const int LANE_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+#endif
+	}
+
+	int sanitize( SKELETON &skeleton, SANITIZE_BOUNDARY boundary ) {
+		float *values = reinterpret_cast<float*>( skeleton.joints );
+		int nans = 0, infinities = 0, denormals = 0;
+
+#if defined(__SSE2__)
+		const __m128i absMask = _mm_set1_epi32( ABS_MASK );
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i smallestNormal = _mm_set1_epi32( SMALLEST_NORMAL );
+		const __m128i infinity = _mm_set1_epi32( INFINITY_BITS );
+		const __m128i largestFinite = _mm_set1_epi32( INFINITY_BITS - 1 );
+
+		// One joint per register, the common case is a single compare and branch per joint
+		for( int j = 0; j < MAX_JOINTS; ++j, values += 4 ) {
+			__m128i bits = _mm_and_si128( _mm_castps_si128( _mm_loadu_ps( values ) ), absMask );
+			__m128i isDenormal = _mm_and_si128( _mm_cmpgt_epi32( bits, zero ), _mm_cmplt_epi32( bits, smallestNormal ) );
+			__m128i isNotFinite = _mm_cmpgt_epi32( bits, largestFinite );
+			__m128i isBad = _mm_or_si128( isDenormal, isNotFinite );
+
+			int badLanes = _mm_movemask_ps( _mm_castsi128_ps( isBad ) );
+			if( !badLanes ) continue;
+
+			int nanLanes = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpgt_epi32( bits, infinity ) ) );
+			nans += LANE_COUNT[nanLanes];
+			infinities += LANE_COUNT[ _mm_movemask_ps( _mm_castsi128_ps( isNotFinite ) ) & ~nanLanes ];
+			denormals += LANE_COUNT[ _mm_movemask_ps( _mm_castsi128_ps( isDenormal ) ) ];
+			_mm_storeu_ps( values, _mm_andnot_ps( _mm_castsi128_ps( isBad ), _mm_loadu_ps( values ) ) );
+		}
+#else
+		for( int i = 0; i < MAX_JOINTS * 4; ++i ) {
+			uint32_t bits;
+			std::memcpy( &bits, &values[i], sizeof(bits) );
+			bits &= ABS_MASK;
+
+			if( bits > INFINITY_BITS ) nans++;
+			else if( bits == INFINITY_BITS ) infinities++;
+			else if( bits != 0 && bits < SMALLEST_NORMAL ) denormals++;
+			else continue;
+			values[i] = 0.0f;
+		}
+#endif
+
+		int replaced = nans + infinities + denormals;
+		if( replaced ) record( boundary, nans, infinities, denormals );
+		return replaced;
+	}
+
+	SANITIZE_STATS getSanitizeStats( SANITIZE_BOUNDARY boundary ) {
+		boost::mutex::scoped_lock lock( statsMutex );
+		return stats[boundary];
+	}
+
+	const char* getSanitizeBoundaryName( SANITIZE_BOUNDARY boundary ) {
+		switch( boundary ) {
+			case SANITIZE_CAPTURE: return "capture";
+			case SANITIZE_DECODE: return "decode";
+			case SANITIZE_PLAYBACK: return "playback";
+			default: return "unknown";
+		}
+	}
+
+	void enableFlushToZero() {
+#if defined(__SSE__)
+		_mm_setcsr( _mm_getcsr() | MXCSR_FTZ | MXCSR_DAZ );
+#endif
+	}
+}
@@ -0,0 +1,89 @@
+/*
+ * UserSignatureCache.cpp
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Small LRU of recently lost users, matched by nearest neighbour against new ones.
+ */
+
+#include "UserSignatureCache.h"
+#include "Constants.h"
+#include <cmath>
+
+using namespace Constants::UserTracker;
+
+namespace {
+	static const int MIN_SHARED_BONES = 6;
+}
+
+UserSignatureCache::UserSignatureCache( size_t capacity ) {
+	_capacity = capacity;
+}
+
+void UserSignatureCache::add( const USER_SIGNATURE &signature ) {
+	if( signature.time < 0 ) return;
+
+	_signatures.push_front( signature );
+	if( _signatures.size() > _capacity ) {
+		_signatures.pop_back();
+	}
+}
+
+bool UserSignatureCache::takeMatch( const USER_SIGNATURE &probe, double now, USER_SIGNATURE &match ) {
+	std::list<USER_SIGNATURE>::iterator best = _signatures.end();
+	float bestScore = 0;
+
+	for( std::list<USER_SIGNATURE>::iterator it = _signatures.begin(); it != _signatures.end(); ++it ) {
+		float aScore = score( probe, *it, now );
+		if( aScore >= 0 && ( best == _signatures.end() || aScore < bestScore ) ) {
+			best = it;
+			bestScore = aScore;
+		}
+	}
+
+	if( best == _signatures.end() ) return false;
+
+	match = *best;
+	_signatures.erase( best );
+	return true;
+}
+
+float UserSignatureCache::score( const USER_SIGNATURE &probe, const USER_SIGNATURE &candidate, double now ) {
+	if( candidate.time < 0 || now - candidate.time > REID_MAX_SECONDS ) return -1;
+
+	float distance = probe.floorPosition.distance( candidate.floorPosition );
+	if( distance > REID_MAX_DISTANCE ) return -1;
+
+	float heightDifference = std::fabs( probe.height - candidate.height );
+	if( heightDifference > REID_MAX_HEIGHT_DIFFERENCE ) return -1;
+
+	// Bones only count when both sides have measured enough of them, otherwise it's a neutral term
+	float boneDifference = compareBones( probe.gapFiller, candidate.gapFiller );
+	if( boneDifference > REID_MAX_BONE_RATIO_DIFFERENCE ) return -1;
+
+	return distance / REID_MAX_DISTANCE
+		+ heightDifference / REID_MAX_HEIGHT_DIFFERENCE
+		+ ( boneDifference < 0 ? 1.0f : boneDifference / REID_MAX_BONE_RATIO_DIFFERENCE );
+}
+
+float UserSignatureCache::compareBones( const SkeletonGapFiller &a, const SkeletonGapFiller &b ) {
+	float totalA = 0, totalB = 0;
+	int shared = 0;
+	for( int i = 0; i < SkeletonGapFiller::NUM_BONES; ++i ) {
+		if( a.getBoneSamples( i ) == 0 || b.getBoneSamples( i ) == 0 ) continue;
+		totalA += a.getBoneLength( i );
+		totalB += b.getBoneLength( i );
+		++shared;
+	}
+
+	if( shared < MIN_SHARED_BONES || totalA <= 0 || totalB <= 0 ) return -1;
+
+	float difference = 0;
+	for( int i = 0; i < SkeletonGapFiller::NUM_BONES; ++i ) {
+		if( a.getBoneSamples( i ) == 0 || b.getBoneSamples( i ) == 0 ) continue;
+		difference += std::fabs( a.getBoneLength( i ) / totalA - b.getBoneLength( i ) / totalB );
+	}
+
+	return difference / (float)shared;
+}
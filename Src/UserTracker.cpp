@@ -22,6 +22,7 @@ UserTracker* UserTracker::getInstance()
 }
 
 UserTracker::UserTracker()
+	: mSignatures(Constants::UserTracker::REID_CACHE_SIZE)
 {
 	ni = WuCinderNITE::getInstance();
 
@@ -53,14 +54,23 @@ void UserTracker::release()
 
 void UserTracker::onNewUser(XnUserID nId)
 {
-	onLostUser(nId);
+	removeUser(nId, false);
 	mUsers.push_back(UserInfo(nId));
 }
 
 void UserTracker::onLostUser(XnUserID nId)
+{
+	removeUser(nId, true);
+}
+
+void UserTracker::removeUser(XnUserID nId, bool remember)
 {
 	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end();) {
 		if (it->id == nId) {
+			// Called from WuCinderNITE's callback while it holds its mutex, before the slot is reset
+			if (remember) {
+				mSignatures.add(makeSignature(*it));
+			}
 			mUsers.erase(it);
 			break;
 		}
@@ -68,17 +78,105 @@ void UserTracker::onLostUser(XnUserID nId)
 	}
 }
 
+bool UserTracker::wasReidentified(XnUserID nId)
+{
+	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end(); ++it) {
+		if (it->id == nId) {
+			return it->wasReidentified;
+		}
+	}
+	return false;
+}
+
+// Expects ni->mMutex to be held
+USER_SIGNATURE UserTracker::makeSignature(const UserInfo& user)
+{
+	USER_SIGNATURE signature;
+	signature.id = user.id;
+	signature.floorPosition = user.roomTorso.xz();
+	signature.height = user.height;
+	signature.time = user.lastTrackedTime;
+	signature.wasActive = user.isActive;
+	if (user.id < WuCinderNITE::MAX_USERS) {
+		signature.gapFiller = ni->getGapFiller(user.id);
+	}
+	return signature;
+}
+
+// Expects ni->mMutex to be held, it erases from mUsers
+void UserTracker::reidentify(UserInfo& user, double now)
+{
+	USER_SIGNATURE probe = makeSignature(user);
+	USER_SIGNATURE match;
+	bool found = false;
+
+	// OpenNI often hands out the new id before it reports the old one as lost, so users that
+	// have stopped tracking are the first candidates
+	std::list<UserInfo>::iterator stale = mUsers.end();
+	float bestScore = 0;
+	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end(); ++it) {
+		if (it->id == user.id || it->skeleton.isTracking) {
+			continue;
+		}
+		USER_SIGNATURE candidate = makeSignature(*it);
+		float score = UserSignatureCache::score(probe, candidate, now);
+		if (score >= 0 && (!found || score < bestScore)) {
+			found = true;
+			bestScore = score;
+			match = candidate;
+			stale = it;
+		}
+	}
+
+	if (found) {
+		mUsers.erase(stale);
+	} else {
+		found = mSignatures.takeMatch(probe, now, match);
+	}
+
+	if (found) {
+		ci::app::console() << "user " << user.id << " re-identified as " << match.id << std::endl;
+		if (user.id < WuCinderNITE::MAX_USERS) {
+			ni->getGapFiller(user.id) = match.gapFiller;
+		}
+		user.isActive = match.wasActive;
+		user.wasReidentified = true;
+	}
+}
+
 void UserTracker::update()
 {
 	totalDist = 0;
 	float confidence = 0.5f;
+
+	// Work on a copy of the users, WuCinderNITE's callbacks add and remove them from their own thread.
+	// The lock is only held to take it, with just the joints we look at, and to merge it back
 	ni->mMutex.lock();
+	std::list<UserInfo> users(mUsers);
+	for(std::list<UserInfo>::iterator it = users.begin(); it != users.end(); ++it) {
+		TrackerJoints::copy( ni->skeletons[it->id], it->skeleton );
+
+		SKELETON::SKELETON_JOINT &roomTorso = ni->roomSkeletons[it->id].joints[XN_SKEL_TORSO];
+		if (roomTorso.confidence > confidence) {
+			it->roomTorso = roomTorso.position;
+		}
+		SKELETON::SKELETON_JOINT &roomHead = ni->roomSkeletons[it->id].joints[XN_SKEL_HEAD];
+		if (roomHead.confidence > confidence) {
+			it->height = roomHead.position.y;
+		}
+	}
+	// The activation zone lives in camera space, compare on the floor plane so a tilted camera doesn't skew it
+	ci::Vec2f roomActivationZone = ni->getRoomTransform().toRoom(activationZone).xz();
+	ni->mMutex.unlock();
+	double now = ci::app::App::get()->getElapsedSeconds();
+
 	// measure distance of important joints have moved from the last position
 	// and decide if the user is active or not - used for sorting, and gives us
 	// the next active user, if user A stays still for too long (possible lost of user)
-	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end();) {
-		SKELETON::SKELETON &skeleton = ni->skeletons[it->id];
+	for(std::list<UserInfo>::iterator it = users.begin(); it != users.end();) {
+		SKELETON::SKELETON &skeleton = it->skeleton;
 		if (skeleton.isTracking) {
+			it->lastTrackedTime = now;
 
 			ci::Vec3f &shoulderL = skeleton.joints[XN_SKEL_LEFT_SHOULDER].confidence > confidence
 					? skeleton.joints[XN_SKEL_LEFT_SHOULDER].position : it->shoulderL;
@@ -98,10 +196,7 @@ void UserTracker::update()
 			ci::Vec3f &kneeR = skeleton.joints[XN_SKEL_RIGHT_KNEE].confidence > confidence
 					? skeleton.joints[XN_SKEL_RIGHT_KNEE].position : it->kneeR;
 
-			ci::Vec3f &torso = skeleton.joints[XN_SKEL_TORSO].confidence > confidence
-					? skeleton.joints[XN_SKEL_TORSO].position : it->torso;
-
-			it->distanceFromActivationZone = torso.xz().distance(activationZone.xz());
+			it->distanceFromActivationZone = it->roomTorso.xz().distance(roomActivationZone);
 
 			totalDist = 0;
 			float distance;
@@ -154,7 +249,25 @@ void UserTracker::update()
 		}
 		it++;
 	}
-	ni->mMutex.unlock();
+
+	// Users lost meanwhile stay lost, new ones are picked up on the next update
+	ni->mMutex.lock();
+	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end(); ++it) {
+		for(std::list<UserInfo>::iterator updated = users.begin(); updated != users.end(); ++updated) {
+			if (updated->id == it->id) {
+				*it = *updated;
+				break;
+			}
+		}
+	}
+
+	// A new id may be someone we just lost, if so they skip the warm-up
+	for(std::list<UserInfo>::iterator it = mUsers.begin(); it != mUsers.end(); ++it) {
+		if (it->skeleton.isTracking && !it->isIdentified) {
+			it->isIdentified = true;
+			reidentify(*it, now);
+		}
+	}
 	mUsers.sort();
 
 	if (!mUsers.empty() && mUsers.begin()->isActive) {
@@ -166,6 +279,7 @@ void UserTracker::update()
 //		ci::app::console() << "no active user" << std::endl;
 		activeUserId = 0;
 	}
+	ni->mMutex.unlock();
 }
 
 void UserTracker::draw()
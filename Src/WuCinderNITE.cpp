@@ -8,6 +8,9 @@
 
 #include "WuCinderNITE.h"
 #include "SkeletonStruct.h"
+#include "SkeletonJointSet.h"
+#include "SkeletonSanitize.h"
+#include "UserSessionRecorder.h"
 #include <OpenGL.framework/Headers/gl.h>
 #include <XnCppWrapper.h>
 #include <XnCodecIDs.h>
@@ -30,6 +33,27 @@ XnFloat mNITEUserColors[][3] = {
 	{1,1,1}
 };
 
+namespace {
+	// Reads a single joint of one user into the matching skeleton slot, used with SKELETON::NiteJoints::visit
+	struct CaptureJoint {
+		CaptureJoint( xn::SkeletonCapability &aCapability, XnUserID aUserId, SKELETON::SKELETON &aSkeleton )
+			: capability( aCapability ), userId( aUserId ), skeleton( aSkeleton ) {};
+
+		void operator()( int j ) {
+			XnSkeletonJointPosition joint;
+			capability.GetSkeletonJointPosition( userId, (XnSkeletonJoint)j, joint );
+			skeleton.joints[j].confidence = joint.fConfidence;
+			skeleton.joints[j].position.x = joint.position.X / 1000.0f;
+			skeleton.joints[j].position.y = joint.position.Y / 1000.0f;
+			skeleton.joints[j].position.z = joint.position.Z / 1000.0f;
+		}
+
+		xn::SkeletonCapability &capability;
+		XnUserID userId;
+		SKELETON::SKELETON &skeleton;
+	};
+}
+
 
 WuCinderNITE* WuCinderNITE::mInstance = NULL;
 WuCinderNITE* WuCinderNITE::getInstance()
@@ -43,8 +67,10 @@ WuCinderNITE* WuCinderNITE::getInstance()
 WuCinderNITE::WuCinderNITE() {
 	useSingleCalibrationMode = true;
 	waitForTrackingToSingalNewUser = true;
+	useGapFilling = true;
 	mNeedPoseForCalibration = false;
 	mIsCalibrated = false;
+	mIsCalibrationFileCached = false;
 	mRunUpdates = false;
 	mUseColorImage = false;
 
@@ -214,6 +240,7 @@ void WuCinderNITE::setup(string xmlpath, XnMapOutputMode mapMode, bool useDepthM
 void WuCinderNITE::useCalibrationFile(string filepath)
 {
 	mCalibrationFile = filepath;
+	mIsCalibrationFileCached = false;
 }
 
 void WuCinderNITE::startGenerating()
@@ -250,6 +277,8 @@ void WuCinderNITE::stopUpdating()
 }
 
 void WuCinderNITE::updateLoop() {
+	// Joint math on this thread never slows down on denormals
+	SKELETON::enableFlushToZero();
 	while (mRunUpdates) {
 		update();
 	}
@@ -275,7 +304,9 @@ void WuCinderNITE::update()
 			return;
 		}
 
-		mSceneAnalyzer->GetFloor(mFloor);
+		if (mSceneAnalyzer->GetFloor(mFloor) == XN_STATUS_OK) {
+			mRoomTransform.setFloor(mFloor);
+		}
 
 		mUserGen->GetUserPixels(0, *mSceneMeta);
 		if (mUseDepthMap) {
@@ -287,23 +318,31 @@ void WuCinderNITE::update()
 			updateImageSurface();
 		}
 
-		XnSkeletonJointTransformation joint;
+		// Only the joints NITE actually tracks are read, the loop is unrolled at compile time
+		xn::SkeletonCapability skeletonCap = mUserGen->GetSkeletonCap();
 		for(int i = 1; i < MAX_USERS; i++) {
-			skeletons[i].isTracking = mUserGen->GetSkeletonCap().IsTracking(i);
+			skeletons[i].isTracking = skeletonCap.IsTracking(i);
 			if (skeletons[i].isTracking) {
-				for(int j = 1; j < MAX_JOINTS; j++) {
-					mUserGen->GetSkeletonCap().GetSkeletonJoint(i, (XnSkeletonJoint)j, joint);
-					skeletons[i].joints[j].confidence = joint.position.fConfidence;
-					skeletons[i].joints[j].position.x = joint.position.position.X / 1000.0f;
-					skeletons[i].joints[j].position.y = joint.position.position.Y / 1000.0f;
-					skeletons[i].joints[j].position.z = joint.position.position.Z / 1000.0f;
+				CaptureJoint capture( skeletonCap, i, skeletons[i] );
+				SKELETON::NiteJoints::visit( capture );
+				SKELETON::sanitize( skeletons[i], SKELETON::SANITIZE_CAPTURE );
+
+				if (useGapFilling) {
+					mGapFillers[i].process(skeletons[i]);
 				}
 			} else {
-				for(int j = 1; j < MAX_JOINTS; j++) {
-					skeletons[i].joints[j].confidence = 0;
-				}
+				SKELETON::NiteJoints::clearConfidence( skeletons[i] );
 			}
 		}
+
+		// Every user into floor aligned coordinates in one pass
+		mRoomTransform.transform(skeletons, roomSkeletons, MAX_USERS);
+		SKELETON::computeBodyFrames(skeletons, bodyFrames, MAX_USERS);
+
+		// The skeletons as the app sees them, with the maps they came from
+		relay::UserSessionRecorder::getInstance()->recordCapture( skeletons, MAX_USERS,
+				mUseDepthMap ? mDepthMeta->Data() : NULL, mSceneMeta->Data(), mSceneMeta->XRes(), mSceneMeta->YRes(),
+				mUseColorImage ? (const uint8_t*)mImageMeta->RGB24Data() : NULL, mUseColorImage ? mImageMeta->XRes() : 0, mUseColorImage ? mImageMeta->YRes() : 0 );
 	mMutex.unlock();
 }
 
@@ -557,8 +596,18 @@ void WuCinderNITE::unregisterCallbacks()
 void XN_CALLBACK_TYPE WuCinderNITE::CB_NewUser(xn::UserGenerator& generator, XnUserID nId, void* pCookie)
 {
 	ci::app::console() << "new user " << nId << endl;
+	relay::UserSessionRecorder::getInstance()->recordEvent( relay::USER_SESSION_EVENT_NEW_USER, nId );
+	if (nId < MAX_USERS) {
+		mInstance->mGapFillers[nId].reset();
+	}
 	if (!mInstance->mCalibrationFile.empty()) {
-		mInstance->mUserGen->GetSkeletonCap().LoadCalibrationDataFromFile(nId, mInstance->mCalibrationFile.c_str());
+		// Only read the calibration file once, then keep it in slot 0 for everyone after
+		if (mInstance->mIsCalibrationFileCached) {
+			mInstance->mUserGen->GetSkeletonCap().LoadCalibrationData(nId, 0);
+		} else {
+			mInstance->mUserGen->GetSkeletonCap().LoadCalibrationDataFromFile(nId, mInstance->mCalibrationFile.c_str());
+			mInstance->mIsCalibrationFileCached = mInstance->mUserGen->GetSkeletonCap().SaveCalibrationData(nId, 0) == XN_STATUS_OK;
+		}
 		mInstance->startTracking(nId);
 	}
 	else if (mInstance->mNeedPoseForCalibration) {
@@ -584,7 +633,12 @@ void XN_CALLBACK_TYPE WuCinderNITE::CB_NewUser(xn::UserGenerator& generator, XnU
 void XN_CALLBACK_TYPE WuCinderNITE::CB_LostUser(xn::UserGenerator& generator, XnUserID nId, void* pCookie)
 {
 	ci::app::console() << "lost user " << nId << endl;
+	relay::UserSessionRecorder::getInstance()->recordEvent( relay::USER_SESSION_EVENT_LOST_USER, nId );
+	// Listeners may want to remember what the slot learned before it is reset
 	mInstance->signalLostUser(nId);
+	if (nId < MAX_USERS) {
+		mInstance->mGapFillers[nId].reset();
+	}
 }
 void XN_CALLBACK_TYPE WuCinderNITE::CB_CalibrationStart(xn::SkeletonCapability& capability, XnUserID nId, void* pCookie)
 {
@@ -604,6 +658,7 @@ void XN_CALLBACK_TYPE WuCinderNITE::CB_CalibrationEnd(xn::SkeletonCapability& ca
 void XN_CALLBACK_TYPE WuCinderNITE::CB_CalibrationComplete(xn::SkeletonCapability& skeleton, XnUserID nId, XnCalibrationStatus eStatus, void* cxt)
 {
 	ci::app::console() << "calibration completed for user " << nId << (eStatus == XN_CALIBRATION_STATUS_OK ? " success" : " failed") << endl;
+	relay::UserSessionRecorder::getInstance()->recordEvent( relay::USER_SESSION_EVENT_CALIBRATION, nId, eStatus == XN_CALIBRATION_STATUS_OK ? "success" : "failed" );
 	if (eStatus == XN_CALIBRATION_STATUS_OK) {
 		if (!mInstance->mIsCalibrated) {
 			if (mInstance->useSingleCalibrationMode) {
@@ -0,0 +1,150 @@
+/*
+ * GestureLibrary.cpp
+ *
+ *  Created on: Oct 23, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Every gesture the relay can play, packed into one file that is mapped once at startup - see GestureLibrary.h
+ */
+
+#include "GestureLibrary.h"
+#include "UserStreamMappedSource.h"
+#include <boost/static_assert.hpp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace relay {
+	BOOST_STATIC_ASSERT( sizeof(GESTURE_LIBRARY_HEADER) == 24 );
+	BOOST_STATIC_ASSERT( sizeof(GESTURE_LIBRARY_ENTRY) == 96 );
+
+	static const uint64_t RECORDING_ALIGNMENT = 8;
+
+	GestureLibrary* GestureLibrary::mInstance = NULL;
+	GestureLibrary* GestureLibrary::getInstance() {
+		if( mInstance == NULL ) {
+			mInstance = new GestureLibrary();
+		}
+		return mInstance;
+	}
+
+	GestureLibrary::GestureLibrary() {}
+
+	bool GestureLibrary::load( const std::string &aPath ) {
+		_file.reset();
+		_gestures.clear();
+		_entries.clear();
+
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) return false;
+
+		GESTURE_LIBRARY_HEADER header;
+		if( file->getSize() < sizeof(header) ) {
+			std::cout << "GestureLibrary::load - '" << aPath << "' is too small" << std::endl;
+			return false;
+		}
+		std::memcpy( &header, file->getData(), sizeof(header) );
+
+		bool isValid = std::memcmp( header.magic, GESTURE_LIBRARY_MAGIC, sizeof(GESTURE_LIBRARY_MAGIC) ) == 0
+				&& header.version == GESTURE_LIBRARY_VERSION
+				&& header.entriesOffset <= file->getSize()
+				&& header.gestureCount <= ( file->getSize() - header.entriesOffset ) / sizeof(GESTURE_LIBRARY_ENTRY);
+		if( !isValid ) {
+			std::cout << "GestureLibrary::load - '" << aPath << "' is not a gesture library" << std::endl;
+			return false;
+		}
+
+		std::vector<GESTURE_LIBRARY_ENTRY> entries( header.gestureCount );
+		if( !entries.empty() ) {
+			std::memcpy( &entries[0], file->getData() + header.entriesOffset, entries.size() * sizeof(GESTURE_LIBRARY_ENTRY) );
+		}
+
+		// Validate every recording now, so picking one later can not fail
+		for( size_t i = 0; i < entries.size(); ++i ) {
+			GESTURE_LIBRARY_ENTRY &entry = entries[i];
+			entry.name[GESTURE_LIBRARY_MAX_NAME - 1] = 0;
+
+			if( !UserStreamMappedSource::open( file, entry.offset, entry.length ) ) {
+				std::cout << "GestureLibrary::load - Gesture '" << entry.name << "' is corrupt" << std::endl;
+				return false;
+			}
+
+			GESTURE_INFO info;
+			info.name = entry.name;
+			info.weight = entry.weight;
+			info.frameCount = entry.frameCount;
+			info.duration = entry.duration;
+			_gestures.push_back( info );
+		}
+
+		_file = file;
+		_entries = entries;
+		std::cout << "GestureLibrary - Loaded " << _gestures.size() << " gestures from '" << aPath << "'" << std::endl;
+		return true;
+	}
+
+	IUserStreamSource_ptr GestureLibrary::getGesture( const std::string &aName ) {
+		for( size_t i = 0; i < _gestures.size(); ++i ) {
+			if( _gestures[i].name == aName ) {
+				return UserStreamMappedSource::open( _file, _entries[i].offset, _entries[i].length );
+			}
+		}
+		return IUserStreamSource_ptr();
+	}
+
+	bool GestureLibrary::write( const std::string &aPath, const std::vector<GESTURE_INFO> &gestures, const std::vector<std::string> &recordingPaths ) {
+		if( gestures.size() != recordingPaths.size() ) return false;
+
+		std::vector<GESTURE_LIBRARY_ENTRY> entries( gestures.size() );
+		std::vector<MappedFile_ptr> recordings( gestures.size() );
+
+		GESTURE_LIBRARY_HEADER header;
+		std::memset( &header, 0, sizeof(header) );
+		std::memcpy( header.magic, GESTURE_LIBRARY_MAGIC, sizeof(GESTURE_LIBRARY_MAGIC) );
+		header.version = GESTURE_LIBRARY_VERSION;
+		header.gestureCount = gestures.size();
+		header.entriesOffset = sizeof(header);
+
+		// Lay the recordings out after the table of contents
+		uint64_t offset = header.entriesOffset + entries.size() * sizeof(GESTURE_LIBRARY_ENTRY);
+		for( size_t i = 0; i < gestures.size(); ++i ) {
+			recordings[i] = MappedFile::open( recordingPaths[i] );
+			if( !recordings[i] ) return false;
+
+			IUserStreamSource_ptr source = UserStreamMappedSource::open( recordings[i], 0, recordings[i]->getSize() );
+			if( !source ) return false;
+
+			if( gestures[i].name.size() >= GESTURE_LIBRARY_MAX_NAME ) {
+				std::cout << "GestureLibrary::write - Name '" << gestures[i].name << "' is too long" << std::endl;
+				return false;
+			}
+
+			GESTURE_LIBRARY_ENTRY &entry = entries[i];
+			std::memset( &entry, 0, sizeof(entry) );
+			std::strncpy( entry.name, gestures[i].name.c_str(), GESTURE_LIBRARY_MAX_NAME - 1 );
+			entry.weight = gestures[i].weight;
+			entry.frameCount = source->getFrameCount();
+			entry.duration = source->getDuration();
+
+			offset = ( offset + RECORDING_ALIGNMENT - 1 ) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+			entry.offset = offset;
+			entry.length = recordings[i]->getSize();
+			offset += entry.length;
+		}
+
+		std::ofstream stream( aPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if( !stream.is_open() ) return false;
+
+		stream.write( (const char*)&header, sizeof(header) );
+		if( !entries.empty() ) stream.write( (const char*)&entries[0], entries.size() * sizeof(GESTURE_LIBRARY_ENTRY) );
+
+		static const char PADDING[RECORDING_ALIGNMENT] = { 0 };
+		uint64_t written = header.entriesOffset + entries.size() * sizeof(GESTURE_LIBRARY_ENTRY);
+		for( size_t i = 0; i < entries.size(); ++i ) {
+			stream.write( PADDING, entries[i].offset - written );
+			stream.write( recordings[i]->getData(), entries[i].length );
+			written = entries[i].offset + entries[i].length;
+		}
+		return stream.good();
+	}
+}
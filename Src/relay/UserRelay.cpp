@@ -25,6 +25,7 @@
 #include "UserStreamRecorder.h"
 #include "UserStreamPlayer.h"
 #include "UserStreamRepeater.h"
+#include "GestureLibrary.h"
 
 #include "simplegui/SimpleGUI.h"
 #include "Constants.h"
@@ -34,8 +35,12 @@ namespace relay {
 	UserRelay::UserRelay( WuCinderNITE* t_ni, UserTracker* t_tracker ) {
 		this->ni = t_ni;
 		this->tracker = t_tracker;
+		this->_isPendingFromIdleTimer = false;
 
+		// Map every gesture once, picking one later never touches the disk
+		GestureLibrary::getInstance()->load( ci::app::App::get()->getResourcePath( Constants::relay::player::GESTURE_LIBRARY ) );
 		setupGesturemap();
+		prefetchNextGesture();
 
 		// Create the FSM and set the initial state
 		this->fsm = new relay::UserStreamStateManager();
@@ -71,6 +76,15 @@ namespace relay {
 	}
 
 	void UserRelay::setupGesturemap() {
+		GestureLibrary *library = GestureLibrary::getInstance();
+		if( library->isLoaded() ) {
+			for( size_t i = 0; i < library->getGestureCount(); ++i ) {
+				const GESTURE_INFO &info = library->getGestureInfo( i );
+				gestures.insert( gestures.end(), info.weight, info.name );
+			}
+			return;
+		}
+
 		using namespace Constants::relay::player;
 		std::map<std::string, int>::iterator it = weightedGestures()->begin();
 		for(; it != weightedGestures()->end(); ++it ) {
@@ -106,6 +120,7 @@ namespace relay {
 	}
 
 	void UserRelay::update() {
+		updatePendingPlayback();
 		fsm->update();
 
 		if( Constants::Debug::USE_IDLE_TIMER ) {
@@ -113,8 +128,7 @@ namespace relay {
 
 			if( liveInstance ) {
 				if ( liveInstance->wantsToExit() ) {
-					ci::app::MouseEvent event;
-					setStatePlayback( event );
+					playNextGesture( true );
 				}
 
 			} else if ( tracker->activeUserId != 0 || fsm->getCurrentState()->wantsToExit() ) {
@@ -170,8 +184,53 @@ namespace relay {
 
 	std::string UserRelay::getRandomGesture() {
 		int index = ci::Rand::randInt( gestures.size() );
-		std::string path = ci::app::App::get()->getResourcePath( gestures.at( index ) );
-		return path;
+		return gestures.at( index );
+	}
+
+	void UserRelay::prefetchNextGesture() {
+		if( gestures.empty() ) return;
+		_nextGesture = UserStreamLoader::getInstance()->loadGesture( getRandomGesture() );
+	}
+
+	void UserRelay::updatePendingPlayback() {
+		if( !_pendingPlayback || !_pendingPlayback->isReady() ) return;
+
+		UserStreamLoad_ptr aLoad = _pendingPlayback;
+		_pendingPlayback.reset();
+
+		if( !aLoad->getSource() ) {
+			std::cout << "UserRelay - Failed to load '" << aLoad->getPath() << "', staying in the current state" << std::endl;
+			return;
+		}
+
+		// Someone stepped up while it loaded, the idle timer would switch straight back to live - keep it for next time.
+		// Recordings asked for through the GUI or dropped on the window play regardless
+		if( _isPendingFromIdleTimer && tracker->activeUserId != 0 ) {
+			_nextGesture = aLoad;
+			return;
+		}
+
+		UserStreamPlayer* player = new relay::UserStreamPlayer();
+		player->setSource( aLoad->getSource() );		// Note the UserStreamPlayer requires the recording to be set before 'enter'
+		this->fsm->changeState( player );
+
+		// Load the one after this while it plays
+		prefetchNextGesture();
+	}
+
+	void UserRelay::playNextGesture( bool isFromIdleTimer ) {
+		// Already waiting on one, keep the current state until it is ready - asking for it makes it play regardless
+		if( _pendingPlayback ) {
+			if( !isFromIdleTimer ) _isPendingFromIdleTimer = false;
+			return;
+		}
+
+		if( !_nextGesture ) prefetchNextGesture();
+		_pendingPlayback = _nextGesture;
+		_isPendingFromIdleTimer = isFromIdleTimer;
+		_nextGesture.reset();
+
+		updatePendingPlayback();	// Usually prefetched already, switch this frame
 	}
 
 	// Debug state switching
@@ -182,20 +241,16 @@ namespace relay {
 		this->fsm->changeState( new relay::UserStreamRecorder() ); return true;
 	};
 	bool UserRelay::setStatePlayback( ci::app::MouseEvent event ) {
-		UserStreamPlayer* player = new relay::UserStreamPlayer();
-		player->setJson( getRandomGesture() );			// Note the UserStreamPlayer requires the JSON to be set before 'enter' - set via string path or Json::Value
-		this->fsm->changeState( player );
-		return true;
+		playNextGesture( false ); return true;
 	};
 	bool UserRelay::setStateRepeater( ci::app::MouseEvent event ) { this->fsm->changeState( new relay::UserStreamRepeater() ); return true; };
 
 	bool UserRelay::fileDrop( ci::app::FileDropEvent event ) {
 			if(event.getNumFiles() != 1) return false;
-			UserStreamPlayer* player = new relay::UserStreamPlayer();
 			std::string fileRef = event.getFile(0);
 			std::cout << fileRef << std::endl;
-			player->setJson( fileRef );
-			this->fsm->changeState( player );
+			_pendingPlayback = UserStreamLoader::getInstance()->load( fileRef );
+			_isPendingFromIdleTimer = false;
 
 			return true;
 		}
@@ -0,0 +1,214 @@
+/*
+ * UserSessionFormat.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Session container validation and image codecs, see UserSessionFormat.h
+ */
+
+#include "UserSessionFormat.h"
+#include "RangeCoder.h"
+#include "UserStreamBinary.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+namespace relay {
+	namespace UserSessionFormat {
+		namespace {
+			// Residuals are coded with a model picked by how busy the neighbourhood is, flat areas and edges adapt separately
+			const int GRADIENT_CONTEXTS = 6;
+
+			inline int getGradientContext( int a, int b, int c ) {
+				int gradient = std::abs( a - c ) + std::abs( b - c );
+				if( gradient == 0 ) return 0;
+				if( gradient <= 2 ) return 1;
+				if( gradient <= 8 ) return 2;
+				if( gradient <= 32 ) return 3;
+				if( gradient <= 256 ) return 4;
+				return 5;
+			}
+
+			// LOCO-I median edge detector, a - left, b - top, c - top left
+			inline int predict( int a, int b, int c ) {
+				int lower = a < b ? a : b;
+				int upper = a < b ? b : a;
+				if( c >= upper ) return lower;
+				if( c <= lower ) return upper;
+				return a + b - c;
+			}
+
+			// Both directions walk the pixels the same way, Coder either writes the residual or reads it back into 'value'
+			template<typename T, typename Coder>
+			void predictChannels( const USER_SESSION_IMAGE_HEADER &image, T *pixels, Coder &coder ) {
+				const int channels = image.channels;
+				const int stride = image.width * channels;
+				std::vector<RangeIntegerModel> models( channels * GRADIENT_CONTEXTS );
+
+				for( int y = 0; y < image.height; ++y ) {
+					T *row = pixels + y * stride;
+					const T *above = y > 0 ? row - stride : NULL;
+
+					for( int x = 0; x < stride; ++x ) {
+						int channel = x % channels;
+						int a, b, c;
+						if( above == NULL ) {
+							a = x >= channels ? row[x - channels] : 0;
+							b = c = a;
+						} else if( x < channels ) {
+							a = b = c = above[x];
+						} else {
+							a = row[x - channels];
+							b = above[x];
+							c = above[x - channels];
+						}
+
+						RangeIntegerModel &model = models[ channel * GRADIENT_CONTEXTS + getGradientContext( a, b, c ) ];
+						coder( model, predict( a, b, c ), row[x] );
+					}
+				}
+			}
+
+			struct PredictEncoder {
+				PredictEncoder( RangeEncoder &anEncoder ) : encoder( anEncoder ) {};
+				template<typename T>
+				inline void operator()( RangeIntegerModel &model, int prediction, T &value ) { model.encode( encoder, (int)value - prediction ); }
+				RangeEncoder &encoder;
+			};
+
+			struct PredictDecoder {
+				PredictDecoder( RangeDecoder &aDecoder ) : decoder( aDecoder ) {};
+				template<typename T>
+				inline void operator()( RangeIntegerModel &model, int prediction, T &value ) { value = (T)( prediction + model.decode( decoder ) ); }
+				RangeDecoder &decoder;
+			};
+
+			template<typename T>
+			void encodeRuns( const T *values, size_t count, RangeEncoder &encoder ) {
+				RangeIntegerModel valueModel, lengthModel;
+				size_t i = 0;
+				int previous = 0;
+				while( i < count ) {
+					size_t end = i + 1;
+					while( end < count && values[end] == values[i] ) ++end;
+
+					// Values are coded against the run before, so a blob next to the background costs the same every row
+					valueModel.encode( encoder, (int)values[i] - previous );
+					lengthModel.encode( encoder, (int32_t)( end - i - 1 ) );
+					previous = values[i];
+					i = end;
+				}
+			}
+
+			template<typename T>
+			bool decodeRuns( T *values, size_t count, RangeDecoder &decoder ) {
+				RangeIntegerModel valueModel, lengthModel;
+				size_t i = 0;
+				int previous = 0;
+				while( i < count ) {
+					int value = previous + valueModel.decode( decoder );
+					int32_t length = lengthModel.decode( decoder );
+					if( length < 0 || (size_t)length >= count - i || decoder.isOverrun() ) return false;
+
+					std::fill( values + i, values + i + length + 1, (T)value );
+					previous = value;
+					i += length + 1;
+				}
+				return true;
+			}
+
+			template<typename T>
+			void encodePixels( const USER_SESSION_IMAGE_HEADER &image, const T *pixels, UserSessionCodec codec, RangeEncoder &encoder ) {
+				if( codec == USER_SESSION_CODEC_RUNS ) {
+					encodeRuns( pixels, (size_t)image.width * image.height * image.channels, encoder );
+				} else {
+					PredictEncoder coder( encoder );
+					predictChannels( image, pixels, coder );
+				}
+			}
+
+			template<typename T>
+			bool decodePixels( const USER_SESSION_IMAGE_HEADER &image, T *pixels, UserSessionCodec codec, RangeDecoder &decoder ) {
+				if( codec == USER_SESSION_CODEC_RUNS ) {
+					return decodeRuns( pixels, (size_t)image.width * image.height * image.channels, decoder );
+				}
+				PredictDecoder coder( decoder );
+				predictChannels( image, pixels, coder );
+				return true;
+			}
+		}
+
+		bool isValidHeader( const USER_SESSION_HEADER &header, uint64_t fileSize ) {
+			if( std::memcmp( header.magic, USER_SESSION_MAGIC, sizeof(USER_SESSION_MAGIC) ) != 0 ) return false;
+			if( header.version == 0 || header.version > USER_SESSION_VERSION ) return false;
+			return header.jointCount != 0 && fileSize >= sizeof(USER_SESSION_HEADER);
+		}
+
+		const char* getTrackName( UserSessionTrack track ) {
+			switch( track ) {
+				case USER_SESSION_TRACK_SKELETON: return "skeleton";
+				case USER_SESSION_TRACK_DEPTH: return "depth";
+				case USER_SESSION_TRACK_LABELS: return "labels";
+				case USER_SESSION_TRACK_RGB: return "rgb";
+				case USER_SESSION_TRACK_EVENTS: return "events";
+				default: return "unknown";
+			}
+		}
+
+		const char* getEventName( UserSessionEvent event ) {
+			switch( event ) {
+				case USER_SESSION_EVENT_NEW_USER: return "new user";
+				case USER_SESSION_EVENT_LOST_USER: return "lost user";
+				case USER_SESSION_EVENT_CALIBRATION: return "calibration";
+				case USER_SESSION_EVENT_STATE_CHANGE: return "state change";
+				case USER_SESSION_EVENT_SERIAL_MESSAGE: return "serial message";
+				case USER_SESSION_EVENT_MARKER: return "marker";
+				default: return "unknown";
+			}
+		}
+
+		size_t getSkeletonStride( uint16_t jointCount ) {
+			return sizeof(USER_SESSION_SKELETON_HEADER) + UserStreamBinary::getFrameStride( jointCount );
+		}
+
+		size_t getImageSize( const USER_SESSION_IMAGE_HEADER &image ) {
+			return (size_t)image.width * image.height * image.channels * image.bytesPerChannel;
+		}
+
+		UserSessionCodec encodeImage( const USER_SESSION_IMAGE_HEADER &image, const void *pixels, UserSessionCodec codec, std::vector<uint8_t> &output ) {
+			size_t start = output.size();
+			size_t rawSize = getImageSize( image );
+
+			if( codec != USER_SESSION_CODEC_RAW ) {
+				RangeEncoder encoder( output );
+				if( image.bytesPerChannel == 2 ) encodePixels( image, (const uint16_t*)pixels, codec, encoder );
+				else encodePixels( image, (const uint8_t*)pixels, codec, encoder );
+				encoder.flush();
+
+				if( output.size() - start < rawSize ) return codec;
+				output.resize( start );
+			}
+
+			output.insert( output.end(), (const uint8_t*)pixels, (const uint8_t*)pixels + rawSize );
+			return USER_SESSION_CODEC_RAW;
+		}
+
+		bool decodeImage( const USER_SESSION_IMAGE_HEADER &image, UserSessionCodec codec, const uint8_t *data, size_t length, void *pixels ) {
+			if( image.bytesPerChannel != 1 && image.bytesPerChannel != 2 ) return false;
+
+			if( codec == USER_SESSION_CODEC_RAW ) {
+				if( length != getImageSize( image ) ) return false;
+				std::memcpy( pixels, data, length );
+				return true;
+			}
+			if( codec != USER_SESSION_CODEC_PREDICT && codec != USER_SESSION_CODEC_RUNS ) return false;
+
+			RangeDecoder decoder( data, length );
+			bool isValid;
+			if( image.bytesPerChannel == 2 ) isValid = decodePixels( image, (uint16_t*)pixels, codec, decoder );
+			else isValid = decodePixels( image, (uint8_t*)pixels, codec, decoder );
+			return isValid && !decoder.isOverrun();
+		}
+	}
+}
@@ -0,0 +1,100 @@
+/*
+ * UserSessionPlayback.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Plays every track of a session against a single playhead, see UserSessionPlayback.h
+ */
+
+#include "UserSessionPlayback.h"
+#include "SkeletonStruct.h"
+#include <cstring>
+
+namespace relay {
+	UserSessionPlayback::UserSessionPlayback( UserSessionReader_ptr aReader ) : _reader( aReader ) {
+		for( int track = 0; track < USER_SESSION_TRACK_COUNT; ++track ) {
+			_cursors[track].chunk = -1;
+			_cursors[track].decodedChunk = -1;
+			_cursors[track].isDecoded = false;
+			std::memset( &_cursors[track].image, 0, sizeof(_cursors[track].image) );
+		}
+
+		_time = 0;
+		moveTo( 0, false );
+		_cursors[USER_SESSION_TRACK_EVENTS].chunk = -1;
+	}
+
+	UserSessionPlayback::~UserSessionPlayback() {
+		signalEvent.disconnect_all_slots();
+	}
+
+	void UserSessionPlayback::seek( double time ) {
+		moveTo( time, false );
+	}
+
+	void UserSessionPlayback::advance( double seconds ) {
+		moveTo( _time + seconds, true );
+	}
+
+	void UserSessionPlayback::moveTo( double time, bool shouldFireEvents ) {
+		_time = time;
+		for( int track = 0; track < USER_SESSION_TRACK_COUNT; ++track ) {
+			int previous = _cursors[track].chunk;
+			_cursors[track].chunk = _reader->findChunk( (UserSessionTrack)track, time );
+
+			if( track != USER_SESSION_TRACK_EVENTS || !shouldFireEvents ) continue;
+
+			// Every event passed since the last move, a listener may read the playback but not move it
+			const std::vector<USER_SESSION_INDEX_ENTRY> &events = _reader->getChunks( USER_SESSION_TRACK_EVENTS );
+			std::string text;
+			for( int i = previous + 1; i <= _cursors[track].chunk; ++i ) {
+				if( _reader->readEvent( events[i], text ) ) signalEvent( events[i].chunk, text );
+			}
+		}
+	}
+
+	bool UserSessionPlayback::decode( UserSessionTrack track ) {
+		TRACK_CURSOR &cursor = _cursors[track];
+		if( cursor.chunk < 0 ) return false;
+		if( cursor.chunk == cursor.decodedChunk ) return cursor.isDecoded;
+
+		const USER_SESSION_INDEX_ENTRY &entry = _reader->getChunks( track )[cursor.chunk];
+		if( track == USER_SESSION_TRACK_SKELETON ) cursor.isDecoded = _reader->readSkeletons( entry, _skeletons );
+		else cursor.isDecoded = _reader->readImage( entry, cursor.image, cursor.pixels );
+		cursor.decodedChunk = cursor.chunk;
+		return cursor.isDecoded;
+	}
+
+	const std::vector<USER_SESSION_SKELETON>& UserSessionPlayback::getSkeletons() {
+		if( !decode( USER_SESSION_TRACK_SKELETON ) ) _skeletons.clear();
+		return _skeletons;
+	}
+
+	bool UserSessionPlayback::getSkeleton( uint16_t user, SKELETON::SKELETON &skeleton ) {
+		const std::vector<USER_SESSION_SKELETON> &skeletons = getSkeletons();
+		for( std::vector<USER_SESSION_SKELETON>::const_iterator i = skeletons.begin(); i != skeletons.end(); ++i ) {
+			if( i->user != user ) continue;
+			skeleton = i->frame.skeleton;
+			return true;
+		}
+		return false;
+	}
+
+	const uint8_t* UserSessionPlayback::getImage( UserSessionTrack track, USER_SESSION_IMAGE_HEADER &image ) {
+		if( track != USER_SESSION_TRACK_DEPTH && track != USER_SESSION_TRACK_LABELS && track != USER_SESSION_TRACK_RGB ) return NULL;
+		if( !decode( track ) ) return NULL;
+
+		image = _cursors[track].image;
+		return &_cursors[track].pixels[0];
+	}
+
+	bool UserSessionPlayback::isCorrupt( UserSessionTrack track ) {
+		return _cursors[track].chunk >= 0 && track != USER_SESSION_TRACK_EVENTS && !decode( track );
+	}
+
+	double UserSessionPlayback::getChunkTime( UserSessionTrack track ) {
+		int chunk = _cursors[track].chunk;
+		return chunk < 0 ? -1 : _reader->getChunks( track )[chunk].chunk.timestamp;
+	}
+}
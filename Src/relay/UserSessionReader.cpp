@@ -0,0 +1,166 @@
+/*
+ * UserSessionReader.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Reads a session in place from a memory mapped file, see UserSessionReader.h
+ */
+
+#include "UserSessionReader.h"
+#include "UserStreamBinary.h"
+#include "SkeletonSanitize.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace relay {
+	namespace {
+		bool isEarlier( const USER_SESSION_INDEX_ENTRY &a, const USER_SESSION_INDEX_ENTRY &b ) {
+			return a.chunk.timestamp < b.chunk.timestamp;
+		}
+
+		bool isInOrder( const std::vector<USER_SESSION_INDEX_ENTRY> &chunks ) {
+			for( size_t i = 1; i < chunks.size(); ++i ) {
+				if( isEarlier( chunks[i], chunks[i - 1] ) ) return false;
+			}
+			return true;
+		}
+
+		bool isBefore( double time, const USER_SESSION_INDEX_ENTRY &entry ) {
+			return time < entry.chunk.timestamp;
+		}
+	}
+
+	UserSessionReader::UserSessionReader( MappedFile_ptr aFile ) : _file( aFile ) {
+		std::memset( &_header, 0, sizeof(_header) );
+		_isRecovered = false;
+		_duration = 0;
+	}
+
+	UserSessionReader::~UserSessionReader() {}
+
+	UserSessionReader_ptr UserSessionReader::open( const std::string &aPath ) {
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) return UserSessionReader_ptr();
+
+		if( file->getSize() < sizeof(USER_SESSION_HEADER) ) {
+			std::cout << "UserSessionReader::open - '" << aPath << "' is too small to be a session" << std::endl;
+			return UserSessionReader_ptr();
+		}
+
+		UserSessionReader *reader = new UserSessionReader( file );
+		std::memcpy( &reader->_header, file->getData(), sizeof(reader->_header) );
+		if( !UserSessionFormat::isValidHeader( reader->_header, file->getSize() ) ) {
+			std::cout << "UserSessionReader::open - '" << aPath << "' is not a valid session" << std::endl;
+			delete reader;
+			return UserSessionReader_ptr();
+		}
+
+		// A session that was never closed, or whose index is damaged, still has every chunk that made it to disk
+		if( !reader->readIndex() ) reader->recoverIndex();
+
+		for( int track = 0; track < USER_SESSION_TRACK_COUNT; ++track ) {
+			std::vector<USER_SESSION_INDEX_ENTRY> &chunks = reader->_tracks[track];
+			if( chunks.empty() ) continue;
+
+			// The writer keeps them in order, but findChunk() relies on it
+			if( !isInOrder( chunks ) ) std::stable_sort( chunks.begin(), chunks.end(), isEarlier );
+			reader->_duration = std::max( reader->_duration, chunks.back().chunk.timestamp );
+		}
+
+		if( reader->_isRecovered ) std::cout << "UserSessionReader::open - '" << aPath << "' was not closed, recovered " << reader->_duration << " seconds" << std::endl;
+		return UserSessionReader_ptr( reader );
+	}
+
+	bool UserSessionReader::readIndex() {
+		if( _header.indexOffset < sizeof(USER_SESSION_HEADER) || _header.indexOffset > _file->getSize() ) return false;
+		if( ( _file->getSize() - _header.indexOffset ) / sizeof(USER_SESSION_INDEX_ENTRY) < _header.indexCount ) return false;
+
+		std::vector<USER_SESSION_INDEX_ENTRY> index( _header.indexCount );
+		if( !index.empty() ) std::memcpy( &index[0], _file->getData() + _header.indexOffset, index.size() * sizeof(USER_SESSION_INDEX_ENTRY) );
+
+		for( std::vector<USER_SESSION_INDEX_ENTRY>::iterator i = index.begin(); i != index.end(); ++i ) {
+			if( i->chunk.track >= USER_SESSION_TRACK_COUNT ) return false;
+			if( i->offset < sizeof(USER_SESSION_HEADER) || i->offset >= _header.indexOffset ) return false;
+			if( i->offset + sizeof(USER_SESSION_CHUNK_HEADER) + i->chunk.length > _header.indexOffset ) return false;
+		}
+
+		for( std::vector<USER_SESSION_INDEX_ENTRY>::iterator i = index.begin(); i != index.end(); ++i ) {
+			_tracks[ i->chunk.track ].push_back( *i );
+		}
+		return true;
+	}
+
+	void UserSessionReader::recoverIndex() {
+		_isRecovered = true;
+		for( int track = 0; track < USER_SESSION_TRACK_COUNT; ++track ) _tracks[track].clear();
+
+		// Walk the chunks until one is cut short, which is where the writer was when it stopped
+		uint64_t size = _file->getSize();
+		uint64_t offset = sizeof(USER_SESSION_HEADER);
+		while( offset + sizeof(USER_SESSION_CHUNK_HEADER) <= size ) {
+			USER_SESSION_INDEX_ENTRY entry;
+			std::memcpy( &entry.chunk, _file->getData() + offset, sizeof(entry.chunk) );
+			if( entry.chunk.track >= USER_SESSION_TRACK_COUNT ) break;
+			if( offset + sizeof(USER_SESSION_CHUNK_HEADER) + entry.chunk.length > size ) break;
+
+			entry.offset = offset;
+			_tracks[ entry.chunk.track ].push_back( entry );
+			offset += sizeof(USER_SESSION_CHUNK_HEADER) + entry.chunk.length;
+		}
+	}
+
+	int UserSessionReader::findChunk( UserSessionTrack track, double time ) {
+		const std::vector<USER_SESSION_INDEX_ENTRY> &chunks = _tracks[track];
+		return (int)( std::upper_bound( chunks.begin(), chunks.end(), time, isBefore ) - chunks.begin() ) - 1;
+	}
+
+	const uint8_t* UserSessionReader::getPayload( const USER_SESSION_INDEX_ENTRY &entry ) {
+		return (const uint8_t*)_file->getData() + entry.offset + sizeof(USER_SESSION_CHUNK_HEADER);
+	}
+
+	bool UserSessionReader::readSkeletons( const USER_SESSION_INDEX_ENTRY &entry, std::vector<USER_SESSION_SKELETON> &skeletons ) {
+		skeletons.clear();
+		if( entry.chunk.track != USER_SESSION_TRACK_SKELETON ) return false;
+
+		size_t stride = UserSessionFormat::getSkeletonStride( _header.jointCount );
+		if( entry.chunk.length % stride != 0 ) return false;
+
+		const uint8_t *record = getPayload( entry );
+		skeletons.resize( entry.chunk.length / stride );
+		for( std::vector<USER_SESSION_SKELETON>::iterator i = skeletons.begin(); i != skeletons.end(); ++i, record += stride ) {
+			USER_SESSION_SKELETON_HEADER skeletonHeader;
+			std::memcpy( &skeletonHeader, record, sizeof(skeletonHeader) );
+			i->user = skeletonHeader.user;
+
+			UserStreamBinary::decodeFrame( (const char*)record + sizeof(skeletonHeader), _header.jointCount, i->frame );
+			SKELETON::sanitize( i->frame.skeleton, SKELETON::SANITIZE_DECODE );
+		}
+		return true;
+	}
+
+	bool UserSessionReader::readImageHeader( const USER_SESSION_INDEX_ENTRY &entry, USER_SESSION_IMAGE_HEADER &image ) {
+		if( entry.chunk.track != USER_SESSION_TRACK_DEPTH && entry.chunk.track != USER_SESSION_TRACK_LABELS && entry.chunk.track != USER_SESSION_TRACK_RGB ) return false;
+		if( entry.chunk.length < sizeof(image) ) return false;
+
+		std::memcpy( &image, getPayload( entry ), sizeof(image) );
+		return true;
+	}
+
+	bool UserSessionReader::readImage( const USER_SESSION_INDEX_ENTRY &entry, USER_SESSION_IMAGE_HEADER &image, std::vector<uint8_t> &pixels ) {
+		if( !readImageHeader( entry, image ) ) return false;
+
+		pixels.resize( UserSessionFormat::getImageSize( image ) );
+		if( pixels.empty() ) return false;
+
+		const uint8_t *data = getPayload( entry ) + sizeof(image);
+		return UserSessionFormat::decodeImage( image, (UserSessionCodec)entry.chunk.codec, data, entry.chunk.length - sizeof(image), &pixels[0] );
+	}
+
+	bool UserSessionReader::readEvent( const USER_SESSION_INDEX_ENTRY &entry, std::string &text ) {
+		if( entry.chunk.track != USER_SESSION_TRACK_EVENTS ) return false;
+		text.assign( (const char*)getPayload( entry ), entry.chunk.length );
+		return true;
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ * UserSessionRecorder.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Records everything the installation sees and does into a session, see UserSessionRecorder.h
+ */
+
+#include "UserSessionRecorder.h"
+#include "UserSessionWriter.h"
+#include "SkeletonStruct.h"
+#include "Constants.h"
+#include <boost/thread/once.hpp>
+#include <iostream>
+#include <sstream>
+
+namespace relay {
+	namespace {
+		// Session_1.dkx, Session_1_2.dkx, Session_1_3.dkx ...
+		std::string getPartPath( const std::string &aPath, int part ) {
+			if( part == 1 ) return aPath;
+
+			std::string extension( USER_SESSION_EXTENSION );
+			size_t stem = aPath.size();
+			if( aPath.size() >= extension.size() && aPath.compare( aPath.size() - extension.size(), extension.size(), extension ) == 0 ) {
+				stem -= extension.size();
+			}
+
+			std::stringstream path;
+			path << aPath.substr( 0, stem ) << "_" << part << aPath.substr( stem );
+			return path.str();
+		}
+	}
+
+	// Asked for from the capture thread and the main thread alike, recording or not
+	static boost::once_flag instanceFlag = BOOST_ONCE_INIT;
+	UserSessionRecorder* UserSessionRecorder::mInstance = NULL;
+	UserSessionRecorder* UserSessionRecorder::getInstance() {
+		boost::call_once( &UserSessionRecorder::createInstance, instanceFlag );
+		return mInstance;
+	}
+
+	void UserSessionRecorder::createInstance() {
+		mInstance = new UserSessionRecorder();
+	}
+
+	UserSessionRecorder::UserSessionRecorder() {
+		_part = 0;
+		_framenumber = 0;
+		_lastKeyframeTime = 0;
+	}
+
+	UserSessionRecorder::~UserSessionRecorder() {
+		stop();
+	}
+
+	bool UserSessionRecorder::start( const std::string &aPath ) {
+		stop();
+
+		boost::shared_ptr<UserSessionWriter> writer( new UserSessionWriter( aPath, Constants::relay::session::WRITER_QUEUE_BYTES ) );
+		boost::mutex::scoped_lock lock( _mutex );
+		_writer = writer;
+		_path = aPath;
+		_part = 1;
+		_framenumber = 0;
+		_lastKeyframeTime = -Constants::relay::session::RGB_KEYFRAME_SECONDS;
+		return true;
+	}
+
+	void UserSessionRecorder::stop() {
+		boost::shared_ptr<UserSessionWriter> writer, previousWriter;
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			writer.swap( _writer );
+			previousWriter.swap( _previousWriter );
+		}
+
+		// Released here, outside the lock, each joins its thread once the file is finished
+		if( writer ) writer->stop();
+	}
+
+	void UserSessionRecorder::rotate() {
+		using namespace Constants::relay::session;
+		if( _writer->getElapsedSeconds() < MAX_SESSION_SECONDS ) return;
+
+		// The finished part closes in the background - it is only joined on the next rotation, long after it is done,
+		// so the capture thread never waits for the disk. That releases the part before it, if any
+		_writer->stop();
+		_previousWriter = _writer;
+
+		std::string path = getPartPath( _path, ++_part );
+		_writer.reset( new UserSessionWriter( path, WRITER_QUEUE_BYTES ) );
+		_lastKeyframeTime = -RGB_KEYFRAME_SECONDS;
+		std::cout << "UserSessionRecorder - Continuing in '" << path << "'" << std::endl;
+	}
+
+	bool UserSessionRecorder::isRecording() {
+		return getWriter().get() != NULL;
+	}
+
+	boost::shared_ptr<UserSessionWriter> UserSessionRecorder::getWriter() {
+		boost::mutex::scoped_lock lock( _mutex );
+		return _writer;
+	}
+
+	void UserSessionRecorder::recordCapture( const SKELETON::SKELETON *skeletons, int count,
+			const uint16_t *depth, const uint16_t *labels, uint16_t width, uint16_t height,
+			const uint8_t *rgb, uint16_t rgbWidth, uint16_t rgbHeight ) {
+		boost::mutex::scoped_lock lock( _mutex );
+		if( !_writer ) return;
+		rotate();
+
+		using namespace Constants::relay::session;
+		_writer->pushSkeletons( skeletons, count, _framenumber );
+
+		// Depth and labels of the same capture go together
+		if( _framenumber % DEPTH_FRAME_INTERVAL == 0 ) {
+			USER_SESSION_IMAGE_HEADER image = { width, height, 1, 2, { 0, 0 } };
+			if( RECORD_DEPTH && depth ) _writer->pushImage( USER_SESSION_TRACK_DEPTH, image, depth );
+			if( RECORD_LABELS && labels ) _writer->pushImage( USER_SESSION_TRACK_LABELS, image, labels );
+		}
+
+		double time = _writer->getElapsedSeconds();
+		if( RECORD_RGB && rgb && time - _lastKeyframeTime >= RGB_KEYFRAME_SECONDS ) {
+			USER_SESSION_IMAGE_HEADER image = { rgbWidth, rgbHeight, 3, 1, { 0, 0 } };
+			if( _writer->pushImage( USER_SESSION_TRACK_RGB, image, rgb ) ) _lastKeyframeTime = time;
+		}
+		_framenumber++;
+	}
+
+	void UserSessionRecorder::recordEvent( UserSessionEvent event, uint16_t user, const std::string &text ) {
+		// Pushed with the lock held, a part being rotated out no longer takes events
+		boost::mutex::scoped_lock lock( _mutex );
+		if( _writer ) _writer->pushEvent( event, user, text );
+	}
+}
@@ -0,0 +1,265 @@
+/*
+ * UserSessionWriter.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Writes a session to disk from a single background thread, see UserSessionWriter.h
+ */
+
+#include "UserSessionWriter.h"
+#include "UserStreamBinary.h"
+#include "SkeletonStruct.h"
+#include <boost/bind.hpp>
+#include <cstring>
+#include <iostream>
+
+namespace relay {
+	UserSessionWriter::UserSessionWriter( const std::string &aPath, size_t aQueueBytes )
+		: _path( aPath ), _maxQueuedBytes( aQueueBytes ) {
+		_startTime = boost::posix_time::microsec_clock::universal_time();
+		_queuedBytes = 0;
+		_wasAnyoneTracked = false;
+		_shouldStop = false;
+		_isFinished = false;
+		_chunksWritten = 0;
+		_chunksDropped = 0;
+		_offset = 0;
+		_bytesWritten = 0;
+		_bytesPushed = 0;
+
+		_thread = boost::thread( boost::bind( &UserSessionWriter::run, this ) );
+	}
+
+	UserSessionWriter::~UserSessionWriter() {
+		stop();
+		_thread.join();
+	}
+
+	double UserSessionWriter::getElapsedSeconds() {
+		return ( boost::posix_time::microsec_clock::universal_time() - _startTime ).total_microseconds() / 1000000.0;
+	}
+
+	UserSessionWriter::PENDING_CHUNK* UserSessionWriter::beginChunk( UserSessionTrack track, uint8_t codec, uint16_t user, size_t bytes, bool canDrop ) {
+		if( _shouldStop ) return NULL;
+		if( canDrop && _queuedBytes + bytes > _maxQueuedBytes ) {
+			_chunksDropped++;
+			return NULL;
+		}
+
+		PENDING_CHUNK *chunk;
+		if( _spareChunks.empty() ) {
+			chunk = new PENDING_CHUNK();
+		} else {
+			chunk = _spareChunks.back();
+			_spareChunks.pop_back();
+		}
+
+		// Stamped while locked, so the file is in timeline order whichever thread pushed it
+		std::memset( &chunk->header, 0, sizeof(chunk->header) );
+		chunk->header.track = (uint8_t)track;
+		chunk->header.codec = codec;
+		chunk->header.user = user;
+		chunk->header.timestamp = getElapsedSeconds();
+		chunk->payload.resize( bytes );
+		_queuedBytes += bytes;
+		return chunk;
+	}
+
+	void UserSessionWriter::endChunk( PENDING_CHUNK *chunk ) {
+		_queue.push_back( chunk );
+	}
+
+	bool UserSessionWriter::pushSkeletons( const SKELETON::SKELETON *skeletons, int count, uint32_t framenumber ) {
+		const size_t stride = UserSessionFormat::getSkeletonStride( SKELETON::MAX_JOINTS );
+		int trackedCount = 0;
+		for( int i = 0; i < count; ++i ) {
+			if( skeletons[i].isTracking ) trackedCount++;
+		}
+
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			if( trackedCount == 0 && !_wasAnyoneTracked ) return true;
+
+			PENDING_CHUNK *chunk = beginChunk( USER_SESSION_TRACK_SKELETON, USER_SESSION_CODEC_RAW, 0, trackedCount * stride, true );
+			if( !chunk ) return false;
+			_wasAnyoneTracked = trackedCount != 0;
+
+			UserStreamFrame frame;
+			frame.framenumber = framenumber;
+			frame.timestamp = chunk->header.timestamp;
+			char *record = trackedCount ? (char*)&chunk->payload[0] : NULL;
+			for( int i = 0; i < count; ++i ) {
+				if( !skeletons[i].isTracking ) continue;
+
+				USER_SESSION_SKELETON_HEADER skeletonHeader;
+				std::memset( &skeletonHeader, 0, sizeof(skeletonHeader) );
+				skeletonHeader.user = (uint16_t)i;
+				std::memcpy( record, &skeletonHeader, sizeof(skeletonHeader) );
+
+				frame.skeleton = skeletons[i];
+				UserStreamBinary::encodeFrame( frame, record + sizeof(skeletonHeader) );
+				record += stride;
+			}
+			endChunk( chunk );
+		}
+		_condition.notify_one();
+		return true;
+	}
+
+	bool UserSessionWriter::pushImage( UserSessionTrack track, const USER_SESSION_IMAGE_HEADER &image, const void *pixels ) {
+		if( track != USER_SESSION_TRACK_DEPTH && track != USER_SESSION_TRACK_LABELS && track != USER_SESSION_TRACK_RGB ) return false;
+		if( image.bytesPerChannel != 1 && image.bytesPerChannel != 2 ) return false;
+
+		// Depth and color are smooth, labels are a few flat blobs
+		UserSessionCodec codec = track == USER_SESSION_TRACK_LABELS ? USER_SESSION_CODEC_RUNS : USER_SESSION_CODEC_PREDICT;
+		size_t imageSize = UserSessionFormat::getImageSize( image );
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			PENDING_CHUNK *chunk = beginChunk( track, (uint8_t)codec, 0, sizeof(image) + imageSize, true );
+			if( !chunk ) return false;
+
+			std::memcpy( &chunk->payload[0], &image, sizeof(image) );
+			std::memcpy( &chunk->payload[ sizeof(image) ], pixels, imageSize );
+			endChunk( chunk );
+		}
+		_condition.notify_one();
+		return true;
+	}
+
+	bool UserSessionWriter::pushEvent( UserSessionEvent event, uint16_t user, const std::string &text ) {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			PENDING_CHUNK *chunk = beginChunk( USER_SESSION_TRACK_EVENTS, (uint8_t)event, user, text.size(), false );
+			if( !chunk ) return false;
+
+			if( !text.empty() ) std::memcpy( &chunk->payload[0], text.data(), text.size() );
+			endChunk( chunk );
+		}
+		_condition.notify_one();
+		return true;
+	}
+
+	void UserSessionWriter::stop() {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			_shouldStop = true;
+		}
+		_condition.notify_one();
+	}
+
+	void UserSessionWriter::run() {
+		bool isOpen = openFile();
+
+		std::vector<PENDING_CHUNK*> batch;
+		while( true ) {
+			{
+				boost::mutex::scoped_lock lock( _mutex );
+				while( _queue.empty() && !_shouldStop ) {
+					_condition.wait( lock );
+				}
+				if( _queue.empty() && _shouldStop ) break;
+
+				// Take everything queued so far, coding and writing happen outside the lock
+				batch.assign( _queue.begin(), _queue.end() );
+				_queue.clear();
+			}
+
+			if( isOpen ) {
+				for( std::vector<PENDING_CHUNK*>::iterator i = batch.begin(); i != batch.end(); ++i ) {
+					writeChunk( **i );
+				}
+				_stream.flush();
+			}
+
+			{
+				boost::mutex::scoped_lock lock( _mutex );
+				for( std::vector<PENDING_CHUNK*>::iterator i = batch.begin(); i != batch.end(); ++i ) {
+					_queuedBytes -= (*i)->payload.size();
+					_spareChunks.push_back( *i );
+				}
+			}
+		}
+
+		if( isOpen ) closeFile();
+
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			for( std::vector<PENDING_CHUNK*>::iterator i = _spareChunks.begin(); i != _spareChunks.end(); ++i ) {
+				delete *i;
+			}
+			_spareChunks.clear();
+		}
+		_isFinished = true;
+	}
+
+	bool UserSessionWriter::openFile() {
+		std::memset( &_header, 0, sizeof(_header) );
+		std::memcpy( _header.magic, USER_SESSION_MAGIC, sizeof(USER_SESSION_MAGIC) );
+		_header.version = USER_SESSION_VERSION;
+		_header.jointCount = SKELETON::MAX_JOINTS;
+		_header.startTime = ( _startTime - boost::posix_time::ptime( boost::gregorian::date( 1970, 1, 1 ) ) ).total_microseconds() / 1000000.0;
+
+		_stream.open( _path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if( !_stream.is_open() ) {
+			std::cout << "UserSessionWriter - Failed to open '" << _path << "'" << std::endl;
+			return false;
+		}
+
+		// Placeholder, the index is only known once the session is closed
+		_stream.write( (const char*)&_header, sizeof(_header) );
+		_offset = sizeof(_header);
+		_index.clear();
+		return _stream.good();
+	}
+
+	void UserSessionWriter::writeChunk( PENDING_CHUNK &chunk ) {
+		USER_SESSION_CHUNK_HEADER header = chunk.header;
+		const uint8_t *data = chunk.payload.empty() ? NULL : &chunk.payload[0];
+		size_t length = chunk.payload.size();
+
+		if( header.track == USER_SESSION_TRACK_DEPTH || header.track == USER_SESSION_TRACK_LABELS || header.track == USER_SESSION_TRACK_RGB ) {
+			USER_SESSION_IMAGE_HEADER image;
+			std::memcpy( &image, data, sizeof(image) );
+
+			_encoded.assign( data, data + sizeof(image) );
+			header.codec = (uint8_t)UserSessionFormat::encodeImage( image, data + sizeof(image), (UserSessionCodec)header.codec, _encoded );
+			data = &_encoded[0];
+			length = _encoded.size();
+		}
+		header.length = (uint32_t)length;
+
+		USER_SESSION_INDEX_ENTRY entry;
+		entry.chunk = header;
+		entry.offset = _offset;
+		_index.push_back( entry );
+
+		_stream.write( (const char*)&header, sizeof(header) );
+		if( length ) _stream.write( (const char*)data, length );
+		_offset += sizeof(header) + length;
+		_bytesPushed += chunk.payload.size();
+		_bytesWritten += length;
+		_chunksWritten++;
+	}
+
+	void UserSessionWriter::closeFile() {
+		_header.indexOffset = _offset;
+		_header.indexCount = (uint32_t)_index.size();
+		if( !_index.empty() ) _stream.write( (const char*)&_index[0], _index.size() * sizeof(USER_SESSION_INDEX_ENTRY) );
+
+		_stream.seekp( 0 );
+		_stream.write( (const char*)&_header, sizeof(_header) );
+		bool isWritten = _stream.good();
+		_stream.close();
+
+		if( !isWritten ) {
+			std::cout << "UserSessionWriter - Failed to write '" << _path << "'" << std::endl;
+			return;
+		}
+
+		std::cout << "UserSessionWriter - Saved " << _chunksWritten << " chunks to '" << _path << "', " << ( _offset >> 10 ) << "KB";
+		if( _bytesPushed ) std::cout << " (" << ( 100 * _bytesWritten / _bytesPushed ) << "% of uncoded)";
+		if( _chunksDropped ) std::cout << ", dropped " << _chunksDropped;
+		std::cout << std::endl;
+	}
+}
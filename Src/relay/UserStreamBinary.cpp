@@ -0,0 +1,309 @@
+/*
+ * UserStreamBinary.cpp
+ *
+ *  Created on: Oct 19, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Binary skeleton recording format (.dks), the compact alternative to the JSON recordings.
+ *      	Records are written in host byte order, which is little endian on every machine we run on.
+ */
+
+#include "UserStreamBinary.h"
+#include "UserStreamDeltaCodec.h"
+#include <boost/static_assert.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace relay {
+
+	// The layout is the file format - make sure the compiler did not pad anything
+	BOOST_STATIC_ASSERT( sizeof(USER_STREAM_HEADER) == 64 );
+	BOOST_STATIC_ASSERT( sizeof(USER_STREAM_FRAME_HEADER) == 16 );
+	BOOST_STATIC_ASSERT( sizeof(USER_STREAM_INDEX_ENTRY) == 24 );
+	BOOST_STATIC_ASSERT( sizeof(SKELETON::SKELETON_JOINT) == 4 * sizeof(float) );
+
+	static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+
+	namespace UserStreamBinary {
+		uint32_t getFrameStride( uint16_t jointCount ) {
+			return (uint32_t)( sizeof(USER_STREAM_FRAME_HEADER) + jointCount * sizeof(SKELETON::SKELETON_JOINT) );
+		}
+
+		bool isValidHeader( const USER_STREAM_HEADER &header, uint64_t fileSize ) {
+			if( std::memcmp( header.magic, USER_STREAM_MAGIC, sizeof(USER_STREAM_MAGIC) ) != 0 ) return false;
+			if( header.version == 0 || header.version > USER_STREAM_VERSION ) return false;
+			if( header.jointCount == 0 || header.dataOffset < sizeof(USER_STREAM_HEADER) ) return false;
+
+			uint64_t dataEnd;
+			if( header.codec == USER_STREAM_CODEC_RAW ) {
+				if( header.frameStride != getFrameStride( header.jointCount ) ) return false;
+				if( header.dataOffset > fileSize ) return false;
+				if( (uint64_t)header.frameCount * header.frameStride > fileSize - header.dataOffset ) return false;
+				dataEnd = header.dataOffset + (uint64_t)header.frameCount * header.frameStride;
+			} else if( header.codec == USER_STREAM_CODEC_DELTA ) {
+				// Blocks can only be found through the index
+				if( header.indexInterval == 0 || header.indexOffset == 0 ) return false;
+				if( header.indexCount != ( header.frameCount + header.indexInterval - 1 ) / header.indexInterval ) return false;
+				dataEnd = header.indexOffset;
+			} else {
+				return false;
+			}
+
+			// Every frame, and the index if there is one, has to be inside the file.
+			// Sizes are compared against what is left of the file, offset + size could wrap
+			if( dataEnd > fileSize ) return false;
+			if( header.indexOffset != 0 ) {
+				if( header.indexOffset < dataEnd || header.indexOffset > fileSize ) return false;
+				if( (uint64_t)header.indexCount * sizeof(USER_STREAM_INDEX_ENTRY) > fileSize - header.indexOffset ) return false;
+			}
+			return true;
+		}
+
+		bool isValidIndex( const USER_STREAM_HEADER &header, const std::vector<USER_STREAM_INDEX_ENTRY> &index ) {
+			if( header.codec != USER_STREAM_CODEC_DELTA ) return true;	// Raw files never need their index
+
+			uint64_t previousOffset = header.dataOffset;
+			for( size_t i = 0; i < index.size(); ++i ) {
+				if( index[i].frame != i * header.indexInterval ) return false;
+				if( index[i].offset < previousOffset || index[i].offset > header.indexOffset ) return false;
+				previousOffset = index[i].offset;
+			}
+			return true;
+		}
+
+		void getBlock( const USER_STREAM_HEADER &header, const std::vector<USER_STREAM_INDEX_ENTRY> &index, uint32_t block,
+				uint64_t &offset, uint64_t &length, uint32_t &firstFrame, uint32_t &frameCount ) {
+			uint64_t end = block + 1 < index.size() ? index[block + 1].offset : header.indexOffset;
+			offset = index[block].offset;
+			length = end - offset;
+			firstFrame = index[block].frame;
+			frameCount = std::min( header.indexInterval, header.frameCount - firstFrame );
+		}
+
+		void encodeFrame( const UserStreamFrame &frame, char *record ) {
+			USER_STREAM_FRAME_HEADER frameHeader;
+			std::memset( &frameHeader, 0, sizeof(frameHeader) );
+			frameHeader.timestamp = frame.timestamp;
+			frameHeader.framenumber = frame.framenumber;
+			frameHeader.isTracking = frame.skeleton.isTracking ? 1 : 0;
+
+			std::memcpy( record, &frameHeader, sizeof(frameHeader) );
+			std::memcpy( record + sizeof(frameHeader), frame.skeleton.joints, sizeof(frame.skeleton.joints) );
+		}
+
+		void decodeFrame( const char *record, uint16_t jointCount, UserStreamFrame &frame ) {
+			USER_STREAM_FRAME_HEADER frameHeader;
+			std::memcpy( &frameHeader, record, sizeof(frameHeader) );
+			frame.timestamp = frameHeader.timestamp;
+			frame.framenumber = frameHeader.framenumber;
+			frame.skeleton.isTracking = frameHeader.isTracking != 0;
+
+			// Files from a build with more joints are truncated, ones with fewer leave the rest empty
+			int jointsToCopy = jointCount < SKELETON::MAX_JOINTS ? jointCount : SKELETON::MAX_JOINTS;
+			std::memcpy( frame.skeleton.joints, record + sizeof(frameHeader), jointsToCopy * sizeof(SKELETON::SKELETON_JOINT) );
+			for( int i = jointsToCopy; i < SKELETON::MAX_JOINTS; ++i ) {
+				frame.skeleton.joints[i] = SKELETON::SKELETON_JOINT();
+			}
+		}
+	}
+
+	///// WRITER
+	UserStreamBinaryWriter::UserStreamBinaryWriter() {
+		std::memset( &_header, 0, sizeof(_header) );
+		_offset = 0;
+		_firstTimestamp = 0;
+	}
+
+	UserStreamBinaryWriter::~UserStreamBinaryWriter() {
+		if( isOpen() ) close();
+	}
+
+	bool UserStreamBinaryWriter::open( const std::string &aPath, float aFrameRate, UserStreamCodec aCodec ) {
+		if( isOpen() ) close();
+
+		std::memset( &_header, 0, sizeof(_header) );
+		std::memcpy( _header.magic, USER_STREAM_MAGIC, sizeof(USER_STREAM_MAGIC) );
+		_header.version = USER_STREAM_VERSION;
+		_header.codec = aCodec;
+		_header.jointCount = SKELETON::MAX_JOINTS;
+		_header.frameRate = aFrameRate;
+		_header.unitsPerMeter = 1.0f;
+		_header.dataOffset = sizeof(USER_STREAM_HEADER);
+		_header.indexInterval = USER_STREAM_INDEX_INTERVAL;
+
+		// Compressed files only keep the joints NITE tracks, the rest are always empty
+		if( aCodec == USER_STREAM_CODEC_DELTA ) {
+			_header.frameStride = 0;
+			_header.jointMask = SKELETON::NiteJoints::mask;
+		} else {
+			_header.frameStride = (uint16_t)UserStreamBinary::getFrameStride( _header.jointCount );
+			_header.jointMask = (uint32_t)( ( 1 << SKELETON::MAX_JOINTS ) - 1 );
+		}
+
+		_index.clear();
+		_block.clear();
+		_record.resize( UserStreamBinary::getFrameStride( _header.jointCount ) );
+		_offset = _header.dataOffset;
+
+		_stream.open( aPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if( !_stream.is_open() ) {
+			std::cout << "UserStreamBinaryWriter::open - Failed to open '" << aPath << "'" << std::endl;
+			return false;
+		}
+
+		// Placeholder, the real header is written once we know the frame count
+		_stream.write( (const char*)&_header, sizeof(_header) );
+		return _stream.good();
+	}
+
+	void UserStreamBinaryWriter::write( const UserStreamFrame &frame ) {
+		if( !isOpen() ) return;
+
+		if( _header.frameCount == 0 ) _firstTimestamp = frame.timestamp;
+		_header.duration = frame.timestamp - _firstTimestamp;
+
+		if( _header.codec == USER_STREAM_CODEC_DELTA ) {
+			_block.push_back( frame );
+			if( _block.size() == _header.indexInterval ) writeBlock();
+		} else {
+			if( _header.frameCount % _header.indexInterval == 0 ) addIndexEntry( frame );
+
+			UserStreamBinary::encodeFrame( frame, &_record[0] );
+			_stream.write( &_record[0], _record.size() );
+			_offset += _record.size();
+		}
+		_header.frameCount++;
+	}
+
+	void UserStreamBinaryWriter::addIndexEntry( const UserStreamFrame &frame ) {
+		USER_STREAM_INDEX_ENTRY entry;
+		std::memset( &entry, 0, sizeof(entry) );
+		entry.frame = _index.size() * _header.indexInterval;
+		entry.timestamp = frame.timestamp;
+		entry.offset = _offset;
+		_index.push_back( entry );
+	}
+
+	void UserStreamBinaryWriter::writeBlock() {
+		if( _block.empty() ) return;
+
+		addIndexEntry( _block.front() );
+
+		_encoded.clear();
+		UserStreamDeltaCodec::encodeBlock( &_block[0], _block.size(), _header.jointMask, _encoded );
+		_stream.write( (const char*)&_encoded[0], _encoded.size() );
+		_offset += _encoded.size();
+		_block.clear();
+	}
+
+	bool UserStreamBinaryWriter::close() {
+		if( !isOpen() ) return false;
+
+		// Partial last block
+		if( _header.codec == USER_STREAM_CODEC_DELTA ) writeBlock();
+
+		// Footer index
+		_header.indexCount = _index.size();
+		_header.indexOffset = _index.empty() ? 0 : _offset;
+		if( !_index.empty() ) {
+			_stream.write( (const char*)&_index[0], _index.size() * sizeof(USER_STREAM_INDEX_ENTRY) );
+		}
+
+		// Patch in the final header
+		_stream.seekp( 0 );
+		_stream.write( (const char*)&_header, sizeof(_header) );
+
+		bool success = _stream.good();
+		_stream.close();
+		_index.clear();
+		return success;
+	}
+
+	///// READER
+	UserStreamBinaryReader::UserStreamBinaryReader() {
+		std::memset( &_header, 0, sizeof(_header) );
+		_cachedBlock = NO_BLOCK;
+	}
+
+	UserStreamBinaryReader::~UserStreamBinaryReader() {
+		close();
+	}
+
+	bool UserStreamBinaryReader::open( const std::string &aPath ) {
+		close();
+
+		_stream.open( aPath.c_str(), std::ios::in | std::ios::binary );
+		if( !_stream.is_open() ) {
+			std::cout << "UserStreamBinaryReader::open - Failed to open '" << aPath << "'" << std::endl;
+			return false;
+		}
+
+		_stream.seekg( 0, std::ios::end );
+		uint64_t fileSize = (uint64_t)_stream.tellg();
+		_stream.seekg( 0, std::ios::beg );
+
+		_stream.read( (char*)&_header, sizeof(_header) );
+		if( !_stream.good() || !UserStreamBinary::isValidHeader( _header, fileSize ) ) {
+			std::cout << "UserStreamBinaryReader::open - '" << aPath << "' is not a valid recording" << std::endl;
+			close();
+			return false;
+		}
+
+		if( _header.indexCount > 0 ) {
+			_index.resize( _header.indexCount );
+			_stream.seekg( _header.indexOffset );
+			_stream.read( (char*)&_index[0], _index.size() * sizeof(USER_STREAM_INDEX_ENTRY) );
+		}
+
+		if( !_stream.good() || !UserStreamBinary::isValidIndex( _header, _index ) ) {
+			std::cout << "UserStreamBinaryReader::open - '" << aPath << "' has a corrupt index" << std::endl;
+			close();
+			return false;
+		}
+
+		_record.resize( _header.frameStride );
+		return true;
+	}
+
+	void UserStreamBinaryReader::close() {
+		if( _stream.is_open() ) _stream.close();
+		_stream.clear();
+		std::memset( &_header, 0, sizeof(_header) );
+		_index.clear();
+		_blockFrames.clear();
+		_cachedBlock = NO_BLOCK;
+	}
+
+	bool UserStreamBinaryReader::readFrame( uint32_t index, UserStreamFrame &frame ) {
+		if( !_stream.is_open() || index >= _header.frameCount ) return false;
+
+		if( _header.codec == USER_STREAM_CODEC_DELTA ) {
+			uint32_t block = index / _header.indexInterval;
+			if( block != _cachedBlock ) {
+				uint64_t offset, length;
+				uint32_t firstFrame, frameCount;
+				UserStreamBinary::getBlock( _header, _index, block, offset, length, firstFrame, frameCount );
+
+				std::vector<char> encoded( (size_t)length );
+				_stream.seekg( offset );
+				if( length > 0 ) _stream.read( &encoded[0], length );
+
+				_blockFrames.resize( frameCount );
+				_cachedBlock = NO_BLOCK;
+				if( !_stream.good() || !UserStreamDeltaCodec::decodeBlock( (const uint8_t*)( length > 0 ? &encoded[0] : NULL ), length, frameCount, _header.jointMask, &_blockFrames[0] ) ) return false;
+				_cachedBlock = block;
+			}
+
+			frame = _blockFrames[ index % _header.indexInterval ];
+			return true;
+		}
+
+		_stream.seekg( _header.dataOffset + (uint64_t)index * _header.frameStride );
+		_stream.read( &_record[0], _record.size() );
+		if( !_stream.good() ) return false;
+
+		UserStreamBinary::decodeFrame( &_record[0], _header.jointCount, frame );
+		return true;
+	}
+}
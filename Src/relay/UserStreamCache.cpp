@@ -0,0 +1,142 @@
+/*
+ * UserStreamCache.cpp
+ *
+ *  Created on: Oct 24, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Process wide cache of loaded recordings, see UserStreamCache.h
+ */
+
+#include "UserStreamCache.h"
+#include "UserStreamBinary.h"
+#include "UserStreamMappedSource.h"
+#include "Constants.h"
+#include <boost/thread/once.hpp>
+#include <sys/stat.h>
+#include <cstring>
+#include <iostream>
+
+namespace relay {
+	// The loader thread and the main thread may both be first to ask for it
+	static boost::once_flag instanceFlag = BOOST_ONCE_INIT;
+	UserStreamCache* UserStreamCache::mInstance = NULL;
+	UserStreamCache* UserStreamCache::getInstance() {
+		boost::call_once( &UserStreamCache::createInstance, instanceFlag );
+		return mInstance;
+	}
+
+	void UserStreamCache::createInstance() {
+		mInstance = new UserStreamCache();
+	}
+
+	UserStreamCache::UserStreamCache() {
+		std::memset( &_stats, 0, sizeof(_stats) );
+		_stats.capacity = Constants::relay::player::RECORDING_CACHE_BYTES;
+	}
+
+	IUserStreamSource_ptr UserStreamCache::open( const std::string &aPath ) {
+		struct stat info;
+		if( stat( aPath.c_str(), &info ) != 0 ) {
+			std::cout << "UserStreamCache::open - '" << aPath << "' does not exist" << std::endl;
+			return IUserStreamSource_ptr();
+		}
+
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			for( std::list<ENTRY>::iterator it = _entries.begin(); it != _entries.end(); ++it ) {
+				if( it->path != aPath ) continue;
+
+				// Re-recorded since we loaded it, load it again
+				if( it->modified != info.st_mtime ) {
+					_stats.bytes -= it->bytes;
+					_entries.erase( it );
+					break;
+				}
+
+				_entries.splice( _entries.begin(), _entries, it );
+				_stats.hits++;
+				return createSource( _entries.front() );
+			}
+			_stats.misses++;
+		}
+
+		// Load without holding the lock, other recordings stay available meanwhile
+		ENTRY entry;
+		entry.path = aPath;
+		entry.modified = info.st_mtime;
+		if( !load( aPath, entry ) ) return IUserStreamSource_ptr();
+
+		IUserStreamSource_ptr source = createSource( entry );
+		if( !source ) return source;
+
+		boost::mutex::scoped_lock lock( _mutex );
+
+		// Another thread may have loaded the same recording meanwhile - hold it once, the newest version
+		for( std::list<ENTRY>::iterator it = _entries.begin(); it != _entries.end(); ++it ) {
+			if( it->path != aPath ) continue;
+
+			if( it->modified >= entry.modified ) {
+				_entries.splice( _entries.begin(), _entries, it );
+				return source;
+			}
+			_stats.bytes -= it->bytes;
+			_entries.erase( it );
+			break;
+		}
+
+		_entries.push_front( entry );
+		_stats.bytes += entry.bytes;
+		evict();
+		return source;
+	}
+
+	bool UserStreamCache::load( const std::string &aPath, ENTRY &entry ) {
+		std::string extension( USER_STREAM_BINARY_EXTENSION );
+		bool isBinary = aPath.size() >= extension.size() && aPath.compare( aPath.size() - extension.size(), extension.size(), extension ) == 0;
+
+		entry.file = MappedFile::open( aPath );
+		if( !entry.file ) return false;
+		entry.bytes = entry.file->getSize();
+		if( isBinary ) return true;
+
+		// Json is only scanned for where its frames are, they are decoded as they are played
+		entry.jsonIndex = UserStreamJSONSource::createIndex( entry.file );
+		if( !entry.jsonIndex ) return false;
+		entry.bytes += entry.jsonIndex->entries.capacity() * sizeof(USER_STREAM_INDEX_ENTRY);
+		return true;
+	}
+
+	IUserStreamSource_ptr UserStreamCache::createSource( const ENTRY &entry ) {
+		if( entry.jsonIndex ) return UserStreamJSONSource::open( entry.file, entry.jsonIndex );
+		return UserStreamMappedSource::open( entry.file, 0, entry.file->getSize() );
+	}
+
+	void UserStreamCache::evict() {
+		// Always keep the newest entry, even if it alone is over capacity
+		while( _stats.bytes > _stats.capacity && _entries.size() > 1 ) {
+			_stats.bytes -= _entries.back().bytes;
+			_stats.evictions++;
+			_entries.pop_back();
+		}
+		_stats.entries = _entries.size();
+	}
+
+	void UserStreamCache::setCapacity( size_t bytes ) {
+		boost::mutex::scoped_lock lock( _mutex );
+		_stats.capacity = bytes;
+		evict();
+	}
+
+	void UserStreamCache::clear() {
+		boost::mutex::scoped_lock lock( _mutex );
+		_entries.clear();
+		_stats.bytes = 0;
+		_stats.entries = 0;
+	}
+
+	USER_STREAM_CACHE_STATS UserStreamCache::getStats() {
+		boost::mutex::scoped_lock lock( _mutex );
+		_stats.entries = _entries.size();
+		return _stats;
+	}
+}
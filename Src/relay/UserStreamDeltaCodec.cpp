@@ -0,0 +1,165 @@
+/*
+ * UserStreamDeltaCodec.cpp
+ *
+ *  Created on: Oct 22, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Inter-frame delta compression for recordings, see UserStreamDeltaCodec.h
+ */
+
+#include "UserStreamDeltaCodec.h"
+#include "RangeCoder.h"
+#include "SkeletonJointSet.h"
+#include <cmath>
+
+namespace relay {
+	namespace UserStreamDeltaCodec {
+		namespace {
+			// A frame as integers, the predictors only ever see these so encoder and decoder stay in lockstep
+			struct QUANTIZED_FRAME {
+				int32_t framenumber;
+				int32_t timestamp;
+				int32_t isTracking;
+				int32_t confidence[SKELETON::MAX_JOINTS];
+				int32_t position[SKELETON::MAX_JOINTS][3];
+			};
+
+			inline int32_t quantize( double value, double quantum ) {
+				if( value != value ) return 0;
+				double scaled = std::floor( value / quantum + 0.5 );
+				if( scaled > 2147483647.0 ) return 2147483647;
+				if( scaled < -2147483647.0 ) return -2147483647;
+				return (int32_t)scaled;
+			}
+
+			void quantizeFrame( const UserStreamFrame &frame, uint32_t jointMask, QUANTIZED_FRAME &quantized ) {
+				quantized.framenumber = (int32_t)frame.framenumber;
+				quantized.timestamp = quantize( frame.timestamp, TIMESTAMP_QUANTUM );
+				quantized.isTracking = frame.skeleton.isTracking ? 1 : 0;
+
+				for( int i = 0; i < SKELETON::MAX_JOINTS; ++i ) {
+					if( ( jointMask & JOINT_BIT(i) ) == 0 ) continue;
+
+					const SKELETON::SKELETON_JOINT &joint = frame.skeleton.joints[i];
+					quantized.confidence[i] = quantize( joint.confidence, 1.0 / CONFIDENCE_STEPS );
+					quantized.position[i][0] = quantize( joint.position.x, POSITION_QUANTUM );
+					quantized.position[i][1] = quantize( joint.position.y, POSITION_QUANTUM );
+					quantized.position[i][2] = quantize( joint.position.z, POSITION_QUANTUM );
+				}
+			}
+
+			void dequantizeFrame( const QUANTIZED_FRAME &quantized, uint32_t jointMask, UserStreamFrame &frame ) {
+				frame.framenumber = (uint32_t)quantized.framenumber;
+				frame.timestamp = quantized.timestamp * TIMESTAMP_QUANTUM;
+				frame.skeleton.isTracking = quantized.isTracking != 0;
+
+				for( int i = 0; i < SKELETON::MAX_JOINTS; ++i ) {
+					SKELETON::SKELETON_JOINT &joint = frame.skeleton.joints[i];
+					if( ( jointMask & JOINT_BIT(i) ) == 0 ) {
+						joint = SKELETON::SKELETON_JOINT();
+						joint.position = ci::Vec3f::zero();
+						continue;
+					}
+
+					joint.confidence = (float)( quantized.confidence[i] * ( 1.0 / CONFIDENCE_STEPS ) );
+					joint.position.x = (float)( quantized.position[i][0] * POSITION_QUANTUM );
+					joint.position.y = (float)( quantized.position[i][1] * POSITION_QUANTUM );
+					joint.position.z = (float)( quantized.position[i][2] * POSITION_QUANTUM );
+				}
+			}
+
+			// Residuals wrap around in unsigned arithmetic, so any int32 round trips exactly
+			inline void codeValue( RangeEncoder &encoder, RangeIntegerModel &model, int32_t &value, int32_t prediction ) {
+				model.encode( encoder, (int32_t)( (uint32_t)value - (uint32_t)prediction ) );
+			}
+			inline void codeValue( RangeDecoder &decoder, RangeIntegerModel &model, int32_t &value, int32_t prediction ) {
+				value = (int32_t)( (uint32_t)prediction + (uint32_t)model.decode( decoder ) );
+			}
+			inline void codeBit( RangeEncoder &encoder, uint16_t &probability, int32_t &value ) {
+				encoder.encodeBit( probability, value );
+			}
+			inline void codeBit( RangeDecoder &decoder, uint16_t &probability, int32_t &value ) {
+				value = decoder.decodeBit( probability );
+			}
+
+			// Linear extrapolation from the last two frames, the last frame if there is only one
+			inline int32_t predict( int frameInBlock, int32_t previous, int32_t beforePrevious ) {
+				if( frameInBlock == 0 ) return 0;
+				if( frameInBlock == 1 ) return previous;
+				return (int32_t)( 2 * (uint32_t)previous - (uint32_t)beforePrevious );
+			}
+
+			/**
+			 * Shared by encoding and decoding - the CODER overloads of codeValue/codeBit either write
+			 * the residual of 'value' or replace 'value' with prediction + decoded residual.
+			 */
+			class BlockCoder {
+			public:
+				BlockCoder( uint32_t aJointMask ) : _jointMask( aJointMask ), _frameInBlock( 0 ) {
+					_trackingProbability = RANGE_PROBABILITY_HALF;
+				}
+
+				template<class CODER>
+				void code( CODER &coder, QUANTIZED_FRAME &frame ) {
+					int k = _frameInBlock;
+
+					int32_t framenumberPrediction = k == 0 ? 0 : (int32_t)( (uint32_t)_previous.framenumber + 1 );
+					codeValue( coder, _framenumberModel, frame.framenumber, framenumberPrediction );
+					codeValue( coder, _timestampModel, frame.timestamp, predict( k, _previous.timestamp, _beforePrevious.timestamp ) );
+					codeBit( coder, _trackingProbability, frame.isTracking );
+
+					for( int i = 0; i < SKELETON::MAX_JOINTS; ++i ) {
+						if( ( _jointMask & JOINT_BIT(i) ) == 0 ) continue;
+
+						// NITE confidence jumps between a few levels, the last value is the best guess
+						codeValue( coder, _confidenceModel, frame.confidence[i], k == 0 ? 0 : _previous.confidence[i] );
+						// Sensor noise outweighs motion at 30fps, so extrapolating positions costs more than it saves
+						for( int axis = 0; axis < 3; ++axis ) {
+							codeValue( coder, _positionModels[axis], frame.position[i][axis], k == 0 ? 0 : _previous.position[i][axis] );
+						}
+					}
+
+					_beforePrevious = _previous;
+					_previous = frame;
+					_frameInBlock++;
+				}
+
+			private:
+				uint32_t _jointMask;
+				int _frameInBlock;
+				QUANTIZED_FRAME _previous;
+				QUANTIZED_FRAME _beforePrevious;
+
+				RangeIntegerModel _framenumberModel;
+				RangeIntegerModel _timestampModel;
+				RangeIntegerModel _confidenceModel;
+				RangeIntegerModel _positionModels[3];
+				uint16_t _trackingProbability;
+			};
+		}
+
+		void encodeBlock( const UserStreamFrame *frames, uint32_t count, uint32_t jointMask, std::vector<uint8_t> &output ) {
+			RangeEncoder encoder( output );
+			BlockCoder coder( jointMask );
+
+			QUANTIZED_FRAME quantized;
+			for( uint32_t i = 0; i < count; ++i ) {
+				quantizeFrame( frames[i], jointMask, quantized );
+				coder.code( encoder, quantized );
+			}
+			encoder.flush();
+		}
+
+		bool decodeBlock( const uint8_t *data, size_t length, uint32_t count, uint32_t jointMask, UserStreamFrame *frames ) {
+			RangeDecoder decoder( data, length );
+			BlockCoder coder( jointMask );
+
+			QUANTIZED_FRAME quantized;
+			for( uint32_t i = 0; i < count; ++i ) {
+				coder.code( decoder, quantized );
+				dequantizeFrame( quantized, jointMask, frames[i] );
+			}
+			return !decoder.isOverrun();
+		}
+	}
+}
@@ -4,11 +4,14 @@
  *  Created on: Sep 24, 2011
  *      Author: onedayitwillmake
  *      Abstract: This class represents a single frame of UserStream data.
- *      It contains a framenumber, and a SKELETON::SKELETON struct.
+ *      It contains a framenumber, a timestamp and a SKELETON::SKELETON struct.
  *      It is able to output itself as a jsonstring, or create itself from a json string
  */
 
 #include "UserStreamFrame.h"
+#include "SkeletonJointSet.h"
+#include "Constants.h"
+#include "json/writer.h"
 
 #include <iterator>
 
@@ -16,34 +19,63 @@
 #define ZERO_IF_NAN(__X__) (__X__ != __X__) ? 0.0f : __X__
 namespace relay
 {
+	namespace {
+		// Reads one joint out of the 'joints' json array, used with SKELETON::NiteJoints::visit
+		struct ReadJointJSON {
+			ReadJointJSON( const Json::Value &aJointInfo, SKELETON::SKELETON &aSkeleton )
+				: jointInfo( aJointInfo ), skeleton( aSkeleton ) {};
+
+			void operator()( int i ) {
+				const Json::Value &joint = jointInfo[i];
+				const Json::Value &position = joint["position"];
+				skeleton.joints[i].confidence = (float)joint["confidence"].asDouble();
+				skeleton.joints[i].position.x = (float)position["x"].asDouble();
+				skeleton.joints[i].position.y = (float)position["y"].asDouble();
+				skeleton.joints[i].position.z = (float)position["z"].asDouble();
+			}
+
+			const Json::Value &jointInfo;
+			SKELETON::SKELETON &skeleton;
+		};
+	}
+
+	UserStreamFrame::UserStreamFrame() {
+		framenumber = 0;
+		timestamp = 0;
+		skeleton.isTracking = false;
+		for( int i = 0; i < SKELETON::MAX_JOINTS; ++i ) {
+			skeleton.joints[i].position = ci::Vec3f::zero();
+		}
+	}
 
-	UserStreamFrame::UserStreamFrame( uint32_t aFramenumber, SKELETON::SKELETON &aSkeleton ) {
+	UserStreamFrame::UserStreamFrame( uint32_t aFramenumber, SKELETON::SKELETON &aSkeleton, double aTimestamp ) {
 		framenumber = aFramenumber;
+		timestamp = aTimestamp;
 		skeleton = aSkeleton;
 	}
 	UserStreamFrame::~UserStreamFrame() {}
 
-	UserStreamFrame_ptr UserStreamFrame::fromJSON( Json::Value json  ) {
+	UserStreamFrame_ptr UserStreamFrame::fromJSON( const Json::Value &json ) {
 		SKELETON::SKELETON aSkeleton;
 
-		aSkeleton.isTracking = json["skeletonData"]["isTracking"].asBool();
-		Json::Value jointInfo = json["skeletonData"]["joints"];
+		const Json::Value &skeletonData = json["skeletonData"];
+		aSkeleton.isTracking = skeletonData["isTracking"].asBool();
 
-		// iterate and get position/confidence data from each joint
-		size_t length = sizeof(aSkeleton.joints) / sizeof(SKELETON::SKELETON_JOINT);
-		for( int i = 0; i < length; ++i ) {
-			aSkeleton.joints[i].confidence = (float)jointInfo[i]["confidence"].asDouble();
-			aSkeleton.joints[i].position.x = (float)jointInfo[i]["position"]["x"].asDouble();
-			aSkeleton.joints[i].position.y = (float)jointInfo[i]["position"]["y"].asDouble();
-			aSkeleton.joints[i].position.z = (float)jointInfo[i]["position"]["z"].asDouble();
-		}
+		// get position/confidence data from each joint NITE tracks, the rest are always empty
+		ReadJointJSON readJoint( skeletonData["joints"], aSkeleton );
+		SKELETON::NiteJoints::visit( readJoint );
 
-		return UserStreamFrame_ptr( new UserStreamFrame( json["framenumber"].asInt(), aSkeleton ) );
+		// Older recordings have no timestamp, assume they were captured at the nominal rate
+		uint32_t framenumber = json["framenumber"].asUInt();
+		double timestamp = json.isMember("timestamp") ? json["timestamp"].asDouble() : framenumber / Constants::relay::RECORDING_FRAME_RATE;
+
+		return UserStreamFrame_ptr( new UserStreamFrame( framenumber, aSkeleton, timestamp ) );
 	}
 
 	Json::Value UserStreamFrame::toJSON() {
 		Json::Value value;
 		value["framenumber"] = framenumber;
+		value["timestamp"] = timestamp;
 
 		Json::Value skeletonData;
 		skeletonData["isTracking"] = skeleton.isTracking;
@@ -76,4 +108,40 @@ namespace relay
 		value["skeletonData"] = skeletonData;
 		return value;
 	}
+
+	void UserStreamFrame::writeJSON( Json::StreamingWriter &writer ) const {
+		// Keys in the order Json::Value sorts them, so the text matches FastWriter's output of toJSON()
+		writer.beginObject();
+		writer.key( "framenumber" );
+		writer.value( Json::UInt( framenumber ) );
+
+		writer.key( "skeletonData" );
+		writer.beginObject();
+		writer.key( "isTracking" );
+		writer.value( skeleton.isTracking );
+		writer.key( "joints" );
+		writer.beginArray();
+		for( int i = 0; i < SKELETON::MAX_JOINTS; ++i ) {
+			const SKELETON::SKELETON_JOINT &joint = skeleton.joints[i];
+			writer.beginObject();
+			writer.key( "confidence" );
+			writer.value( (double)joint.confidence );
+			writer.key( "position" );
+			writer.beginObject();
+			writer.key( "x" );
+			writer.value( (double)( ZERO_IF_NAN( joint.position.x ) ) );
+			writer.key( "y" );
+			writer.value( (double)( ZERO_IF_NAN( joint.position.y ) ) );
+			writer.key( "z" );
+			writer.value( (double)( ZERO_IF_NAN( joint.position.z ) ) );
+			writer.endObject();
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.endObject();
+
+		writer.key( "timestamp" );
+		writer.value( timestamp );
+		writer.endObject();
+	}
 }
@@ -0,0 +1,506 @@
+/*
+ * UserStreamJSONParser.cpp
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Streaming parser for JSON skeleton recordings, see UserStreamJSONParser.h
+ */
+
+#include "UserStreamJSONParser.h"
+#include "SkeletonJointSet.h"
+#include "Constants.h"
+#include "MappedFile.h"
+#include "json/reader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define KEY_IS(__NAME__) ( keyLength == sizeof(__NAME__) - 1 && std::memcmp( key, __NAME__, keyLength ) == 0 )
+
+namespace relay {
+	namespace {
+		// Exactly representable powers of ten, products with a mantissa below 2^53 are correctly rounded
+		const double POWERS_OF_TEN[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		const int MAX_EXACT_POWER = 22;
+		const uint64_t MAX_EXACT_MANTISSA = (uint64_t)1 << 53;
+		const int MAX_MANTISSA_DIGITS = 19;
+	}
+
+	UserStreamJSONParser::UserStreamJSONParser() {
+		_begin = _current = _end = NULL;
+	}
+	UserStreamJSONParser::~UserStreamJSONParser() {}
+
+	bool UserStreamJSONParser::parseFile( const std::string &aPath, std::vector<UserStreamFrame> &frames ) {
+		// Parsed in place from the mapping, the text is never copied
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) {
+			_error = "Failed to open '" + aPath + "'";
+			return false;
+		}
+		return parse( file->getData(), file->getSize(), frames );
+	}
+
+	size_t UserStreamJSONParser::countFrames( const char *data, size_t length ) {
+		static const char KEY[] = "\"skeletonData\"";
+		static const size_t KEY_LENGTH = sizeof(KEY) - 1;
+
+		size_t count = 0;
+		const char *end = data + length;
+		const char *current = data;
+		while( current && end - current >= (ptrdiff_t)KEY_LENGTH ) {
+			current = (const char*)std::memchr( current, '"', end - current );
+			if( !current || end - current < (ptrdiff_t)KEY_LENGTH ) break;
+
+			if( std::memcmp( current, KEY, KEY_LENGTH ) == 0 ) {
+				++count;
+				current += KEY_LENGTH;
+			} else {
+				++current;
+			}
+		}
+		return count;
+	}
+
+	bool UserStreamJSONParser::parse( const char *data, size_t length, std::vector<UserStreamFrame> &frames ) {
+		_begin = _current = data;
+		_end = data + length;
+		_error.clear();
+
+		frames.reserve( frames.size() + countFrames( data, length ) );
+		if( !parseRecording( frames ) ) return false;
+
+		skipWhitespace();
+		if( _current != _end ) return fail( "Unexpected data after the recording" );
+		return true;
+	}
+
+	bool UserStreamJSONParser::index( const char *data, size_t length, uint32_t interval, std::vector<USER_STREAM_INDEX_ENTRY> &entries, uint32_t &frameCount ) {
+		_begin = _current = data;
+		_end = data + length;
+		_error.clear();
+		frameCount = 0;
+
+		if( !indexRecording( interval, entries, frameCount ) ) return false;
+
+		skipWhitespace();
+		if( _current != _end ) return fail( "Unexpected data after the recording" );
+		return true;
+	}
+
+	bool UserStreamJSONParser::parseFrames( const char *data, size_t length, uint64_t offset, uint32_t count, UserStreamFrame *frames ) {
+		_begin = data;
+		_current = data + offset;
+		_end = data + length;
+		_error.clear();
+
+		if( offset > length ) return fail( "Frame offset past the end of the recording" );
+		for( uint32_t i = 0; i < count; ++i ) {
+			if( i > 0 && !expect( ',' ) ) return false;
+			frames[i] = UserStreamFrame();
+			if( !parseFrame( frames[i] ) ) return false;
+		}
+		return true;
+	}
+
+	///// SCHEMA
+	bool UserStreamJSONParser::parseRecording( std::vector<UserStreamFrame> &frames ) {
+		if( !expect( '{' ) ) return false;
+
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) return true;
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			if( !KEY_IS("root") ) {
+				if( !skipValue() ) return false;
+				continue;
+			}
+
+			if( !expect( '[' ) ) return false;
+			bool isFirstFrame = true, hasFrame;
+			while( beginMember( isFirstFrame, hasFrame, ']' ) && hasFrame ) {
+				frames.push_back( UserStreamFrame() );
+				if( !parseFrame( frames.back() ) ) return false;
+			}
+			if( !_error.empty() ) return false;
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::indexRecording( uint32_t interval, std::vector<USER_STREAM_INDEX_ENTRY> &entries, uint32_t &frameCount ) {
+		if( !expect( '{' ) ) return false;
+
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) return true;
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			if( !KEY_IS("root") ) {
+				if( !skipValue() ) return false;
+				continue;
+			}
+
+			if( !expect( '[' ) ) return false;
+			bool isFirstFrame = true, hasFrame;
+			while( beginMember( isFirstFrame, hasFrame, ']' ) && hasFrame ) {
+				skipWhitespace();
+				if( frameCount % interval != 0 ) {
+					if( _current >= _end || *_current != '{' ) return fail( "Expected '{'" );
+					if( !skipStructure() ) return false;
+				} else {
+					USER_STREAM_INDEX_ENTRY entry;
+					std::memset( &entry, 0, sizeof(entry) );
+					entry.frame = frameCount;
+					entry.offset = _current - _begin;
+
+					UserStreamFrame frame;
+					if( !parseFrame( frame ) ) return false;
+					entry.timestamp = frame.timestamp;
+					entries.push_back( entry );
+				}
+				++frameCount;
+			}
+			if( !_error.empty() ) return false;
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::parseFrame( UserStreamFrame &frame ) {
+		if( !expect( '{' ) ) return false;
+
+		bool hasTimestamp = false;
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) {
+				// Older recordings have no timestamp, assume they were captured at the nominal rate
+				if( !hasTimestamp ) frame.timestamp = frame.framenumber / Constants::relay::RECORDING_FRAME_RATE;
+				return true;
+			}
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			double value;
+			if( KEY_IS("framenumber") ) {
+				if( !parseNumber( value ) ) return false;
+				frame.framenumber = (uint32_t)value;
+			} else if( KEY_IS("timestamp") ) {
+				if( !parseNumber( frame.timestamp ) ) return false;
+				hasTimestamp = true;
+			} else if( KEY_IS("skeletonData") ) {
+				if( !parseSkeleton( frame.skeleton ) ) return false;
+			} else if( !skipValue() ) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::parseSkeleton( SKELETON::SKELETON &skeleton ) {
+		if( !expect( '{' ) ) return false;
+
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) return true;
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			if( KEY_IS("isTracking") ) {
+				if( !parseBool( skeleton.isTracking ) ) return false;
+			} else if( KEY_IS("joints") ) {
+				if( !parseJoints( skeleton ) ) return false;
+			} else if( !skipValue() ) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::parseJoints( SKELETON::SKELETON &skeleton ) {
+		if( !expect( '[' ) ) return false;
+
+		int i = 0;
+		bool isFirst = true, hasJoint;
+		while( beginMember( isFirst, hasJoint, ']' ) ) {
+			if( !hasJoint ) return true;
+
+			// Only the joints NITE tracks are read, the rest are always empty
+			bool isTracked = i < SKELETON::MAX_JOINTS && SKELETON::NiteJoints::contains( i );
+			if( isTracked ) {
+				if( !parseJoint( skeleton.joints[i] ) ) return false;
+			} else if( !skipValue() ) {
+				return false;
+			}
+			++i;
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::parseJoint( SKELETON::SKELETON_JOINT &joint ) {
+		if( !expect( '{' ) ) return false;
+
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) return true;
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			double value;
+			if( KEY_IS("confidence") ) {
+				if( !parseNumber( value ) ) return false;
+				joint.confidence = (float)value;
+			} else if( KEY_IS("position") ) {
+				if( !parsePosition( joint.position ) ) return false;
+			} else if( !skipValue() ) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool UserStreamJSONParser::parsePosition( ci::Vec3f &position ) {
+		if( !expect( '{' ) ) return false;
+
+		bool isFirst = true, hasMember;
+		while( beginMember( isFirst, hasMember, '}' ) ) {
+			if( !hasMember ) return true;
+
+			const char *key; size_t keyLength;
+			if( !parseKey( key, keyLength ) ) return false;
+
+			double value;
+			if( keyLength == 1 && ( *key == 'x' || *key == 'y' || *key == 'z' ) ) {
+				if( !parseNumber( value ) ) return false;
+				position[ *key - 'x' ] = (float)value;
+			} else if( !skipValue() ) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	///// TOKENS
+	void UserStreamJSONParser::skipWhitespace() {
+		while( _current < _end && ( *_current == ' ' || *_current == '\n' || *_current == '\r' || *_current == '\t' ) ) {
+			++_current;
+		}
+	}
+
+	bool UserStreamJSONParser::expect( char c ) {
+		skipWhitespace();
+		if( _current >= _end || *_current != c ) {
+			std::string message( "Expected '" );
+			message += c;
+			message += "'";
+			return fail( message.c_str() );
+		}
+		++_current;
+		return true;
+	}
+
+	bool UserStreamJSONParser::beginMember( bool &isFirst, bool &hasMember, char closing ) {
+		skipWhitespace();
+		if( _current >= _end ) return fail( "Unexpected end of recording" );
+
+		if( *_current == closing ) {
+			++_current;
+			hasMember = false;
+			return true;
+		}
+
+		if( !isFirst && !expect( ',' ) ) return false;
+		isFirst = false;
+		hasMember = true;
+		return true;
+	}
+
+	bool UserStreamJSONParser::parseKey( const char* &key, size_t &keyLength ) {
+		skipWhitespace();
+		if( _current >= _end || *_current != '"' ) return fail( "Expected a member name" );
+
+		key = _current + 1;
+		if( !skipString() ) return false;
+		keyLength = ( _current - 1 ) - key;	// Escapes are compared as written, the schema has none
+
+		return expect( ':' );
+	}
+
+	bool UserStreamJSONParser::parseNumber( double &value ) {
+		skipWhitespace();
+		const char *start = _current;
+
+		bool isNegative = _current < _end && *_current == '-';
+		if( isNegative ) ++_current;
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+
+		// Integer and fraction digits go into one mantissa, the fraction lowers the exponent
+		const char *digitsStart = _current;
+		while( _current < _end && *_current >= '0' && *_current <= '9' ) {
+			if( digits < MAX_MANTISSA_DIGITS ) { mantissa = mantissa * 10 + ( *_current - '0' ); if( mantissa ) ++digits; }
+			else ++exponent;
+			++_current;
+		}
+		if( _current == digitsStart ) return fail( "Expected a number" );
+
+		if( _current < _end && *_current == '.' ) {
+			++_current;
+			const char *fractionStart = _current;
+			while( _current < _end && *_current >= '0' && *_current <= '9' ) {
+				if( digits < MAX_MANTISSA_DIGITS ) { mantissa = mantissa * 10 + ( *_current - '0' ); if( mantissa ) ++digits; --exponent; }
+				++_current;
+			}
+			if( _current == fractionStart ) return fail( "Expected a digit after the decimal point" );
+		}
+
+		if( _current < _end && ( *_current == 'e' || *_current == 'E' ) ) {
+			++_current;
+			bool isExponentNegative = false;
+			if( _current < _end && ( *_current == '-' || *_current == '+' ) ) isExponentNegative = *_current++ == '-';
+
+			const char *exponentStart = _current;
+			int explicitExponent = 0;
+			while( _current < _end && *_current >= '0' && *_current <= '9' ) {
+				if( explicitExponent < 10000 ) explicitExponent = explicitExponent * 10 + ( *_current - '0' );
+				++_current;
+			}
+			if( _current == exponentStart ) return fail( "Expected a digit in the exponent" );
+			exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+		}
+
+		// Fast path when the result is a single correctly rounded operation
+		if( digits < MAX_MANTISSA_DIGITS && mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER ) {
+			value = (double)mantissa;
+			value = exponent < 0 ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+			if( isNegative ) value = -value;
+			return true;
+		}
+
+		// Eisel-Lemire for the rest, which is most of the 16-17 digits coordinates the recorder writes
+		if( !Json::charsToDouble( start, _current, value ) ) return fail( "Malformed number" );
+		return true;
+	}
+
+	bool UserStreamJSONParser::parseBool( bool &value ) {
+		skipWhitespace();
+		if( _end - _current >= 4 && std::memcmp( _current, "true", 4 ) == 0 ) {
+			_current += 4;
+			value = true;
+			return true;
+		}
+		if( _end - _current >= 5 && std::memcmp( _current, "false", 5 ) == 0 ) {
+			_current += 5;
+			value = false;
+			return true;
+		}
+		return fail( "Expected true or false" );
+	}
+
+	bool UserStreamJSONParser::skipString() {
+		++_current;	// Opening quote
+		while( _current < _end ) {
+			char c = *_current++;
+			if( c == '"' ) return true;
+			if( c == '\\' ) ++_current;
+		}
+		return fail( "Unterminated string" );
+	}
+
+	bool UserStreamJSONParser::skipValue() {
+		skipWhitespace();
+		if( _current >= _end ) return fail( "Unexpected end of recording" );
+
+		double number;
+		bool boolean;
+		switch( *_current ) {
+			case '"':
+				return skipString();
+			case 't': case 'f':
+				return parseBool( boolean );
+			case 'n':
+				if( _end - _current >= 4 && std::memcmp( _current, "null", 4 ) == 0 ) { _current += 4; return true; }
+				return fail( "Expected null" );
+			case '{': case '[': {
+				char closing = *_current == '{' ? '}' : ']';
+				++_current;
+
+				bool isFirst = true, hasMember;
+				while( beginMember( isFirst, hasMember, closing ) ) {
+					if( !hasMember ) return true;
+					if( closing == '}' ) {
+						const char *key; size_t keyLength;
+						if( !parseKey( key, keyLength ) ) return false;
+					}
+					if( !skipValue() ) return false;
+				}
+				return false;
+			}
+			default:
+				return parseNumber( number );
+		}
+	}
+
+	bool UserStreamJSONParser::skipStructure() {
+		// Numbers and literals never contain a bracket or a quote, so everything else is stepped over
+		// 16 bytes at a time where SSE2 is available, the recordings are mostly digits and indentation
+		int depth = 0;
+		while( _current < _end ) {
+#if defined(__SSE2__)
+			const __m128i quote = _mm_set1_epi8( '"' );
+			const __m128i openBrace = _mm_set1_epi8( '{' ), closeBrace = _mm_set1_epi8( '}' );
+			const __m128i openBracket = _mm_set1_epi8( '[' ), closeBracket = _mm_set1_epi8( ']' );
+			while( _end - _current >= 16 ) {
+				__m128i chunk = _mm_loadu_si128( (const __m128i*)_current );
+				__m128i isStructural = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ), _mm_cmpeq_epi8( chunk, openBrace ) ),
+						_mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, closeBrace ), _mm_cmpeq_epi8( chunk, openBracket ) ), _mm_cmpeq_epi8( chunk, closeBracket ) ) );
+				int mask = _mm_movemask_epi8( isStructural );
+				if( mask ) {
+					while( !( mask & 1 ) ) { mask >>= 1; ++_current; }
+					break;
+				}
+				_current += 16;
+			}
+			if( _current >= _end ) break;
+#endif
+			char c = *_current;
+			if( c == '"' ) {
+				if( !skipString() ) return false;
+				continue;
+			}
+			++_current;
+			if( c == '{' || c == '[' ) {
+				++depth;
+			} else if( c == '}' || c == ']' ) {
+				if( --depth == 0 ) return true;
+			}
+		}
+		return fail( "Unexpected end of recording" );
+	}
+
+	bool UserStreamJSONParser::fail( const char *message ) {
+		if( !_error.empty() ) return false;	// Keep the first error, the callers unwinding add nothing
+
+		std::stringstream ss;
+		ss << message << " at offset " << ( _current - _begin );
+		_error = ss.str();
+		return false;
+	}
+}
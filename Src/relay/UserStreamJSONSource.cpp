@@ -0,0 +1,84 @@
+/*
+ * UserStreamJSONSource.cpp
+ *
+ *  Created on: Oct 27, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over a memory mapped json recording, see UserStreamJSONSource.h
+ */
+
+#include "UserStreamJSONSource.h"
+#include "UserStreamJSONParser.h"
+#include "SkeletonSanitize.h"
+#include <algorithm>
+#include <iostream>
+
+namespace relay {
+	static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+
+	UserStreamJSONSource::UserStreamJSONSource( MappedFile_ptr aFile, UserStreamJSONIndex_ptr anIndex ) : _file( aFile ), _index( anIndex ) {
+		_cachedBlock = NO_BLOCK;
+	}
+
+	UserStreamJSONSource::~UserStreamJSONSource() {}
+
+	IUserStreamSource_ptr UserStreamJSONSource::open( const std::string &aPath ) {
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) return IUserStreamSource_ptr();
+
+		UserStreamJSONIndex_ptr index = createIndex( file );
+		if( !index ) return IUserStreamSource_ptr();
+		return open( file, index );
+	}
+
+	IUserStreamSource_ptr UserStreamJSONSource::open( MappedFile_ptr aFile, UserStreamJSONIndex_ptr anIndex ) {
+		return IUserStreamSource_ptr( new UserStreamJSONSource( aFile, anIndex ) );
+	}
+
+	UserStreamJSONIndex_ptr UserStreamJSONSource::createIndex( MappedFile_ptr aFile ) {
+		USER_STREAM_JSON_INDEX *index = new USER_STREAM_JSON_INDEX();
+		index->interval = USER_STREAM_INDEX_INTERVAL;
+		index->duration = 0;
+
+		UserStreamJSONParser parser;
+		bool isValid = parser.index( aFile->getData(), aFile->getSize(), index->interval, index->entries, index->frameCount );
+
+		// The last block gives the duration, and is the one most likely to be cut short
+		if( isValid && index->frameCount > 0 ) {
+			const USER_STREAM_INDEX_ENTRY &last = index->entries.back();
+			std::vector<UserStreamFrame> frames( index->frameCount - last.frame );
+			isValid = parser.parseFrames( aFile->getData(), aFile->getSize(), last.offset, frames.size(), &frames[0] );
+			if( isValid ) index->duration = frames.back().timestamp - index->entries.front().timestamp;
+		}
+
+		if( !isValid ) {
+			std::cout << "UserStreamJSONSource::createIndex - Failed to index '" << aFile->getPath() << "'\n" << parser.getError() << std::endl;
+			delete index;
+			return UserStreamJSONIndex_ptr();
+		}
+		return UserStreamJSONIndex_ptr( index );
+	}
+
+	bool UserStreamJSONSource::getFrame( uint32_t index, UserStreamFrame &frame ) {
+		if( index >= _index->frameCount ) return false;
+
+		uint32_t block = index / _index->interval;
+		if( block != _cachedBlock ) {
+			const USER_STREAM_INDEX_ENTRY &entry = _index->entries[block];
+			uint32_t frameCount = std::min( _index->interval, _index->frameCount - entry.frame );
+
+			_blockFrames.resize( frameCount );
+			_cachedBlock = NO_BLOCK;
+
+			UserStreamJSONParser parser;
+			if( !parser.parseFrames( _file->getData(), _file->getSize(), entry.offset, frameCount, &_blockFrames[0] ) ) return false;
+			for( uint32_t i = 0; i < frameCount; ++i ) {
+				SKELETON::sanitize( _blockFrames[i].skeleton, SKELETON::SANITIZE_DECODE );
+			}
+			_cachedBlock = block;
+		}
+
+		frame = _blockFrames[ index % _index->interval ];
+		return true;
+	}
+}
@@ -13,6 +13,7 @@
 #include "WuCinderNITE.h"
 #include "UserTracker.h"
 #include "SkeletonStruct.h"
+#include "SkeletonJointSet.h"
 #include "cinder/Rand.h"
 
 #include "boost/bind.hpp"
@@ -60,7 +61,7 @@ namespace relay {
 
 		SKELETON::SKELETON aSkeleton;
 		if( _activeUserID != 0 && ++_framesActive > Constants::relay::FRAMES_BEFORE_CONSIDERED_REAL_USER ) {
-			aSkeleton = ni->skeletons[ _activeUserID ];
+			SKELETON::NiteJoints::copy( ni->skeletons[ _activeUserID ], aSkeleton );
 		} else { // is false by default?
 			aSkeleton.isTracking = false;
 			++_framesInactive;
@@ -78,7 +79,8 @@ namespace relay {
 		std::cout << "UserStreamLive::newUser - newUserID " << id << "ActiveUserID" << tracker->activeUserId << std::endl;
 		_activeUserID = tracker->activeUserId;
 
-		_framesActive = 0;
+		// Someone we just lost coming back under a new id doesn't need to prove they're real again
+		_framesActive = tracker->wasReidentified( _activeUserID ) ? Constants::relay::FRAMES_BEFORE_CONSIDERED_REAL_USER : 0;
 		_framesInactive = 0;
 	}
 
@@ -0,0 +1,114 @@
+/*
+ * UserStreamLoader.cpp
+ *
+ *  Created on: Oct 25, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Loads recordings on a background thread, see UserStreamLoader.h
+ */
+
+#include "UserStreamLoader.h"
+#include "UserStreamCache.h"
+#include "UserStreamBinary.h"
+#include "GestureLibrary.h"
+#include "SkeletonSanitize.h"
+#include "cinder/app/App.h"
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+namespace relay {
+	UserStreamLoad::UserStreamLoad( const std::string &aPath ) : _path( aPath ), _isReady( false ) {}
+
+	bool UserStreamLoad::isReady() {
+		boost::mutex::scoped_lock lock( _mutex );
+		return _isReady;
+	}
+
+	void UserStreamLoad::wait() {
+		boost::mutex::scoped_lock lock( _mutex );
+		while( !_isReady ) {
+			_condition.wait( lock );
+		}
+	}
+
+	IUserStreamSource_ptr UserStreamLoad::getSource() {
+		boost::mutex::scoped_lock lock( _mutex );
+		return _source;
+	}
+
+	void UserStreamLoad::setSource( IUserStreamSource_ptr aSource ) {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			_source = aSource;
+			_isReady = true;
+		}
+		_condition.notify_all();
+	}
+
+
+	UserStreamLoader* UserStreamLoader::mInstance = NULL;
+	UserStreamLoader* UserStreamLoader::getInstance() {
+		if( mInstance == NULL ) {
+			mInstance = new UserStreamLoader();
+		}
+		return mInstance;
+	}
+
+	UserStreamLoader::UserStreamLoader() {
+		_shouldStop = false;
+		_thread = boost::thread( boost::bind( &UserStreamLoader::run, this ) );
+	}
+
+	UserStreamLoader::~UserStreamLoader() {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			_shouldStop = true;
+		}
+		_condition.notify_one();
+		_thread.join();
+	}
+
+	UserStreamLoad_ptr UserStreamLoader::load( const std::string &aPath ) {
+		UserStreamLoad_ptr aLoad( new UserStreamLoad( aPath ) );
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			_queue.push_back( aLoad );
+		}
+		_condition.notify_one();
+		return aLoad;
+	}
+
+	UserStreamLoad_ptr UserStreamLoader::loadGesture( const std::string &aName ) {
+		// Library gestures are already mapped, they are ready immediately
+		IUserStreamSource_ptr aSource = GestureLibrary::getInstance()->getGesture( aName );
+		if( aSource ) {
+			UserStreamLoad_ptr aLoad( new UserStreamLoad( aName ) );
+			aLoad->setSource( aSource );
+			return aLoad;
+		}
+
+		// No library - load the resource, preferring a binary version since it is mapped instead of parsed
+		std::string path = ci::app::App::get()->getResourcePath( aName );
+		std::string binaryPath = boost::filesystem::path( path ).replace_extension( USER_STREAM_BINARY_EXTENSION ).string();
+		return load( boost::filesystem::exists( binaryPath ) ? binaryPath : path );
+	}
+
+	void UserStreamLoader::run() {
+		SKELETON::enableFlushToZero();
+		while( true ) {
+			UserStreamLoad_ptr aLoad;
+			{
+				boost::mutex::scoped_lock lock( _mutex );
+				while( _queue.empty() && !_shouldStop ) {
+					_condition.wait( lock );
+				}
+				if( _shouldStop ) break;
+
+				aLoad = _queue.front();
+				_queue.pop_front();
+			}
+
+			aLoad->setSource( UserStreamCache::getInstance()->open( aLoad->getPath() ) );
+		}
+	}
+}
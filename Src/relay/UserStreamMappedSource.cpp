@@ -0,0 +1,99 @@
+/*
+ * UserStreamMappedSource.cpp
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over a memory mapped binary (.dks) recording.
+ */
+
+#include "UserStreamMappedSource.h"
+#include "UserStreamDeltaCodec.h"
+#include "SkeletonSanitize.h"
+#include <cstring>
+#include <iostream>
+
+namespace relay {
+	static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+
+	UserStreamMappedSource::UserStreamMappedSource() {
+		_data = NULL;
+		_size = 0;
+		_cachedBlock = NO_BLOCK;
+		std::memset( &_header, 0, sizeof(_header) );
+	}
+
+	UserStreamMappedSource::~UserStreamMappedSource() {}
+
+	IUserStreamSource_ptr UserStreamMappedSource::open( const std::string &aPath ) {
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) return IUserStreamSource_ptr();
+		return open( file, 0, file->getSize() );
+	}
+
+	IUserStreamSource_ptr UserStreamMappedSource::open( MappedFile_ptr aFile, uint64_t anOffset, uint64_t aLength ) {
+		UserStreamMappedSource *source = new UserStreamMappedSource();
+		if( !source->map( aFile, anOffset, aLength ) ) {
+			delete source;
+			return IUserStreamSource_ptr();
+		}
+		return IUserStreamSource_ptr( source );
+	}
+
+	bool UserStreamMappedSource::map( MappedFile_ptr aFile, uint64_t anOffset, uint64_t aLength ) {
+		// Compared against what is left after the offset, the sum of untrusted values could wrap
+		if( anOffset > aFile->getSize() || aLength > aFile->getSize() - anOffset || aLength < sizeof(USER_STREAM_HEADER) ) {
+			std::cout << "UserStreamMappedSource::map - '" << aFile->getPath() << "' is too small to be a recording" << std::endl;
+			return false;
+		}
+
+		_file = aFile;
+		_data = aFile->getData() + anOffset;
+		_size = aLength;
+		std::memcpy( &_header, _data, sizeof(_header) );
+
+		if( !UserStreamBinary::isValidHeader( _header, _size ) ) {
+			std::cout << "UserStreamMappedSource::map - '" << aFile->getPath() << "' is not a valid recording" << std::endl;
+			return false;
+		}
+
+		// The index is copied out, compressed blocks leave it unaligned
+		_index.resize( _header.indexCount );
+		if( _header.indexCount > 0 ) {
+			std::memcpy( &_index[0], _data + _header.indexOffset, _index.size() * sizeof(USER_STREAM_INDEX_ENTRY) );
+		}
+		if( !UserStreamBinary::isValidIndex( _header, _index ) ) {
+			std::cout << "UserStreamMappedSource::map - '" << aFile->getPath() << "' has a corrupt index" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool UserStreamMappedSource::getFrame( uint32_t index, UserStreamFrame &frame ) {
+		if( index >= _header.frameCount ) return false;
+
+		if( _header.codec == USER_STREAM_CODEC_DELTA ) {
+			uint32_t block = index / _header.indexInterval;
+			if( block != _cachedBlock ) {
+				uint64_t offset, length;
+				uint32_t firstFrame, frameCount;
+				UserStreamBinary::getBlock( _header, _index, block, offset, length, firstFrame, frameCount );
+
+				_blockFrames.resize( frameCount );
+				_cachedBlock = NO_BLOCK;
+				if( !UserStreamDeltaCodec::decodeBlock( (const uint8_t*)_data + offset, length, frameCount, _header.jointMask, &_blockFrames[0] ) ) return false;
+				for( uint32_t i = 0; i < frameCount; ++i ) {
+					SKELETON::sanitize( _blockFrames[i].skeleton, SKELETON::SANITIZE_DECODE );
+				}
+				_cachedBlock = block;
+			}
+
+			frame = _blockFrames[ index % _header.indexInterval ];
+			return true;
+		}
+
+		UserStreamBinary::decodeFrame( _data + _header.dataOffset + (uint64_t)index * _header.frameStride, _header.jointCount, frame );
+		SKELETON::sanitize( frame.skeleton, SKELETON::SANITIZE_DECODE );
+		return true;
+	}
+}
@@ -0,0 +1,41 @@
+/*
+ * UserStreamMemorySource.cpp
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	IUserStreamSource over frames held in memory - used for JSON recordings and the repeater.
+ */
+
+#include "UserStreamMemorySource.h"
+#include "SkeletonSanitize.h"
+#include "json/value.h"
+
+namespace relay {
+	UserStreamMemorySource::UserStreamMemorySource( UserStreamFrames_ptr someFrames ) : _frames( someFrames ) {}
+	UserStreamMemorySource::~UserStreamMemorySource() {}
+
+	IUserStreamSource_ptr UserStreamMemorySource::fromJSON( const Json::Value &json ) {
+		std::vector<UserStreamFrame> *frames = new std::vector<UserStreamFrame>();
+
+		const Json::Value &root = json["root"];
+		frames->reserve( root.size() );
+		for( Json::ValueConstIterator itr = root.begin() ; itr != root.end() ; itr++ ) {
+			frames->push_back( *UserStreamFrame::fromJSON( (*itr) ) );
+			SKELETON::sanitize( frames->back().skeleton, SKELETON::SANITIZE_DECODE );
+		}
+
+		return IUserStreamSource_ptr( new UserStreamMemorySource( UserStreamFrames_ptr( frames ) ) );
+	}
+
+	double UserStreamMemorySource::getDuration() {
+		if( _frames->empty() ) return 0;
+		return _frames->back().timestamp - _frames->front().timestamp;
+	}
+
+	bool UserStreamMemorySource::getFrame( uint32_t index, UserStreamFrame &frame ) {
+		if( index >= _frames->size() ) return false;
+		frame = (*_frames)[index];
+		return true;
+	}
+}
@@ -5,21 +5,28 @@
  *      Author: mariogonzalez
  *      Abstract:
  *      	 This represents one of the states in the UserStreamStateManager
- *      	 It is responsible for playing a json skeleton recording
+ *      	 It is responsible for playing a json or binary (.dks) skeleton recording
  */
 
 #include "UserStreamPlayer.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cmath>
 
 #include "UserStreamLive.h"
 #include "UserStreamRecorder.h"
 #include "UserStreamPlayer.h"
+#include "UserStreamMemorySource.h"
+#include "UserStreamCache.h"
+#include "GestureLibrary.h"
+#include "UserStreamLoader.h"
 
 #include "WuCinderNITE.h"
 #include "UserTracker.h"
 #include "SkeletonStruct.h"
+#include "SkeletonBlend.h"
+#include "SkeletonSanitize.h"
 
 #include "json/reader.h"
 #include "simplegui/SimpleGUI.h"
@@ -29,6 +36,15 @@
 
 namespace relay {
 	UserStreamPlayer::UserStreamPlayer() {
+		_totalframes = 0;
+		_currentFrame = 0;
+		_displayedFrame = 0;
+		_playhead = 0;
+		_duration = 0;
+		_startTimestamp = 0;
+		_lastUpdateTime = 0;
+		_rate = 1.0f;
+		_frameIndex = -1;
 		_gui = NULL;
 		_label = NULL;
 		_toggle = NULL;
@@ -50,17 +66,17 @@ namespace relay {
 	}
 
 	void UserStreamPlayer::enter() {
-		if( _recording.size() == 0 ) {
-			std::cout << "UserStreamPlayer Error: You must call 'setJsonFromString', or 'setJsonFromValue' before this state is entered" << std::endl;
+		if( !_source || _source->getFrameCount() == 0 ) {
+			std::cout << "UserStreamPlayer Error: You must call 'setGesture', 'setRecording' or 'setSource' before this state is entered" << std::endl;
 			return;
 		}
 
 		ni = WuCinderNITE::getInstance();
 		tracker = UserTracker::getInstance();
 
-		_currentFrame = 0;
-		_state = PLAYING;
+		restart();
 		_shouldLoop = false;
+		_lastUpdateTime = ci::app::App::get()->getElapsedSeconds();
 		filedropCallbackId = ci::app::App::get()->registerFileDrop( this, &UserStreamPlayer::fileDrop );
 
 		if( Constants::Debug::USE_GUI ) {
@@ -84,12 +100,21 @@ namespace relay {
 			_miscGuis.push_back( _gui->addColumn() );
 			_miscGuis.push_back( _gui->addLabel("Gestures") );
 
-			using namespace Constants::relay::player;
-			std::map<std::string, int>::iterator it = weightedGestures()->begin();
-			for(; it != weightedGestures()->end(); ++it ) {
-				std::pair<std::string, int> aWeightPair = (*it);
+			std::vector<std::string> names;
+			GestureLibrary *library = GestureLibrary::getInstance();
+			for( size_t i = 0; i < library->getGestureCount(); ++i ) {
+				names.push_back( library->getGestureInfo( i ).name );
+			}
+			if( !library->isLoaded() ) {
+				using namespace Constants::relay::player;
+				std::map<std::string, int>::iterator it = weightedGestures()->begin();
+				for(; it != weightedGestures()->end(); ++it ) {
+					names.push_back( it->first );
+				}
+			}
 
-				mowa::sgui::ButtonControl* button = _gui->addButton( aWeightPair.first );
+			for( std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it ) {
+				mowa::sgui::ButtonControl* button = _gui->addButton( *it );
 				button->registerClick( this, &UserStreamPlayer::onRecordingSelected );
 				_miscGuis.push_back( button );
 			}
@@ -98,16 +123,39 @@ namespace relay {
 
 	void UserStreamPlayer::update() {
 
-		if(_state == PLAYING && _currentFrame <= _totalframes) _currentFrame++;
+		double now = ci::app::App::get()->getElapsedSeconds();
+		double elapsed = now - _lastUpdateTime;
+		_lastUpdateTime = now;
+
+		if( _pendingLoad && _pendingLoad->isReady() ) {
+			if( _pendingLoad->getSource() ) setSource( _pendingLoad->getSource() );
+			else std::cout << "UserStreamPlayer - Failed to load '" << _pendingLoad->getPath() << "'. Ignoring..." << std::endl;
+			_pendingLoad.reset();
+		}
+
+		// Slider was dragged
+		if( _currentFrame != _displayedFrame && _totalframes > 0 ) {
+			seek( getFrameTime( ci::math<int>::clamp( _currentFrame, 0, _totalframes - 1 ) ) );
+		}
+
+		if( _state == PLAYING ) _playhead += elapsed * _rate;
 
 		// Loop
-		if( _shouldLoop && _currentFrame > _totalframes ) {
-			_currentFrame = 0;
+		if( _shouldLoop && _duration > 0 && ( _playhead > _duration || _playhead < 0 ) ) {
+			_playhead = std::fmod( _playhead, _duration );
+			if( _playhead < 0 ) _playhead += _duration;
 		}
+		_playhead = ci::math<double>::clamp( _playhead, 0, _duration );
+
+		if( _totalframes > 0 ) _currentFrame = findFrame( _playhead );
+		_displayedFrame = _currentFrame;
 
 		if(_frameSlider) {
 			std::stringstream ss;
 			ss << "Frame: " << _currentFrame << " of " << _totalframes;
+			ss.setf( std::ios::fixed );
+			ss.precision( 1 );
+			ss << " (" << _playhead << "s of " << _duration << "s)";
 			_frameSlider->name = ss.str();
 		}
 	}
@@ -140,17 +188,29 @@ namespace relay {
 		_state = PAUSED;
 	}
 	void UserStreamPlayer::restart() {
-		_currentFrame = 0;
+		seek( _rate < 0 ? _duration : 0 );
 		_state = PLAYING;
 	}
 
+	void UserStreamPlayer::seek( double seconds ) {
+		_playhead = ci::math<double>::clamp( seconds, 0, _duration );
+		_currentFrame = _displayedFrame = _totalframes > 0 ? findFrame( _playhead ) : 0;
+	}
+
+	bool UserStreamPlayer::isDone() {
+		if( _totalframes == 0 ) return true;
+		if( _shouldLoop ) return false;
+		return _rate < 0 ? _playhead <= 0 : _playhead >= _duration;
+	}
+
 
 	bool UserStreamPlayer::fileDrop( ci::app::FileDropEvent event ) {
 		if(event.getNumFiles() != 1) return false;
 
+		// Loaded off the main thread, json is only indexed so even long recordings are ready within a few frames
 		std::string fileRef = event.getFile(0);
 		std::cout << fileRef << std::endl;
-		setJson( fileRef );
+		_pendingLoad = UserStreamLoader::getInstance()->load( fileRef );
 		return true;
 	}
 
@@ -170,76 +230,110 @@ namespace relay {
 	}
 
 	bool UserStreamPlayer::onRecordingSelected( ci::app::MouseEvent event ) {
-		std::string path = ci::app::App::get()->getResourcePath( _gui->getSelectedControl()->name );
-		std::cout << _gui->getSelectedControl()->name << " : " << path << std::endl;
-		setJson( path );
+		std::cout << "UserStreamPlayer - Selected " << _gui->getSelectedControl()->name << std::endl;
+		setGesture( _gui->getSelectedControl()->name );
 
-		_frameSlider->max = getTotalFrames();
 		_label->name = "PLAYING";
 		_toggle->name = "PAUSE";
 		return true;
 	}
 
 	SKELETON::SKELETON UserStreamPlayer::getSkeleton() {
-		uint frameToPlay = (uint)ci::math<float>::min( _currentFrame, _totalframes-1 );
-
-		// To avoid throwing an exception - just return an empty skeleton struct if the current frame is greater than our size
-		// This can happen do to a race condition if update is called just before the file is loaded
-		if( frameToPlay < _recording.size() ) {
-
-			return _recording.at( frameToPlay )->skeleton;
-		} else {
+		// Nothing to play yet - just return an empty skeleton struct
+		if( _totalframes == 0 ) {
 			SKELETON::SKELETON skeleton;
+			skeleton.isTracking = false;
 			return skeleton;
 		}
 
-//		std::cout << "FrameNumber: " << frameToPlay << " Total:" << _recording.size()  << std::endl;
+		loadFrames( findFrame( _playhead ) );
+
+		double from = _frames[0].timestamp - _startTimestamp;
+		double to = _frames[1].timestamp - _startTimestamp;
+		float amount = to > from ? (float)( ( _playhead - from ) / ( to - from ) ) : 0;
+
+		SKELETON::SKELETON skeleton;
+		SKELETON::blend( _frames[0].skeleton, _frames[1].skeleton, ci::math<float>::clamp( amount, 0, 1 ), skeleton );
+		SKELETON::sanitize( skeleton, SKELETON::SANITIZE_PLAYBACK );
+		return skeleton;
 	}
 
+	uint32_t UserStreamPlayer::findFrame( double seconds ) {
+		// Start from the last frame played, or from an estimate after a seek so we only step a few frames
+		uint32_t index = _frameIndex < 0 ? 0 : _frameIndex;
+		if( std::abs( getFrameTime( index ) - seconds ) > 1.0 && _duration > 0 ) {
+			index = (uint32_t)( seconds / _duration * ( _totalframes - 1 ) );
+		}
 
-	// SAVE LOAD JSON
-	void UserStreamPlayer::setJson( const std::string &aPath ) {
-		Json::Value *aJsonValue = new Json::Value();
-		Json::Reader reader;
+		while( index + 1 < (uint32_t)_totalframes && getFrameTime( index + 1 ) <= seconds ) ++index;
+		while( index > 0 && getFrameTime( index ) > seconds ) --index;
+		return index;
+	}
 
-		// Read the filestream
-		std::ifstream filestream;
+	double UserStreamPlayer::getFrameTime( uint32_t index ) {
+		if( _frameIndex >= 0 && index == (uint32_t)_frameIndex ) return _frames[0].timestamp - _startTimestamp;
+		if( _frameIndex >= 0 && index == (uint32_t)_frameIndex + 1 ) return _frames[1].timestamp - _startTimestamp;
 
-		// Load the file
-		std::cout << "UserStreamPlayer::setJson - Attempting to load:" << aPath << std::endl;
+		UserStreamFrame frame;
+		_source->getFrame( index, frame );
+		return frame.timestamp - _startTimestamp;
+	}
+
+	void UserStreamPlayer::loadFrames( uint32_t index ) {
+		if( _frameIndex >= 0 && index == (uint32_t)_frameIndex ) return;
 
-		filestream.open( aPath.c_str(), std::ifstream::in);
-		if( filestream == 0 ) {
-			std::cout << "UserStreamPlayer::setJson - Failed to load file. Ignoring..." << std::endl;
+		if( _frameIndex >= 0 && index == (uint32_t)_frameIndex + 1 ) {
+			_frames[0] = _frames[1];
+		} else {
+			_source->getFrame( index, _frames[0] );
 		}
 
-		// Parse the json file or retrieve errors
-		bool parsingSuccessful = reader.parse( filestream, *aJsonValue );
-		if ( !parsingSuccessful ) {
-			// report to the user the failure and their locations in the document.
-			std::cout  << "Failed to parse configuration\n" << reader.getFormatedErrorMessages() << std::endl;
+		// The last frame blends with itself
+		if( !_source->getFrame( index + 1, _frames[1] ) ) _frames[1] = _frames[0];
+		_frameIndex = index;
+	}
+
+
+	// SAVE LOAD
+	void UserStreamPlayer::setGesture( const std::string &aName ) {
+		// Blocks on a cache miss - UserRelay loads ahead of time through the UserStreamLoader instead
+		UserStreamLoad_ptr aLoad = UserStreamLoader::getInstance()->loadGesture( aName );
+		aLoad->wait();
+
+		if( !aLoad->getSource() ) {
+			std::cout << "UserStreamPlayer::setGesture - Failed to load '" << aName << "'. Ignoring..." << std::endl;
+			return;
+		}
+		setSource( aLoad->getSource() );
+	}
+
+	void UserStreamPlayer::setRecording( const std::string &aPath ) {
+		std::cout << "UserStreamPlayer::setRecording - Attempting to load:" << aPath << std::endl;
+
+		IUserStreamSource_ptr aSource = UserStreamCache::getInstance()->open( aPath );
+		if( !aSource ) {
+			std::cout << "UserStreamPlayer::setRecording - Failed to load file. Ignoring..." << std::endl;
 			return;
 		}
 
-		parseJson ( aJsonValue );
+		setSource( aSource );
 	}
 
 	void UserStreamPlayer::setJson( Json::Value *aJsonValue ) {
-		_json = aJsonValue;
-		parseJson( aJsonValue );
+		setSource( UserStreamMemorySource::fromJSON( *aJsonValue ) );
 	}
 
-	void UserStreamPlayer::parseJson( Json::Value *aJsonValue ) {
-		_recording.clear();
-		// Create a userframe for each json object
-		Json::Value root = (*aJsonValue)["root"];
+	void UserStreamPlayer::setSource( IUserStreamSource_ptr aSource ) {
+		_source = aSource;
+		_totalframes = _source->getFrameCount();
+		_duration = _source->getDuration();
+		_frameIndex = -1;
+		if( _frameSlider ) _frameSlider->max = _totalframes;
 
-        for( Json::ValueIterator itr = root.begin() ; itr != root.end() ; itr++ ) {
-        	_recording.push_back( UserStreamFrame::fromJSON( (*itr) ) );
-			_totalframes = _recording.size();
-        }
+		UserStreamFrame first;
+		_startTimestamp = _source->getFrame( 0, first ) ? first.timestamp : 0;
 
-        restart();
-        std::cout << "Playback stream created with '" << _totalframes << "' frames" << std::endl;
+		restart();
+		std::cout << "Playback stream created with '" << _totalframes << "' frames" << std::endl;
 	}
 }
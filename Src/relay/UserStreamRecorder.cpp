@@ -6,11 +6,16 @@
  *      Abstract:
  *      	 This represents one of the states in the UserStreamStateManager
  *      	 It is able to record a user stream from the Kinect and outputing it as a JSON string
+ *      	 By default frames are streamed to disk by a UserStreamWriter as they are recorded,
+ *      	 the repeater keeps them in memory instead so it can play them straight back
  *      	 It relies on a UserStreamLive instance for kinect data
  */
 
 #include "UserStreamRecorder.h"
+#include "UserStreamBinary.h"
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "cinder/app/App.h"
 #include "cinder/Utilities.h"
@@ -27,7 +32,10 @@
 
 namespace relay {
 
-	UserStreamRecorder::UserStreamRecorder() {
+	boost::shared_ptr<UserStreamWriter> UserStreamRecorder::_previousWriter;
+
+	UserStreamRecorder::UserStreamRecorder( bool aShouldStreamToDisk ) {
+		_shouldStreamToDisk = aShouldStreamToDisk;
 		_livestream = NULL;
 		_gui = NULL;
 		_label = NULL;
@@ -63,6 +71,7 @@ namespace relay {
 		}
 
 		_framenumber = 0;
+		_startTime = 0;
 		_state = NOT_RECORDERING;
 		_recording.clear();
 	}
@@ -93,6 +102,13 @@ namespace relay {
 		delete _livestream; _livestream = NULL;
 		delete _gui; _gui = NULL;
 		delete _label; _label = NULL;
+
+		stopRecording();
+
+		// The writer finishes the file in the background - it is only joined when the next recorder exits, long after
+		// it is done, so leaving the state never waits for the disk. That releases the writer before it, if any
+		_previousWriter = _writer;
+		_writer.reset();
 	}
 
 
@@ -101,16 +117,31 @@ namespace relay {
 		if( _state == RECORDING ) return;
 		setState( RECORDING );
 		_recording.clear();
+		_startTime = ci::app::App::get()->getElapsedSeconds();
+
+		if( _shouldStreamToDisk ) {
+			bool isBinary = Constants::relay::recorder::SAVE_AS_BINARY;
+			std::string path = getRecordingPath() + ( isBinary ? USER_STREAM_BINARY_EXTENSION : ".json" );
+
+			// Create the directory here, cinder leaks when it does it from another thread
+			ci::createDirectories( ci::getPathDirectory( path ) );
+			_writer.reset( new UserStreamWriter( path, isBinary ? UserStreamWriter::FORMAT_BINARY : UserStreamWriter::FORMAT_JSON, Constants::relay::recorder::WRITER_QUEUE_SIZE ) );
+		}
 	}
 
 	void UserStreamRecorder::stopRecording() {
 		if( _state == NOT_RECORDERING ) return;
 		setState( NOT_RECORDERING );
+
+		if( _writer ) _writer->stop();
 	}
 
 	void UserStreamRecorder::recordState() {
 		SKELETON::SKELETON aSkeleton = _livestream->getSkeleton();
-		_recording.push_back( UserStreamFrame_ptr( new UserStreamFrame( _framenumber, aSkeleton ) ) );
+		UserStreamFrame aFrame( _framenumber, aSkeleton, ci::app::App::get()->getElapsedSeconds() - _startTime );
+
+		if( _writer ) _writer->push( aFrame );
+		else _recording.push_back( aFrame );
 		_framenumber++;
 	}
 
@@ -139,32 +170,81 @@ namespace relay {
 		return true;
 	}
 
+	UserStreamFrames_ptr UserStreamRecorder::takeRecording() {
+		std::vector< UserStreamFrame > *frames = new std::vector< UserStreamFrame >();
+		frames->swap( _recording );
+		return UserStreamFrames_ptr( frames );
+	}
+
 	Json::Value UserStreamRecorder::getRecordAsJSONValue() {
 		stopRecording();
 
+		// Built in place, frames are swapped in rather than copied
 		Json::Value json;
-		Json::Value root;
-		for (std::vector< UserStreamFrame_ptr >::iterator i = _recording.begin(); i != _recording.end(); ++i) {
-			UserStreamFrame_ptr aFrame = *i;
-			root.append( aFrame->toJSON() );
+		Json::Value &root = json["root"];
+		root.resize( _recording.size() );
+		for( size_t i = 0; i < _recording.size(); ++i ) {
+			Json::Value frame = _recording[i].toJSON();
+			root[i].swap( frame );
 		}
-
-		json["root"] = root;
 		return json;
 	}
 
 	bool UserStreamRecorder::onSaveClicked( ci::app::MouseEvent event ) {
-		Json::Value json = getRecordAsJSONValue();
-
-		// Write to console for debug
-//		std::cout << json.toStyledString() << std::endl;
+		// Already on disk, stopping finishes the file
+		if( _shouldStreamToDisk ) {
+			stopRecording();
+			return true;
+		}
 
-		// Save nice version to disk
-		saveToDisk( json.toStyledString() );
+		stopRecording();
+		if( Constants::relay::recorder::SAVE_AS_BINARY ) {
+			saveBinaryToDisk();
+		} else {
+			saveToDisk();
+		}
 		return true;
 	}
 
-	void UserStreamRecorder::saveToDisk( std::string jsonString ) {
+	bool UserStreamRecorder::saveToDisk() {
+		std::string path = getRecordingPath() + ".json";
+		ci::createDirectories( ci::getPathDirectory( path ) );
+
+		int fd = ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+		if( fd < 0 ) return false;
+
+		// Each frame is encoded straight into the writer's buffer, the document never exists in memory
+		bool isWritten;
+		{
+			Json::StreamingWriter writer( fd, Json::StreamingWriter::pretty );
+			writer.beginObject();
+			writer.key( "root" );
+			writer.beginArray();
+			for (std::vector< UserStreamFrame >::iterator i = _recording.begin(); i != _recording.end(); ++i) {
+				i->writeJSON( writer );
+			}
+			writer.endArray();
+			writer.endObject();
+			isWritten = writer.flush();
+		}
+		return ::close( fd ) == 0 && isWritten;
+	}
+
+	bool UserStreamRecorder::saveBinaryToDisk() {
+		// Make sure the directory exists
+		std::string path = getRecordingPath() + USER_STREAM_BINARY_EXTENSION;
+		ci::createDirectories( ci::getPathDirectory( path ) );
+
+		UserStreamBinaryWriter writer;
+		if( !writer.open( path, Constants::relay::RECORDING_FRAME_RATE, Constants::relay::recorder::COMPRESS_RECORDINGS ? USER_STREAM_CODEC_DELTA : USER_STREAM_CODEC_RAW ) ) return false;
+
+		for (std::vector< UserStreamFrame >::iterator i = _recording.begin(); i != _recording.end(); ++i) {
+			writer.write( *i );
+		}
+		return writer.close();
+	}
+
+	std::string UserStreamRecorder::getRecordingPath() {
 		// Create a timestamp
 		using namespace boost::posix_time;
 	    using namespace boost::gregorian;
@@ -178,8 +258,6 @@ namespace relay {
 		std::string timeStamp = ss.str();
 
 		// Write the file to the documents directory
-		std::string fileName = ci::getHomeDirectory() + Constants::TimeLapse::DIRECTORY_NAME + "/_recordings/Recording_" + timeStamp;
-		ci::OStreamFileRef oStream = ci::writeFileStream( fileName + ".json", true );
-		oStream->writeData( jsonString.data(), jsonString.length() );
+		return ci::getHomeDirectory() + Constants::TimeLapse::DIRECTORY_NAME + "/_recordings/Recording_" + timeStamp;
 	}
 }
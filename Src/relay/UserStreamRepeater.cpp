@@ -14,9 +14,10 @@
 
 #include "UserStreamRecorder.h"
 #include "UserStreamPlayer.h"
+#include "UserStreamMemorySource.h"
 
 #include "Constants.h"
-#include "cinder/Rand.h"
+#include "cinder/app/App.h"
 
 #include <boost/lambda/lambda.hpp>
 
@@ -51,7 +52,7 @@ namespace relay {
 	void UserStreamRepeater::enter() {
 		ni = WuCinderNITE::getInstance();
 		tracker = UserTracker::getInstance();
-		recorder = new UserStreamRecorder();
+		recorder = new UserStreamRecorder( false );	// Only shows the live stream, the segmenter picks out the gesture
 		recorder->enter();
 		current = recorder;
 
@@ -62,20 +63,15 @@ namespace relay {
 //		_signalConnectionLostUser = ni->signalLostUser.connect( boost::bind(&UserStreamRepeater::onLostUser, this, boost::lambda::_1 ) );
 //		_signalConnectionNewUser = ni->signalNewUser.connect( boost::bind(&UserStreamRepeater::onNewUser, this, boost::lambda::_1 ) );
 
-		_cumalitiveDelta = 0;
+		_frameCounter = 0;
+		_segmenter.reset();
 		_state = WAITING_TO_RECORD;
 	}
 
 	void UserStreamRepeater::update() {
 
-		// Ready to record?
-		if( getState() == WAITING_TO_RECORD && canStartRecording() ) {
-			startRecording();
-		}
-
-		// Check if we've recorded enough
-		if( getState() == RECORDING && recorder->getFrameNumber() == _numberOfFramesToRecord) {
-			stopRecording();
+		if( getState() == WAITING_TO_RECORD || getState() == RECORDING ) {
+			segmentLiveStream();
 		}
 
 		if(current)
@@ -111,38 +107,37 @@ namespace relay {
 		_state = aState;
 	}
 
-	void UserStreamRepeater::startRecording() {
-		std::cout << "UserStreamRepeater: Starting recording!" << std::endl;
-
-		recorder->startRecording();
-		current = recorder;
-		_numberOfFramesToRecord = ci::Rand::randInt( Constants::relay::repeater::MIN_FRAMES_TO_RECORD, Constants::relay::repeater::MAX_FRAMES_TO_RECORD );
-
-		setState( RECORDING );
+	void UserStreamRepeater::segmentLiveStream() {
+		SKELETON::SKELETON aSkeleton = recorder->getSkeleton();
+
+		// Lost the user mid gesture - keep what we have so far
+		bool isComplete = aSkeleton.isTracking
+			? _segmenter.push( UserStreamFrame( _frameCounter++, aSkeleton, ci::app::App::get()->getElapsedSeconds() ) )
+			: _segmenter.flush();
+
+		if( isComplete ) {
+			playSegment( _segmenter.takeSegment() );
+		} else if( _segmenter.isInGesture() && getState() == WAITING_TO_RECORD ) {
+			std::cout << "UserStreamRepeater: Gesture started!" << std::endl;
+			setState( RECORDING );
+		} else if( !_segmenter.isInGesture() && getState() == RECORDING ) {
+			setState( WAITING_TO_RECORD );	// Too short to keep
+		}
 	}
 
-	void UserStreamRepeater::stopRecording() {
-		std::cout << "UserStreamRepeater: Stopping recording!" << std::endl;
-
-		// Stop recording, get json, and destroy recorder
-		recorder->stopRecording();
-		_recording = recorder->getRecordAsJSONValue();
+	void UserStreamRepeater::playSegment( UserStreamFrames_ptr aSegment ) {
+		std::cout << "UserStreamRepeater: Gesture finished, playing it back!" << std::endl;
 		recorder->exit();
 
-		// Start playback
+		// Start playback straight from the segmented frames
 		player = new UserStreamPlayer();
-		player->setJson( &_recording );
+		player->setSource( IUserStreamSource_ptr( new UserStreamMemorySource( aSegment ) ) );
 		player->enter();
 		current = player;
 
 		setState( FIRST_PLAYBACK );
 	}
 
-	bool UserStreamRepeater::canStartRecording() {
-		_cumalitiveDelta += tracker->getTotalDist();
-		return getSkeleton().isTracking && _cumalitiveDelta > Constants::relay::repeater::MIN_CUMALTIVE_DELTA_BEFORE_RECORDING;
-	}
-
 	bool UserStreamRepeater::wantsToExit()  {
 		if( player ) return player->wantsToExit();
 		else return false;;
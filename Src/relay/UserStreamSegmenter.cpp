@@ -0,0 +1,148 @@
+/*
+ * UserStreamSegmenter.cpp
+ *
+ *  Created on: Oct 27, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Cuts gestures out of a live stream of frames, see UserStreamSegmenter.h
+ */
+
+#include "UserStreamSegmenter.h"
+#include "SkeletonJointSet.h"
+#include "Constants.h"
+#include <XnTypes.h>
+#include <algorithm>
+#include <iostream>
+
+using namespace Constants::relay::segmenter;
+
+namespace relay {
+	namespace {
+		// Collects the two highest joint speeds relative to the torso
+		struct LimbSpeed {
+			const SKELETON::SKELETON &previous;
+			const SKELETON::SKELETON &current;
+			float inverseTime;
+			float fastest[2];
+
+			LimbSpeed( const SKELETON::SKELETON &aPrevious, const SKELETON::SKELETON &aCurrent, float elapsed )
+				: previous( aPrevious ), current( aCurrent ), inverseTime( 1.0f / elapsed ) {
+				fastest[0] = fastest[1] = 0;
+			}
+
+			void operator()( int joint ) {
+				if( joint == XN_SKEL_TORSO ) return;
+				if( previous.joints[joint].confidence <= 0 || current.joints[joint].confidence <= 0 ) return;
+
+				ci::Vec3f before = previous.joints[joint].position - previous.joints[XN_SKEL_TORSO].position;
+				ci::Vec3f after = current.joints[joint].position - current.joints[XN_SKEL_TORSO].position;
+				float speed = after.distance( before ) * inverseTime;
+
+				if( speed > fastest[0] ) {
+					fastest[1] = fastest[0];
+					fastest[0] = speed;
+				} else if( speed > fastest[1] ) {
+					fastest[1] = speed;
+				}
+			}
+		};
+	}
+
+	UserStreamSegmenter::UserStreamSegmenter() {
+		reset();
+	}
+
+	void UserStreamSegmenter::reset() {
+		_energy = 0;
+		_isInGesture = false;
+		_framesAbove = 0;
+		_framesBelow = 0;
+		_history.clear();
+		_gesture.clear();
+	}
+
+	float UserStreamSegmenter::measureEnergy( const UserStreamFrame &previous, const UserStreamFrame &frame ) {
+		if( !previous.skeleton.isTracking || !frame.skeleton.isTracking ) return 0;
+		if( previous.skeleton.joints[XN_SKEL_TORSO].confidence <= 0 || frame.skeleton.joints[XN_SKEL_TORSO].confidence <= 0 ) return 0;
+
+		double elapsed = frame.timestamp - previous.timestamp;
+		if( elapsed <= 0 ) elapsed = 1.0 / Constants::relay::RECORDING_FRAME_RATE;
+
+		// Two fastest rather than the mean, a gesture is usually one or two limbs while the rest stand still
+		LimbSpeed limbs( previous.skeleton, frame.skeleton, (float)elapsed );
+		SKELETON::NiteJoints::visit( limbs );
+		return ( limbs.fastest[0] + limbs.fastest[1] ) * 0.5f;
+	}
+
+	bool UserStreamSegmenter::push( const UserStreamFrame &frame ) {
+		const UserStreamFrame *previous = _isInGesture ? &_gesture.back() : ( _history.empty() ? NULL : &_history.back() );
+		float energy = previous ? measureEnergy( *previous, frame ) : 0;
+		_energy += ( energy - _energy ) * ENERGY_SMOOTHING;
+
+		if( !_isInGesture ) {
+			_history.push_back( frame );
+			if( (int)_history.size() > LEAD_FRAMES + START_FRAMES ) _history.pop_front();
+
+			_framesAbove = _energy > START_ENERGY ? _framesAbove + 1 : 0;
+			if( _framesAbove < START_FRAMES ) return false;
+
+			// Started - the frames that crossed the threshold are part of it, plus a short lead in
+			_isInGesture = true;
+			_framesBelow = 0;
+			_gesture.assign( _history.begin(), _history.end() );
+			_history.clear();
+			return false;
+		}
+
+		_gesture.push_back( frame );
+		_framesBelow = _energy < STOP_ENERGY ? _framesBelow + 1 : 0;
+
+		double length = _gesture.back().timestamp - _gesture.front().timestamp;
+		if( _framesBelow >= STOP_FRAMES || length >= MAX_SEGMENT_SECONDS ) {
+			return endGesture();
+		}
+		return false;
+	}
+
+	bool UserStreamSegmenter::flush() {
+		if( !_isInGesture ) return false;
+		return endGesture();
+	}
+
+	bool UserStreamSegmenter::endGesture() {
+		// Trim the quiet tail down to a short lead out
+		size_t trim = _framesBelow > LEAD_FRAMES ? _framesBelow - LEAD_FRAMES : 0;
+		_gesture.resize( _gesture.size() - std::min( trim, _gesture.size() ) );
+
+		_isInGesture = false;
+		_framesAbove = 0;
+		_framesBelow = 0;
+
+		std::vector<UserStreamFrame> gesture;
+		gesture.swap( _gesture );
+		if( gesture.size() < 2 || gesture.back().timestamp - gesture.front().timestamp < MIN_SEGMENT_SECONDS ) {
+			return false;
+		}
+
+		// Rebase so the segment plays from zero
+		double startTime = gesture.front().timestamp;
+		uint32_t startFrame = gesture.front().framenumber;
+		for( std::vector<UserStreamFrame>::iterator it = gesture.begin(); it != gesture.end(); ++it ) {
+			it->timestamp -= startTime;
+			it->framenumber -= startFrame;
+		}
+
+		std::vector<UserStreamFrame> *segment = new std::vector<UserStreamFrame>();
+		segment->swap( gesture );
+		_segment = UserStreamFrames_ptr( segment );
+
+		std::cout << "UserStreamSegmenter - Gesture of " << _segment->size() << " frames, " << _segment->back().timestamp << " seconds" << std::endl;
+		return true;
+	}
+
+	UserStreamFrames_ptr UserStreamSegmenter::takeSegment() {
+		UserStreamFrames_ptr aSegment = _segment;
+		_segment.reset();
+		return aSegment;
+	}
+}
@@ -6,6 +6,7 @@
  */
 
 #include "UserStreamStateManager.h"
+#include "UserSessionRecorder.h"
 
 
 #include "WuCinderNITE.h"
@@ -32,6 +33,7 @@ namespace relay {
 
 	void UserStreamStateManager::setInitialState( IUserStream* aState ) {
 		currentState = aState;
+		UserSessionRecorder::getInstance()->recordEvent( USER_SESSION_EVENT_STATE_CHANGE, 0, currentState->getName() );
 		currentState->enter();
 	}
 
@@ -44,6 +46,7 @@ namespace relay {
 		previousState = currentState;
 
 		currentState = aState;
+		UserSessionRecorder::getInstance()->recordEvent( USER_SESSION_EVENT_STATE_CHANGE, 0, currentState->getName() );
 		currentState->enter();
 	}
 
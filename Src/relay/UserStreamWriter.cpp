@@ -0,0 +1,137 @@
+/*
+ * UserStreamWriter.cpp
+ *
+ *  Created on: Oct 21, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Writes a recording to disk while it is being made, see UserStreamWriter.h
+ */
+
+#include "UserStreamWriter.h"
+#include "Constants.h"
+#include "json/writer.h"
+#include <boost/bind.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+
+namespace relay {
+	UserStreamWriter::UserStreamWriter( const std::string &aPath, Format aFormat, size_t aQueueSize )
+		: _path( aPath ), _format( aFormat ), _queue( aQueueSize ) {
+		_head = 0;
+		_count = 0;
+		_shouldStop = false;
+		_isFinished = false;
+		_framesWritten = 0;
+		_framesDropped = 0;
+		_jsonFd = -1;
+
+		_thread = boost::thread( boost::bind( &UserStreamWriter::run, this ) );
+	}
+
+	UserStreamWriter::~UserStreamWriter() {
+		stop();
+		_thread.join();
+	}
+
+	bool UserStreamWriter::push( const UserStreamFrame &frame ) {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			if( _shouldStop ) return false;
+			if( _count == _queue.size() ) {
+				_framesDropped++;
+				return false;
+			}
+
+			_queue[ ( _head + _count ) % _queue.size() ] = frame;
+			_count++;
+		}
+		_condition.notify_one();
+		return true;
+	}
+
+	void UserStreamWriter::stop() {
+		{
+			boost::mutex::scoped_lock lock( _mutex );
+			_shouldStop = true;
+		}
+		_condition.notify_one();
+	}
+
+	void UserStreamWriter::run() {
+		bool isOpen = openFile();
+
+		std::vector<UserStreamFrame> batch;
+		batch.reserve( _queue.size() );
+
+		while( true ) {
+			{
+				boost::mutex::scoped_lock lock( _mutex );
+				while( _count == 0 && !_shouldStop ) {
+					_condition.wait( lock );
+				}
+				if( _count == 0 && _shouldStop ) break;
+
+				// Take everything queued so far, encoding happens outside the lock
+				batch.clear();
+				while( _count > 0 ) {
+					batch.push_back( _queue[_head] );
+					_head = ( _head + 1 ) % _queue.size();
+					_count--;
+				}
+			}
+
+			if( !isOpen ) continue;
+			for( std::vector<UserStreamFrame>::iterator i = batch.begin(); i != batch.end(); ++i ) {
+				writeFrame( *i );
+			}
+		}
+
+		if( isOpen ) closeFile();
+		_isFinished = true;
+	}
+
+	bool UserStreamWriter::openFile() {
+		if( _format == FORMAT_BINARY ) {
+			return _binaryWriter.open( _path, Constants::relay::RECORDING_FRAME_RATE, Constants::relay::recorder::COMPRESS_RECORDINGS ? USER_STREAM_CODEC_DELTA : USER_STREAM_CODEC_RAW );
+		}
+
+		_jsonFd = ::open( _path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+		if( _jsonFd < 0 ) {
+			std::cout << "UserStreamWriter - Failed to open '" << _path << "'" << std::endl;
+			return false;
+		}
+		_jsonWriter.reset( new Json::StreamingWriter( _jsonFd ) );
+		_jsonWriter->beginObject();
+		_jsonWriter->key( "root" );
+		_jsonWriter->beginArray();
+		return true;
+	}
+
+	void UserStreamWriter::writeFrame( UserStreamFrame &frame ) {
+		if( _format == FORMAT_BINARY ) {
+			_binaryWriter.write( frame );
+		} else {
+			// Encoded straight into the writer's buffer, no Json::Value or string per frame
+			frame.writeJSON( *_jsonWriter );
+		}
+		_framesWritten++;
+	}
+
+	void UserStreamWriter::closeFile() {
+		if( _format == FORMAT_BINARY ) {
+			_binaryWriter.close();
+		} else {
+			_jsonWriter->endArray();
+			_jsonWriter->endObject();
+			if( !_jsonWriter->flush() ) std::cout << "UserStreamWriter - Failed to write '" << _path << "'" << std::endl;
+			_jsonWriter.reset();
+			::close( _jsonFd );
+			_jsonFd = -1;
+		}
+
+		std::cout << "UserStreamWriter - Saved " << _framesWritten << " frames to '" << _path << "'";
+		if( _framesDropped ) std::cout << ", dropped " << _framesDropped;
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,443 @@
+/*
+ * JsonBenchmark.cpp
+ *
+ *  Created on: Oct 24, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Benchmark suite for the JSON side of the relay layer, run over every json recording in a directory (Resources/ by default).
+ *      	For each file it measures, best time of N runs, plus the heap traffic of one run:
+ *      		parse          Json::Reader into a Json::Value
+ *      		parse_arena    the same inside a Json::ValueArena scope
+ *      		walk           UserStreamFrame::fromJSON over the parsed document
+ *      		fast_writer    Json::FastWriter back to a string
+ *      		styled_writer  Json::StyledWriter back to a string
+ *      		stream_writer  Json::StreamingWriter to /dev/null
+ *      		stream_parser  UserStreamJSONParser straight into frames, for reference
+ *      	Heap traffic is the number of allocations, the bytes they asked for, the peak live bytes above the start of the
+ *      	run and the bytes still live at its end (the size of the document for the parse phases).
+ *      	On glibc every malloc is counted, which includes the ones jsoncpp makes directly; elsewhere only operator new is.
+ *
+ *      	Results go to stdout as JSON so runs can be diffed and compared by scripts, a table goes to stderr.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -std=gnu++98 -IInclude -IInclude/OpenNI -ILib -I$CINDER_PATH/include -I$CINDER_PATH/boost \
+ *      		Tools/benchmark/JsonBenchmark.cpp Src/MappedFile.cpp Src/relay/UserStreamFrame.cpp Src/relay/UserStreamJSONParser.cpp \
+ *      		Lib/lib_json/json_*.cpp -o JsonBenchmark
+ *      	./JsonBenchmark [directory] [iterations] > results.json
+ */
+
+#include "UserStreamFrame.h"
+#include "UserStreamJSONParser.h"
+#include "json/reader.h"
+#include "json/writer.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// Allocation counting
+// Single threaded, the benchmark never starts a thread
+namespace {
+	struct HeapCounters {
+		unsigned long allocations;
+		unsigned long long requestedBytes;
+		long long liveBytes;
+		long long peakBytes;
+	};
+	HeapCounters heap = { 0, 0, 0, 0 };
+
+	void countAllocation( size_t requested, size_t reserved ) {
+		heap.allocations++;
+		heap.requestedBytes += requested;
+		heap.liveBytes += reserved;
+		if( heap.liveBytes > heap.peakBytes ) heap.peakBytes = heap.liveBytes;
+	}
+
+	void countRelease( size_t reserved ) {
+		heap.liveBytes -= reserved;
+	}
+}
+
+#if defined(__GLIBC__)
+// Every malloc, operator new included since libstdc++ builds it on malloc
+extern "C" {
+	void *__libc_malloc( size_t size );
+	void *__libc_calloc( size_t count, size_t size );
+	void *__libc_realloc( void *pointer, size_t size );
+	void __libc_free( void *pointer );
+
+	void *malloc( size_t size ) {
+		void *pointer = __libc_malloc( size );
+		if( pointer ) countAllocation( size, malloc_usable_size( pointer ) );
+		return pointer;
+	}
+
+	void *calloc( size_t count, size_t size ) {
+		void *pointer = __libc_calloc( count, size );
+		if( pointer ) countAllocation( count * size, malloc_usable_size( pointer ) );
+		return pointer;
+	}
+
+	void *realloc( void *pointer, size_t size ) {
+		size_t previous = pointer ? malloc_usable_size( pointer ) : 0;
+		void *result = __libc_realloc( pointer, size );
+		if( result || size == 0 ) countRelease( previous );
+		if( result ) countAllocation( size, malloc_usable_size( result ) );
+		return result;
+	}
+
+	void free( void *pointer ) {
+		if( pointer ) countRelease( malloc_usable_size( pointer ) );
+		__libc_free( pointer );
+	}
+}
+#else
+// operator new only, each block remembers its size in front of it
+#if __cplusplus >= 201103L
+#define BENCHMARK_THROWS_BAD_ALLOC
+#define BENCHMARK_THROWS_NOTHING noexcept
+#else
+#define BENCHMARK_THROWS_BAD_ALLOC throw( std::bad_alloc )
+#define BENCHMARK_THROWS_NOTHING throw()
+#endif
+
+namespace {
+	const size_t BLOCK_HEADER = 16;	// keeps the alignment malloc gives
+
+	void *allocateCounted( size_t size ) {
+		char *block = (char*)std::malloc( size + BLOCK_HEADER );
+		if( !block ) throw std::bad_alloc();
+		*(size_t*)block = size;
+		countAllocation( size, size );
+		return block + BLOCK_HEADER;
+	}
+
+	void releaseCounted( void *pointer ) {
+		if( !pointer ) return;
+		char *block = (char*)pointer - BLOCK_HEADER;
+		countRelease( *(size_t*)block );
+		std::free( block );
+	}
+}
+
+void *operator new( size_t size ) BENCHMARK_THROWS_BAD_ALLOC { return allocateCounted( size ); }
+void *operator new[]( size_t size ) BENCHMARK_THROWS_BAD_ALLOC { return allocateCounted( size ); }
+void operator delete( void *pointer ) BENCHMARK_THROWS_NOTHING { releaseCounted( pointer ); }
+void operator delete[]( void *pointer ) BENCHMARK_THROWS_NOTHING { releaseCounted( pointer ); }
+#endif
+
+namespace {
+	double now() {
+		timeval time;
+		gettimeofday( &time, NULL );
+		return time.tv_sec + time.tv_usec * 1e-6;
+	}
+
+	bool readFile( const std::string &aPath, std::string &contents ) {
+		std::ifstream filestream( aPath.c_str(), std::ios::in | std::ios::binary );
+		if( !filestream.is_open() ) return false;
+		contents.assign( std::istreambuf_iterator<char>( filestream ), std::istreambuf_iterator<char>() );
+		return true;
+	}
+
+	long maxResidentKilobytes() {
+		rusage usage;
+		getrusage( RUSAGE_SELF, &usage );
+#if defined(__APPLE__)
+		return usage.ru_maxrss / 1024;	// bytes on OS X
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+
+	// One measured step, setUp() and tearDown() run outside the measurement
+	class Phase {
+	public:
+		virtual ~Phase() {}
+		virtual const char* getName() = 0;
+		virtual void setUp() {}
+		virtual bool run() = 0;
+		virtual void tearDown() {}
+		virtual size_t getOutputBytes() { return 0; }
+	};
+
+	struct Measurement {
+		std::string name;
+		bool ok;
+		double seconds;
+		unsigned long allocations;
+		unsigned long long requestedBytes;
+		long long peakBytes;
+		long long retainedBytes;
+		size_t outputBytes;
+	};
+
+	Measurement measure( Phase &phase, int iterations ) {
+		Measurement result;
+		result.name = phase.getName();
+		result.ok = true;
+		result.seconds = 1e30;
+
+		for( int i = 0; i < iterations; ++i ) {
+			phase.setUp();
+			HeapCounters before = heap;
+			heap.peakBytes = heap.liveBytes;
+
+			double start = now();
+			result.ok = phase.run() && result.ok;
+			result.seconds = std::min( result.seconds, now() - start );
+
+			// The counts of the last run, they are the same every run
+			result.allocations = heap.allocations - before.allocations;
+			result.requestedBytes = heap.requestedBytes - before.requestedBytes;
+			result.peakBytes = heap.peakBytes - before.liveBytes;
+			result.retainedBytes = heap.liveBytes - before.liveBytes;
+			result.outputBytes = phase.getOutputBytes();
+			heap.peakBytes = std::max( heap.peakBytes, before.peakBytes );
+			phase.tearDown();
+		}
+		return result;
+	}
+
+	class ParsePhase : public Phase {
+	public:
+		ParsePhase( const std::string &aContents, bool aUseArena ) : contents( aContents ), useArena( aUseArena ), arena( NULL ) {}
+		~ParsePhase() { tearDown(); }
+
+		const char* getName() { return useArena ? "parse_arena" : "parse"; }
+		bool run() {
+			Json::Reader reader;
+			if( !useArena ) return reader.parse( contents.data(), contents.data() + contents.size(), root, false );
+
+			arena = new Json::ValueArena();
+			Json::ValueArena::Scope scope( *arena );
+			return reader.parse( contents.data(), contents.data() + contents.size(), root, false );
+		}
+		void tearDown() {
+			Json::Value().swap( root );
+			delete arena;
+			arena = NULL;
+		}
+
+	private:
+		const std::string &contents;
+		bool useArena;
+		Json::Value root;
+		Json::ValueArena *arena;
+	};
+
+	class WalkPhase : public Phase {
+	public:
+		WalkPhase( const Json::Value &aDocument ) : document( aDocument ) {}
+
+		const char* getName() { return "walk"; }
+		bool run() {
+			const Json::Value &root = document["root"];
+			frames.reserve( root.size() );
+			for( Json::ValueConstIterator itr = root.begin(); itr != root.end(); itr++ ) {
+				frames.push_back( *relay::UserStreamFrame::fromJSON( *itr ) );
+			}
+			return !frames.empty();
+		}
+		void tearDown() { std::vector<relay::UserStreamFrame>().swap( frames ); }
+
+	private:
+		const Json::Value &document;
+		std::vector<relay::UserStreamFrame> frames;
+	};
+
+	class WriterPhase : public Phase {
+	public:
+		WriterPhase( const Json::Value &aDocument, bool aIsStyled ) : document( aDocument ), isStyled( aIsStyled ) {}
+
+		const char* getName() { return isStyled ? "styled_writer" : "fast_writer"; }
+		bool run() {
+			if( isStyled ) {
+				Json::StyledWriter writer;
+				output = writer.write( document );
+			} else {
+				Json::FastWriter writer;
+				output = writer.write( document );
+			}
+			return !output.empty();
+		}
+		void tearDown() { std::string().swap( output ); }
+		size_t getOutputBytes() { return output.size(); }
+
+	private:
+		const Json::Value &document;
+		bool isStyled;
+		std::string output;
+	};
+
+	class StreamWriterPhase : public Phase {
+	public:
+		StreamWriterPhase( const Json::Value &aDocument ) : document( aDocument ), fd( -1 ) {}
+
+		const char* getName() { return "stream_writer"; }
+		void setUp() { fd = ::open( "/dev/null", O_WRONLY ); }
+		bool run() {
+			Json::StreamingWriter writer( fd );
+			writer.value( document );
+			return writer.flush();
+		}
+		void tearDown() { ::close( fd ); }
+
+	private:
+		const Json::Value &document;
+		int fd;
+	};
+
+	class StreamParserPhase : public Phase {
+	public:
+		StreamParserPhase( const std::string &aContents ) : contents( aContents ) {}
+
+		const char* getName() { return "stream_parser"; }
+		bool run() {
+			relay::UserStreamJSONParser parser;
+			return parser.parse( contents.data(), contents.size(), frames );
+		}
+		void tearDown() { std::vector<relay::UserStreamFrame>().swap( frames ); }
+
+	private:
+		const std::string &contents;
+		std::vector<relay::UserStreamFrame> frames;
+	};
+
+	struct FileResult {
+		std::string name;
+		size_t bytes;
+		size_t frames;
+		std::vector<Measurement> phases;
+	};
+
+	void writeResults( const std::vector<FileResult> &results, int iterations ) {
+		Json::StreamingWriter writer( STDOUT_FILENO, Json::StreamingWriter::pretty );
+		writer.beginObject();
+		writer.key( "iterations" );
+		writer.value( iterations );
+		writer.key( "counts_malloc" );
+#if defined(__GLIBC__)
+		writer.value( true );
+#else
+		writer.value( false );
+#endif
+		writer.key( "files" );
+		writer.beginArray();
+		for( size_t f = 0; f < results.size(); ++f ) {
+			const FileResult &result = results[f];
+			writer.beginObject();
+			writer.key( "file" );
+			writer.value( result.name );
+			writer.key( "bytes" );
+			writer.value( Json::UInt( result.bytes ) );
+			writer.key( "frames" );
+			writer.value( Json::UInt( result.frames ) );
+			writer.key( "phases" );
+			writer.beginObject();
+			for( size_t p = 0; p < result.phases.size(); ++p ) {
+				const Measurement &phase = result.phases[p];
+				writer.key( phase.name );
+				writer.beginObject();
+				writer.key( "ok" );
+				writer.value( phase.ok );
+				writer.key( "ms" );
+				writer.value( phase.seconds * 1000.0 );
+				writer.key( "allocations" );
+				writer.value( Json::UInt( phase.allocations ) );
+				writer.key( "requested_bytes" );
+				writer.value( Json::UInt( phase.requestedBytes ) );
+				writer.key( "peak_bytes" );
+				writer.value( Json::Int( phase.peakBytes ) );
+				writer.key( "retained_bytes" );
+				writer.value( Json::Int( phase.retainedBytes ) );
+				if( phase.outputBytes ) {
+					writer.key( "output_bytes" );
+					writer.value( Json::UInt( phase.outputBytes ) );
+				}
+				writer.endObject();
+			}
+			writer.endObject();
+			writer.endObject();
+		}
+		writer.endArray();
+		writer.key( "max_rss_kb" );
+		writer.value( Json::Int( maxResidentKilobytes() ) );
+		writer.endObject();
+	}
+}
+
+int main( int argc, char **argv ) {
+	std::string directory = argc > 1 ? argv[1] : "Resources";
+	int iterations = argc > 2 ? std::atoi( argv[2] ) : 5;
+
+	std::vector<std::string> files;
+	DIR *dir = opendir( directory.c_str() );
+	if( !dir ) {
+		std::fprintf( stderr, "Can not open '%s'\n", directory.c_str() );
+		return 1;
+	}
+	while( dirent *entry = readdir( dir ) ) {
+		std::string name( entry->d_name );
+		if( name.size() > 5 && name.compare( name.size() - 5, 5, ".json" ) == 0 ) files.push_back( directory + "/" + name );
+	}
+	closedir( dir );
+	std::sort( files.begin(), files.end() );
+
+	std::fprintf( stderr, "%-24s %-14s %10s %12s %14s %14s %14s\n", "file", "phase", "ms", "allocations", "requested", "peak", "retained" );
+
+	int failures = 0;
+	std::vector<FileResult> results;
+	for( size_t f = 0; f < files.size(); ++f ) {
+		std::string contents;
+		if( !readFile( files[f], contents ) ) continue;
+
+		// The walk and the writers run over one document parsed up front
+		Json::Value document;
+		Json::Reader reader;
+		if( !reader.parse( contents, document, false ) ) {
+			std::fprintf( stderr, "%s: %s\n", files[f].c_str(), reader.getFormatedErrorMessages().c_str() );
+			++failures;
+			continue;
+		}
+
+		FileResult result;
+		result.name = files[f].substr( files[f].rfind( '/' ) + 1 );
+		result.bytes = contents.size();
+		result.frames = document["root"].size();
+
+		ParsePhase parse( contents, false );
+		ParsePhase parseArena( contents, true );
+		WalkPhase walk( document );
+		WriterPhase fastWriter( document, false );
+		WriterPhase styledWriter( document, true );
+		StreamWriterPhase streamWriter( document );
+		StreamParserPhase streamParser( contents );
+		Phase *phases[] = { &parse, &parseArena, &walk, &fastWriter, &styledWriter, &streamWriter, &streamParser };
+
+		for( size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); ++p ) {
+			Measurement measurement = measure( *phases[p], iterations );
+			if( !measurement.ok ) ++failures;
+			result.phases.push_back( measurement );
+			std::fprintf( stderr, "%-24s %-14s %10.3f %12lu %14llu %14lld %14lld\n", result.name.c_str(), measurement.name.c_str(), measurement.seconds * 1000.0,
+					measurement.allocations, measurement.requestedBytes, measurement.peakBytes, measurement.retainedBytes );
+		}
+		results.push_back( result );
+	}
+
+	writeResults( results, iterations );
+	return failures == 0 ? 0 : 2;
+}
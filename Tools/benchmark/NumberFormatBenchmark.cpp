@@ -0,0 +1,248 @@
+/*
+ * NumberFormatBenchmark.cpp
+ *
+ *  Created on: Oct 21, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Checks that Json::valueToChars( double ) reads back to the exact same double on sampled bit patterns, floats
+ *      	widened to double (what the recorder writes) and every number of the json recordings in a directory, then times
+ *      	it against the sprintf( "%#.16g" ) formatting the writer used before, and times FastWriter on the recordings.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -IInclude -ILib Tools/benchmark/NumberFormatBenchmark.cpp Lib/lib_json/json_*.cpp -o NumberFormatBenchmark
+ *      	./NumberFormatBenchmark [directory] [samples]
+ */
+
+#include "json/reader.h"
+#include "json/writer.h"
+
+#include <dirent.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+	double now() {
+		timeval time;
+		gettimeofday( &time, NULL );
+		return time.tv_sec + time.tv_usec * 1e-6;
+	}
+
+	bool readFile( const std::string &aPath, std::string &contents ) {
+		std::ifstream filestream( aPath.c_str(), std::ios::in | std::ios::binary );
+		if( !filestream.is_open() ) return false;
+		contents.assign( std::istreambuf_iterator<char>( filestream ), std::istreambuf_iterator<char>() );
+		return true;
+	}
+
+	// xorshift64*, so samples are the same on every platform
+	unsigned long long nextRandom( unsigned long long &state ) {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 2685821657736338717ULL;
+	}
+
+	double fromBits( unsigned long long bits ) {
+		double value;
+		std::memcpy( &value, &bits, sizeof( value ) );
+		return value;
+	}
+
+	bool isFinite( double value ) {
+		return value == value && value - value == 0;
+	}
+
+	// Json::valueToString( double ) before the Grisu2 formatting
+	std::string legacyValueToString( double value ) {
+		char buffer[32];
+		std::sprintf( buffer, "%#.16g", value );
+		char *ch = buffer + std::strlen( buffer ) - 1;
+		if( *ch != '0' ) return buffer;
+		while( ch > buffer && *ch == '0' ) --ch;
+		char *lastNonzero = ch;
+		while( ch >= buffer ) {
+			if( *ch >= '0' && *ch <= '9' ) { --ch; continue; }
+			if( *ch == '.' ) *( lastNonzero + 2 ) = '\0';
+			return buffer;
+		}
+		return buffer;
+	}
+
+	// Digits of the mantissa without leading and trailing zeros, "0.0012340" and "1.234e-03" both have 4
+	size_t significantDigits( const char *text ) {
+		std::string digits;
+		for( const char *ch = text; *ch && *ch != 'e'; ++ch ) if( *ch >= '0' && *ch <= '9' ) digits += *ch;
+		size_t first = digits.find_first_not_of( '0' );
+		if( first == std::string::npos ) return 0;
+		return digits.find_last_not_of( '0' ) - first + 1;
+	}
+
+	// Fewest significant digits %.*g needs to read back to value
+	size_t shortestDigits( double value ) {
+		char buffer[40];
+		for( int precision = 1; precision < 17; ++precision ) {
+			std::sprintf( buffer, "%.*g", precision, value );
+			if( std::strtod( buffer, NULL ) == value ) return significantDigits( buffer );
+		}
+		std::sprintf( buffer, "%.17g", value );
+		return significantDigits( buffer );
+	}
+
+	struct RoundTripStats {
+		RoundTripStats() : values( 0 ), failures( 0 ), notShortest( 0 ), realValueFailures( 0 ) {}
+		unsigned long values;
+		unsigned long failures;
+		unsigned long notShortest;
+		unsigned long realValueFailures;
+	};
+
+	void checkRoundTrip( double value, RoundTripStats &stats, bool checkShortest ) {
+		char buffer[Json::valueToCharsBufferSize];
+		char *end = Json::valueToChars( value, buffer );
+		++stats.values;
+
+		double parsed = std::strtod( buffer, NULL );
+		if( std::memcmp( &parsed, &value, sizeof( value ) ) != 0 || std::strlen( buffer ) != size_t( end - buffer ) ) {
+			if( ++stats.failures <= 10 ) std::fprintf( stderr, "round trip failed: %.17g -> '%s' -> %.17g\n", value, buffer, parsed );
+			return;
+		}
+		// The reader tells doubles from integers by the '.' or the exponent
+		if( !std::strpbrk( buffer, ".e" ) ) ++stats.realValueFailures;
+		if( checkShortest && significantDigits( buffer ) > shortestDigits( value ) ) ++stats.notShortest;
+	}
+
+	void collectDoubles( const Json::Value &value, std::vector<double> &doubles ) {
+		if( value.isDouble() ) {
+			doubles.push_back( value.asDouble() );
+		} else if( value.isArray() || value.isObject() ) {
+			for( Json::ValueConstIterator itr = value.begin(); itr != value.end(); itr++ ) collectDoubles( *itr, doubles );
+		}
+	}
+
+	void printStats( const char *name, const RoundTripStats &stats ) {
+		std::printf( "%-28s %12lu %10lu %12lu %10lu\n", name, stats.values, stats.failures, stats.notShortest, stats.realValueFailures );
+	}
+}
+
+int main( int argc, char **argv ) {
+	std::string directory = argc > 1 ? argv[1] : "Resources";
+	unsigned long samples = argc > 2 ? std::strtoul( argv[2], NULL, 10 ) : 2000000;
+
+	std::vector<std::string> files;
+	DIR *dir = opendir( directory.c_str() );
+	if( !dir ) {
+		std::fprintf( stderr, "Can not open '%s'\n", directory.c_str() );
+		return 1;
+	}
+	while( dirent *entry = readdir( dir ) ) {
+		std::string name( entry->d_name );
+		if( name.size() > 5 && name.compare( name.size() - 5, 5, ".json" ) == 0 ) files.push_back( directory + "/" + name );
+	}
+	closedir( dir );
+	std::sort( files.begin(), files.end() );
+
+	std::vector<Json::Value> documents( files.size() );
+	std::vector<double> recorded;
+	for( size_t f = 0; f < files.size(); ++f ) {
+		std::string contents;
+		Json::Reader reader;
+		if( !readFile( files[f], contents ) || !reader.parse( contents, documents[f], false ) ) {
+			std::fprintf( stderr, "Can not read '%s'\n", files[f].c_str() );
+			continue;
+		}
+		collectDoubles( documents[f], recorded );
+	}
+
+	// Round trip, shortest digits checked against sprintf on every 16th sample since that is slow
+	std::printf( "%-28s %12s %10s %12s %10s\n", "round_trip", "values", "failures", "not_shortest", "not_real" );
+	unsigned long long state = 0x9E3779B97F4A7C15ULL;
+	RoundTripStats bitStats, floatStats, recordedStats, edgeStats;
+	for( unsigned long i = 0; i < samples; ++i ) {
+		double value = fromBits( nextRandom( state ) );
+		if( isFinite( value ) ) checkRoundTrip( value, bitStats, i % 16 == 0 );
+
+		unsigned int floatBits = (unsigned int)( nextRandom( state ) >> 32 );
+		float single;
+		std::memcpy( &single, &floatBits, sizeof( single ) );
+		if( isFinite( single ) ) checkRoundTrip( single, floatStats, i % 16 == 0 );
+	}
+	for( size_t i = 0; i < recorded.size(); ++i ) checkRoundTrip( recorded[i], recordedStats, i % 16 == 0 );
+
+	// Powers of ten and two, their neighbours, denormals and the format boundaries
+	for( int e = -1074; e <= 1023; ++e ) {
+		double power = std::ldexp( 1.0, e );
+		checkRoundTrip( power, edgeStats, true );
+		checkRoundTrip( -power, edgeStats, true );
+		checkRoundTrip( nextafter( power, 0.0 ), edgeStats, true );
+		checkRoundTrip( nextafter( power, 1e308 ), edgeStats, true );
+	}
+	for( int e = -323; e <= 308; ++e ) {
+		double power = std::strtod( ( "1e" + Json::valueToString( e ) ).c_str(), NULL );
+		checkRoundTrip( power, edgeStats, true );
+		checkRoundTrip( nextafter( power, 0.0 ), edgeStats, true );
+		checkRoundTrip( nextafter( power, 1e308 ), edgeStats, true );
+	}
+	checkRoundTrip( 1.7976931348623157e308, edgeStats, true );
+	checkRoundTrip( 4.9406564584124654e-324, edgeStats, true );
+	checkRoundTrip( 2.2250738585072014e-308, edgeStats, true );
+	checkRoundTrip( -0.0, edgeStats, true );
+
+	printStats( "random_bits", bitStats );
+	printStats( "random_floats", floatStats );
+	printStats( "recordings", recordedStats );
+	printStats( "edge_cases", edgeStats );
+
+	unsigned long failures = bitStats.failures + floatStats.failures + recordedStats.failures + edgeStats.failures
+			+ bitStats.realValueFailures + floatStats.realValueFailures + recordedStats.realValueFailures + edgeStats.realValueFailures;
+
+	// Formatting speed on the recorded numbers, best of 5
+	if( !recorded.empty() ) {
+		double legacyTime = 1e30, stringTime = 1e30, charsTime = 1e30;
+		size_t legacyBytes = 0, charsBytes = 0;
+		for( int iteration = 0; iteration < 5; ++iteration ) {
+			legacyBytes = charsBytes = 0;
+			double start = now();
+			for( size_t i = 0; i < recorded.size(); ++i ) legacyBytes += legacyValueToString( recorded[i] ).size();
+			legacyTime = std::min( legacyTime, now() - start );
+
+			start = now();
+			size_t stringBytes = 0;
+			for( size_t i = 0; i < recorded.size(); ++i ) stringBytes += Json::valueToString( recorded[i] ).size();
+			stringTime = std::min( stringTime, now() - start );
+
+			char buffer[Json::valueToCharsBufferSize];
+			start = now();
+			for( size_t i = 0; i < recorded.size(); ++i ) charsBytes += Json::valueToChars( recorded[i], buffer ) - buffer;
+			charsTime = std::min( charsTime, now() - start );
+		}
+
+		double perValue = 1e9 / recorded.size();
+		std::printf( "\n%-28s %12s %12s %12s\n", "format_double", "ns_per_value", "bytes", "speedup" );
+		std::printf( "%-28s %12.1f %12lu %11.1fx\n", "sprintf(%#.16g)", legacyTime * perValue, (unsigned long)legacyBytes, 1.0 );
+		std::printf( "%-28s %12.1f %12lu %11.1fx\n", "valueToString", stringTime * perValue, (unsigned long)charsBytes, legacyTime / stringTime );
+		std::printf( "%-28s %12.1f %12lu %11.1fx\n", "valueToChars", charsTime * perValue, (unsigned long)charsBytes, legacyTime / charsTime );
+	}
+
+	std::printf( "\n%-40s %10s %12s\n", "fast_writer", "bytes", "write_ms" );
+	for( size_t f = 0; f < files.size(); ++f ) {
+		Json::FastWriter writer;
+		double best = 1e30;
+		size_t bytes = 0;
+		for( int iteration = 0; iteration < 5; ++iteration ) {
+			double start = now();
+			bytes = writer.write( documents[f] ).size();
+			best = std::min( best, now() - start );
+		}
+		std::string name = files[f].substr( files[f].rfind( '/' ) + 1 );
+		std::printf( "%-40s %10lu %12.3f\n", name.c_str(), (unsigned long)bytes, best * 1000.0 );
+	}
+
+	return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,140 @@
+/*
+ * RecordingParseBenchmark.cpp
+ *
+ *  Created on: Oct 20, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Times Json::Reader + UserStreamFrame::fromJSON, with and without a Json::ValueArena, against UserStreamJSONParser
+ *      	on every json recording in a directory (Resources/ by default), and checks they all produce the same frames.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -std=gnu++98 -IInclude -IInclude/OpenNI -ILib -I$CINDER_PATH/include -I$CINDER_PATH/boost \
+ *      		Tools/benchmark/RecordingParseBenchmark.cpp Src/MappedFile.cpp Src/relay/UserStreamFrame.cpp Src/relay/UserStreamJSONParser.cpp \
+ *      		Lib/lib_json/json_*.cpp \
+ *      		-o RecordingParseBenchmark
+ *      	./RecordingParseBenchmark [directory] [iterations]
+ */
+
+#include "UserStreamFrame.h"
+#include "UserStreamJSONParser.h"
+#include "json/reader.h"
+
+#include <dirent.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+	double now() {
+		timeval time;
+		gettimeofday( &time, NULL );
+		return time.tv_sec + time.tv_usec * 1e-6;
+	}
+
+	bool readFile( const std::string &aPath, std::string &contents ) {
+		std::ifstream filestream( aPath.c_str(), std::ios::in | std::ios::binary );
+		if( !filestream.is_open() ) return false;
+		contents.assign( std::istreambuf_iterator<char>( filestream ), std::istreambuf_iterator<char>() );
+		return true;
+	}
+
+	bool parseWithReader( const std::string &contents, std::vector<relay::UserStreamFrame> &frames, bool useArena ) {
+		Json::ValueArena arena;
+		Json::Value json;
+		Json::Reader reader;
+		if( useArena ) {
+			Json::ValueArena::Scope scope( arena );
+			if( !reader.parse( contents, json ) ) return false;
+		} else {
+			if( !reader.parse( contents, json ) ) return false;
+		}
+
+		const Json::Value &root = json["root"];
+		frames.reserve( root.size() );
+		for( Json::ValueConstIterator itr = root.begin(); itr != root.end(); itr++ ) {
+			frames.push_back( *relay::UserStreamFrame::fromJSON( *itr ) );
+		}
+		return true;
+	}
+
+	// Number of frames whose header or tracked joints differ
+	int compareFrames( const std::vector<relay::UserStreamFrame> &a, const std::vector<relay::UserStreamFrame> &b ) {
+		if( a.size() != b.size() ) return std::max( a.size(), b.size() );
+
+		int mismatches = 0;
+		for( size_t i = 0; i < a.size(); ++i ) {
+			bool isEqual = a[i].framenumber == b[i].framenumber && a[i].timestamp == b[i].timestamp && a[i].skeleton.isTracking == b[i].skeleton.isTracking;
+			for( int j = 0; j < SKELETON::MAX_JOINTS && isEqual; ++j ) {
+				const SKELETON::SKELETON_JOINT &ja = a[i].skeleton.joints[j];
+				const SKELETON::SKELETON_JOINT &jb = b[i].skeleton.joints[j];
+				isEqual = ja.confidence == jb.confidence && ja.position == jb.position;
+			}
+			if( !isEqual ) ++mismatches;
+		}
+		return mismatches;
+	}
+}
+
+int main( int argc, char **argv ) {
+	std::string directory = argc > 1 ? argv[1] : "Resources";
+	int iterations = argc > 2 ? std::atoi( argv[2] ) : 5;
+
+	std::vector<std::string> files;
+	DIR *dir = opendir( directory.c_str() );
+	if( !dir ) {
+		std::fprintf( stderr, "Can not open '%s'\n", directory.c_str() );
+		return 1;
+	}
+	while( dirent *entry = readdir( dir ) ) {
+		std::string name( entry->d_name );
+		if( name.size() > 5 && name.compare( name.size() - 5, 5, ".json" ) == 0 ) files.push_back( directory + "/" + name );
+	}
+	closedir( dir );
+	std::sort( files.begin(), files.end() );
+
+	std::printf( "%-40s %10s %8s %12s %12s %12s %8s %s\n", "file", "bytes", "frames", "reader_ms", "arena_ms", "stream_ms", "speedup", "mismatches" );
+
+	int failures = 0;
+	for( size_t f = 0; f < files.size(); ++f ) {
+		std::string contents;
+		if( !readFile( files[f], contents ) ) continue;
+
+		std::vector<relay::UserStreamFrame> readerFrames, arenaFrames, streamFrames;
+		double readerTime = 1e30, arenaTime = 1e30, streamTime = 1e30;
+		bool readerOk = true, arenaOk = true, streamOk = true;
+
+		// Best of N, the file is already in memory so only parsing is measured
+		for( int i = 0; i < iterations; ++i ) {
+			readerFrames.clear();
+			double start = now();
+			readerOk = parseWithReader( contents, readerFrames, false );
+			readerTime = std::min( readerTime, now() - start );
+
+			arenaFrames.clear();
+			start = now();
+			arenaOk = parseWithReader( contents, arenaFrames, true );
+			arenaTime = std::min( arenaTime, now() - start );
+
+			streamFrames.clear();
+			relay::UserStreamJSONParser parser;
+			start = now();
+			streamOk = parser.parse( contents.data(), contents.size(), streamFrames );
+			streamTime = std::min( streamTime, now() - start );
+			if( !streamOk ) std::fprintf( stderr, "%s: %s\n", files[f].c_str(), parser.getError().c_str() );
+		}
+
+		int mismatches = readerOk && arenaOk && streamOk ? compareFrames( readerFrames, streamFrames ) + compareFrames( arenaFrames, streamFrames ) : -1;
+		if( mismatches != 0 ) ++failures;
+
+		std::string name = files[f].substr( files[f].rfind( '/' ) + 1 );
+		std::printf( "%-40s %10lu %8lu %12.3f %12.3f %12.3f %7.1fx %d\n", name.c_str(), (unsigned long)contents.size(), (unsigned long)streamFrames.size(),
+				readerTime * 1000.0, arenaTime * 1000.0, streamTime * 1000.0, readerTime / streamTime, mismatches );
+	}
+
+	return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,439 @@
+/*
+ * ConvertRecordings.cpp
+ *
+ *  Created on: Oct 25, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Batch converts skeleton recordings between the JSON and binary (.dks) formats and validates them on the way.
+ *      	Every file is checked for joint arrays that are not MAX_JOINTS long, NaN, infinite and denormal joint values
+ *      	(the 2.08e-41 entries the old exporter left in wave.json), frame number gaps and timestamps that go backwards.
+ *      	With -f the bad values are replaced with 0 before writing, gaps are only reported.
+ *
+ *      	Files are independent, so they are spread over a pool of threads - one per core unless -j says otherwise.
+ *      	One line of stats is printed per file, in the order they were given, then the totals.
+ *      	Exits with 1 if a file could not be read or written, 2 if a recording has problems left in it.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -std=gnu++98 -IInclude -IInclude/OpenNI -ILib -I$CINDER_PATH/include -I$CINDER_PATH/boost \
+ *      		Tools/convert/ConvertRecordings.cpp Src/MappedFile.cpp Src/relay/UserStreamFrame.cpp \
+ *      		Src/relay/UserStreamBinary.cpp Src/relay/UserStreamDeltaCodec.cpp Lib/lib_json/json_*.cpp \
+ *      		-L$CINDER_PATH/lib -lboost_thread -lboost_system -o ConvertRecordings
+ *
+ *      	Validate the bundled recordings, then repack them as compressed .dks with the bad values removed:
+ *      	./ConvertRecordings Resources/[a-z]*.json
+ *      	./ConvertRecordings -t dks -f -o Resources Resources/[a-z]*.json
+ */
+
+#include "MappedFile.h"
+#include "UserStreamBinary.h"
+#include "Constants.h"
+#include "json/reader.h"
+#include "json/writer.h"
+
+#include <boost/thread.hpp>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	enum Format {
+		FORMAT_NONE,	// Validate only
+		FORMAT_JSON,
+		FORMAT_BINARY
+	};
+
+	struct Options {
+		Format target;
+		relay::UserStreamCodec codec;
+		std::string outputDirectory;	// Empty - next to the input
+		bool fixValues;
+		unsigned int threadCount;
+	};
+
+	struct FileReport {
+		FileReport() : isRead( false ), isWritten( false ), frameCount( 0 ), trackedFrames( 0 ), minJointCount( 0 ), maxJointCount( 0 ),
+				nanValues( 0 ), infiniteValues( 0 ), denormalValues( 0 ), gaps( 0 ), missingFrames( 0 ), backwardTimestamps( 0 ),
+				duration( 0 ), inputBytes( 0 ), outputBytes( 0 ), seconds( 0 ) {}
+
+		std::string path;
+		std::string outputPath;
+		std::string error;
+		bool isRead;
+		bool isWritten;
+
+		size_t frameCount;
+		size_t trackedFrames;
+		int minJointCount;
+		int maxJointCount;
+		size_t nanValues;
+		size_t infiniteValues;
+		size_t denormalValues;
+		size_t gaps;				// Places where the frame number jumps
+		size_t missingFrames;		// Frame numbers skipped over by those jumps
+		size_t backwardTimestamps;
+		double duration;
+
+		unsigned long long inputBytes;
+		unsigned long long outputBytes;
+		double seconds;
+
+		size_t badValues() const { return nanValues + infiniteValues + denormalValues; }
+		bool hasJointCountProblem() const { return minJointCount != SKELETON::MAX_JOINTS || maxJointCount != SKELETON::MAX_JOINTS; }
+	};
+
+	double now() {
+		timeval time;
+		gettimeofday( &time, NULL );
+		return time.tv_sec + time.tv_usec * 1e-6;
+	}
+
+	bool hasExtension( const std::string &aPath, const std::string &anExtension ) {
+		return aPath.size() >= anExtension.size() && aPath.compare( aPath.size() - anExtension.size(), anExtension.size(), anExtension ) == 0;
+	}
+
+	unsigned long long getFileSize( const std::string &aPath ) {
+		struct stat info;
+		return ::stat( aPath.c_str(), &info ) == 0 ? (unsigned long long)info.st_size : 0;
+	}
+
+	std::string getOutputPath( const std::string &aPath, const Options &options ) {
+		std::string name = aPath.substr( aPath.rfind( '/' ) + 1 );
+		name = name.substr( 0, name.rfind( '.' ) ) + ( options.target == FORMAT_JSON ? ".json" : relay::USER_STREAM_BINARY_EXTENSION );
+		if( !options.outputDirectory.empty() ) return options.outputDirectory + "/" + name;
+
+		size_t slash = aPath.rfind( '/' );
+		return slash == std::string::npos ? name : aPath.substr( 0, slash + 1 ) + name;
+	}
+
+	///// VALIDATION
+	enum ValueClass {
+		VALUE_NORMAL,
+		VALUE_NAN,
+		VALUE_INFINITE,
+		VALUE_DENORMAL
+	};
+
+	// Recordings hold floats, so a double is judged by the float it becomes
+	ValueClass classify( float value ) {
+		uint32_t bits;
+		std::memcpy( &bits, &value, sizeof(bits) );
+		uint32_t exponent = bits & 0x7F800000u;
+		uint32_t mantissa = bits & 0x007FFFFFu;
+
+		if( exponent == 0x7F800000u ) return mantissa ? VALUE_NAN : VALUE_INFINITE;
+		if( exponent == 0 && mantissa ) return VALUE_DENORMAL;
+		return VALUE_NORMAL;
+	}
+
+	void countValue( ValueClass valueClass, FileReport &report ) {
+		if( valueClass == VALUE_NAN ) report.nanValues++;
+		else if( valueClass == VALUE_INFINITE ) report.infiniteValues++;
+		else if( valueClass == VALUE_DENORMAL ) report.denormalValues++;
+	}
+
+	// Every value of a json 'joints' array, including the joints the frames do not keep
+	void checkJSONJoints( const Json::Value &joints, FileReport &report ) {
+		int jointCount = joints.isArray() ? (int)joints.size() : 0;
+		if( report.frameCount == 0 || jointCount < report.minJointCount ) report.minJointCount = jointCount;
+		if( report.frameCount == 0 || jointCount > report.maxJointCount ) report.maxJointCount = jointCount;
+
+		for( int i = 0; i < jointCount; ++i ) {
+			const Json::Value &joint = joints[i];
+			const Json::Value &position = joint["position"];
+			countValue( classify( (float)joint["confidence"].asDouble() ), report );
+			countValue( classify( (float)position["x"].asDouble() ), report );
+			countValue( classify( (float)position["y"].asDouble() ), report );
+			countValue( classify( (float)position["z"].asDouble() ), report );
+		}
+	}
+
+	// Counts and or zeroes a NaN, infinite or denormal joint value
+	void checkValue( float &value, FileReport &report, bool countValues, bool fixValues ) {
+		ValueClass valueClass = classify( value );
+		if( valueClass == VALUE_NORMAL ) return;
+		if( countValues ) countValue( valueClass, report );
+		if( fixValues ) value = 0.0f;
+	}
+
+	void validate( std::vector<relay::UserStreamFrame> &frames, FileReport &report, bool countValues, bool fixValues ) {
+		report.frameCount = frames.size();
+		if( frames.empty() ) return;
+		report.duration = frames.back().timestamp - frames.front().timestamp;
+
+		for( size_t i = 0; i < frames.size(); ++i ) {
+			relay::UserStreamFrame &frame = frames[i];
+			if( frame.skeleton.isTracking ) report.trackedFrames++;
+
+			if( countValues || fixValues ) {
+				for( int j = 0; j < SKELETON::MAX_JOINTS; ++j ) {
+					SKELETON::SKELETON_JOINT &joint = frame.skeleton.joints[j];
+					checkValue( joint.confidence, report, countValues, fixValues );
+					checkValue( joint.position.x, report, countValues, fixValues );
+					checkValue( joint.position.y, report, countValues, fixValues );
+					checkValue( joint.position.z, report, countValues, fixValues );
+				}
+			}
+
+			if( i == 0 ) continue;
+			const relay::UserStreamFrame &previous = frames[i - 1];
+			if( frame.framenumber != previous.framenumber + 1 ) {
+				report.gaps++;
+				if( frame.framenumber > previous.framenumber ) report.missingFrames += frame.framenumber - previous.framenumber - 1;
+			}
+			if( !( frame.timestamp >= previous.timestamp ) ) report.backwardTimestamps++;
+		}
+	}
+
+	///// READING
+	// Read through a Json::Value rather than the UserStreamJSONParser, which skips the joints NITE does not track,
+	// so values in those are validated too
+	bool readJSON( const std::string &aPath, std::vector<relay::UserStreamFrame> &frames, FileReport &report ) {
+		MappedFile_ptr file = MappedFile::open( aPath );
+		if( !file ) {
+			report.error = "Can not open the file";
+			return false;
+		}
+
+		Json::Value document;
+		Json::Reader reader;
+		if( !reader.parse( file->getData(), file->getData() + file->getSize(), document, false ) ) {
+			// One line, the reader formats each error over several
+			report.error = reader.getFormatedErrorMessages();
+			std::replace( report.error.begin(), report.error.end(), '\n', ' ' );
+			report.error.erase( report.error.find_last_not_of( ' ' ) + 1 );
+			return false;
+		}
+
+		try {
+			const Json::Value &root = document["root"];
+			if( !root.isArray() ) {
+				report.error = "No 'root' array of frames";
+				return false;
+			}
+
+			frames.reserve( root.size() );
+			for( Json::ValueConstIterator itr = root.begin(); itr != root.end(); itr++ ) {
+				checkJSONJoints( (*itr)["skeletonData"]["joints"], report );
+				frames.push_back( *relay::UserStreamFrame::fromJSON( *itr ) );
+				report.frameCount = frames.size();
+			}
+		} catch( std::exception &e ) {
+			report.error = std::string( "Unexpected value, " ) + e.what();
+			return false;
+		}
+		return true;
+	}
+
+	bool readBinary( const std::string &aPath, std::vector<relay::UserStreamFrame> &frames, FileReport &report ) {
+		relay::UserStreamBinaryReader reader;
+		if( !reader.open( aPath ) ) {
+			report.error = "Not a valid recording";
+			return false;
+		}
+		report.minJointCount = report.maxJointCount = reader.getHeader().jointCount;
+
+		frames.resize( reader.getFrameCount() );
+		for( uint32_t i = 0; i < reader.getFrameCount(); ++i ) {
+			if( !reader.readFrame( i, frames[i] ) ) {
+				report.error = "Can not decode frame " + Json::valueToString( Json::UInt( i ) );
+				return false;
+			}
+		}
+		return true;
+	}
+
+	///// WRITING
+	bool writeJSON( const std::string &aPath, const std::vector<relay::UserStreamFrame> &frames ) {
+		int fd = ::open( aPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+		if( fd < 0 ) return false;
+
+		bool isWritten;
+		{
+			Json::StreamingWriter writer( fd, Json::StreamingWriter::pretty );
+			writer.beginObject();
+			writer.key( "root" );
+			writer.beginArray();
+			for( size_t i = 0; i < frames.size(); ++i ) {
+				frames[i].writeJSON( writer );
+			}
+			writer.endArray();
+			writer.endObject();
+			isWritten = writer.flush();
+		}
+		return ::close( fd ) == 0 && isWritten;
+	}
+
+	bool writeBinary( const std::string &aPath, const std::vector<relay::UserStreamFrame> &frames, relay::UserStreamCodec aCodec ) {
+		relay::UserStreamBinaryWriter writer;
+		if( !writer.open( aPath, Constants::relay::RECORDING_FRAME_RATE, aCodec ) ) return false;
+		for( size_t i = 0; i < frames.size(); ++i ) {
+			writer.write( frames[i] );
+		}
+		return writer.close();
+	}
+
+	void processFile( FileReport &report, const Options &options ) {
+		double start = now();
+		report.inputBytes = getFileSize( report.path );
+
+		std::vector<relay::UserStreamFrame> frames;
+		bool isBinary = hasExtension( report.path, relay::USER_STREAM_BINARY_EXTENSION );
+		if( isBinary ) {
+			report.isRead = readBinary( report.path, frames, report );
+		} else {
+			report.isRead = readJSON( report.path, frames, report );
+		}
+
+		if( report.isRead ) {
+			// Json values were counted as they were read
+			validate( frames, report, isBinary, options.fixValues );
+
+			if( options.target != FORMAT_NONE ) {
+				report.outputPath = getOutputPath( report.path, options );
+				report.isWritten = options.target == FORMAT_JSON ? writeJSON( report.outputPath, frames ) : writeBinary( report.outputPath, frames, options.codec );
+				if( report.isWritten ) report.outputBytes = getFileSize( report.outputPath );
+				else report.error = "Can not write '" + report.outputPath + "'";
+			}
+		}
+		report.seconds = now() - start;
+	}
+
+	// Worker threads take the next unprocessed file until there are none left
+	class FileQueue {
+	public:
+		FileQueue( std::vector<FileReport> &aReports, const Options &anOptions ) : reports( aReports ), options( anOptions ), next( 0 ) {}
+
+		void run() {
+			while( true ) {
+				size_t index;
+				{
+					boost::mutex::scoped_lock lock( mutex );
+					if( next == reports.size() ) return;
+					index = next++;
+				}
+				processFile( reports[index], options );
+			}
+		}
+
+	private:
+		std::vector<FileReport> &reports;
+		const Options &options;
+		boost::mutex mutex;
+		size_t next;
+	};
+
+	void printUsage( const char *aName ) {
+		std::fprintf( stderr, "usage: %s [-t json|dks] [-c raw|delta] [-o directory] [-f] [-j threads] <recording.json|recording.dks> ...\n"
+				"  -t  convert to this format, without it the recordings are only validated\n"
+				"  -c  .dks codec, delta by default\n"
+				"  -o  write the converted files here instead of next to the originals\n"
+				"  -f  replace NaN, infinite and denormal joint values with 0 in the converted files\n"
+				"  -j  number of files processed at once, one per core by default\n", aName );
+	}
+}
+
+int main( int argc, char **argv ) {
+	Options options;
+	options.target = FORMAT_NONE;
+	options.codec = relay::USER_STREAM_CODEC_DELTA;
+	options.fixValues = false;
+	options.threadCount = boost::thread::hardware_concurrency();
+
+	std::vector<FileReport> reports;
+	for( int i = 1; i < argc; ++i ) {
+		std::string argument( argv[i] );
+		bool hasValue = i + 1 < argc;
+
+		if( argument == "-t" && hasValue ) {
+			std::string format( argv[++i] );
+			if( format == "json" ) options.target = FORMAT_JSON;
+			else if( format == "dks" ) options.target = FORMAT_BINARY;
+			else { printUsage( argv[0] ); return 1; }
+		} else if( argument == "-c" && hasValue ) {
+			std::string codec( argv[++i] );
+			if( codec == "raw" ) options.codec = relay::USER_STREAM_CODEC_RAW;
+			else if( codec == "delta" ) options.codec = relay::USER_STREAM_CODEC_DELTA;
+			else { printUsage( argv[0] ); return 1; }
+		} else if( argument == "-o" && hasValue ) {
+			options.outputDirectory = argv[++i];
+		} else if( argument == "-j" && hasValue ) {
+			options.threadCount = (unsigned int)std::atoi( argv[++i] );
+		} else if( argument == "-f" ) {
+			options.fixValues = true;
+		} else if( !argument.empty() && argument[0] == '-' ) {
+			printUsage( argv[0] );
+			return 1;
+		} else {
+			reports.push_back( FileReport() );
+			reports.back().path = argument;
+		}
+	}
+
+	if( reports.empty() ) {
+		printUsage( argv[0] );
+		return 1;
+	}
+
+	double start = now();
+	if( options.threadCount == 0 ) options.threadCount = 1;
+	if( options.threadCount > reports.size() ) options.threadCount = reports.size();
+
+	FileQueue queue( reports, options );
+	boost::thread_group threads;
+	for( unsigned int i = 0; i < options.threadCount; ++i ) {
+		threads.create_thread( boost::bind( &FileQueue::run, &queue ) );
+	}
+	threads.join_all();
+
+	// Reports, in the order the files were given
+	int result = 0;
+	size_t totalFrames = 0;
+	unsigned long long totalInput = 0, totalOutput = 0;
+	std::printf( "%-28s %7s %7s %7s %6s %6s %6s %6s %6s %9s %10s %10s %8s\n", "file", "frames", "tracked", "joints", "nan", "inf", "denorm", "gaps", "back", "seconds", "in_bytes", "out_bytes", "ms" );
+	for( size_t i = 0; i < reports.size(); ++i ) {
+		const FileReport &report = reports[i];
+		std::string name = report.path.substr( report.path.rfind( '/' ) + 1 );
+		if( !report.isRead || ( options.target != FORMAT_NONE && !report.isWritten ) ) {
+			std::printf( "%-28s ERROR %s\n", name.c_str(), report.error.c_str() );
+			result = 1;
+			continue;
+		}
+
+		char joints[16];
+		if( report.minJointCount == report.maxJointCount ) std::sprintf( joints, "%d", report.minJointCount );
+		else std::sprintf( joints, "%d-%d", report.minJointCount, report.maxJointCount );
+
+		std::printf( "%-28s %7lu %7lu %7s %6lu %6lu %6lu %6lu %6lu %9.2f %10llu %10llu %8.1f\n", name.c_str(),
+				(unsigned long)report.frameCount, (unsigned long)report.trackedFrames, joints,
+				(unsigned long)report.nanValues, (unsigned long)report.infiniteValues, (unsigned long)report.denormalValues,
+				(unsigned long)report.gaps, (unsigned long)report.backwardTimestamps, report.duration,
+				report.inputBytes, report.outputBytes, report.seconds * 1000.0 );
+
+		// Problems that are still in the recording
+		std::vector<std::string> problems;
+		if( report.hasJointCountProblem() ) problems.push_back( std::string( "joint arrays of " ) + joints + " instead of " + Json::valueToString( SKELETON::MAX_JOINTS ) );
+		if( report.badValues() && !( options.fixValues && report.isWritten ) ) problems.push_back( Json::valueToString( Json::UInt( report.badValues() ) ) + " NaN/infinite/denormal values" );
+		if( report.gaps ) problems.push_back( Json::valueToString( Json::UInt( report.missingFrames ) ) + " missing frames in " + Json::valueToString( Json::UInt( report.gaps ) ) + " gaps" );
+		if( report.backwardTimestamps ) problems.push_back( Json::valueToString( Json::UInt( report.backwardTimestamps ) ) + " timestamps going backwards" );
+		for( size_t p = 0; p < problems.size(); ++p ) {
+			std::printf( "%-28s   %s\n", "", problems[p].c_str() );
+		}
+		if( !problems.empty() && result == 0 ) result = 2;
+
+		totalFrames += report.frameCount;
+		totalInput += report.inputBytes;
+		totalOutput += report.outputBytes;
+	}
+
+	std::printf( "%lu files, %lu frames, %llu bytes in, %llu bytes out, %.1f ms on %u threads\n", (unsigned long)reports.size(), (unsigned long)totalFrames,
+			totalInput, totalOutput, ( now() - start ) * 1000.0, options.threadCount );
+	return result;
+}
@@ -0,0 +1,111 @@
+/*
+ * BuildGestureLibrary.cpp
+ *
+ *  Created on: Oct 23, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Packs json or .dks gesture recordings into a single GestureLibrary file.
+ *      	Json recordings are compressed on the way in, each gesture is stored under its file name.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -std=gnu++98 -IInclude -IInclude/OpenNI -ILib -I$CINDER_PATH/include -I$CINDER_PATH/boost \
+ *      		Tools/gesturelibrary/BuildGestureLibrary.cpp Src/MappedFile.cpp Src/relay/GestureLibrary.cpp Src/relay/UserStreamFrame.cpp \
+ *      		Src/relay/UserStreamJSONParser.cpp Src/relay/UserStreamBinary.cpp Src/relay/UserStreamDeltaCodec.cpp \
+ *      		Src/relay/UserStreamMappedSource.cpp Src/SkeletonSanitize.cpp Lib/lib_json/json_*.cpp -o BuildGestureLibrary
+ *
+ *      	Rebuild the bundled library, weights match Constants::relay::player::weightedGestures():
+ *      	./BuildGestureLibrary Resources/gestures.dkl Resources/attention.json:15 Resources/both_arm_raise.json:10 \
+ *      		Resources/left_arm_up_y.json:10 Resources/left_arm_up_z.json:10 Resources/right_arm_up_y.json:10 \
+ *      		Resources/towards.json:10 Resources/towardsmore.json:15 Resources/wave.json:25
+ */
+
+#include "GestureLibrary.h"
+#include "UserStreamBinary.h"
+#include "UserStreamJSONParser.h"
+#include "Constants.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+	bool hasExtension( const std::string &aPath, const std::string &anExtension ) {
+		return aPath.size() >= anExtension.size() && aPath.compare( aPath.size() - anExtension.size(), anExtension.size(), anExtension ) == 0;
+	}
+
+	// Compresses a json recording into a temporary .dks next to the library
+	bool convertJSON( const std::string &aPath, const std::string &aBinaryPath ) {
+		std::vector<relay::UserStreamFrame> frames;
+		relay::UserStreamJSONParser parser;
+		if( !parser.parseFile( aPath, frames ) ) {
+			std::fprintf( stderr, "%s: %s\n", aPath.c_str(), parser.getError().c_str() );
+			return false;
+		}
+
+		relay::UserStreamBinaryWriter writer;
+		if( !writer.open( aBinaryPath, Constants::relay::RECORDING_FRAME_RATE, relay::USER_STREAM_CODEC_DELTA ) ) return false;
+		for( size_t i = 0; i < frames.size(); ++i ) {
+			writer.write( frames[i] );
+		}
+		return writer.close();
+	}
+}
+
+int main( int argc, char **argv ) {
+	if( argc < 3 ) {
+		std::fprintf( stderr, "usage: %s <library.dkl> <recording.json|recording.dks>[:weight] ...\n", argv[0] );
+		return 1;
+	}
+
+	std::string libraryPath( argv[1] );
+	std::vector<relay::GESTURE_INFO> gestures;
+	std::vector<std::string> recordingPaths;
+	std::vector<std::string> temporaryPaths;
+
+	bool success = true;
+	for( int i = 2; i < argc && success; ++i ) {
+		std::string argument( argv[i] );
+		std::string path = argument;
+		int weight = 1;
+
+		size_t colon = argument.rfind( ':' );
+		if( colon != std::string::npos ) {
+			path = argument.substr( 0, colon );
+			weight = std::atoi( argument.c_str() + colon + 1 );
+		}
+
+		relay::GESTURE_INFO info;
+		info.name = path.substr( path.rfind( '/' ) + 1 );
+		info.weight = weight;
+
+		std::string recordingPath = path;
+		if( hasExtension( path, ".json" ) ) {
+			recordingPath = libraryPath + "." + info.name + relay::USER_STREAM_BINARY_EXTENSION;
+			temporaryPaths.push_back( recordingPath );
+			success = convertJSON( path, recordingPath );
+		}
+
+		gestures.push_back( info );
+		recordingPaths.push_back( recordingPath );
+	}
+
+	if( success ) success = relay::GestureLibrary::write( libraryPath, gestures, recordingPaths );
+	for( size_t i = 0; i < temporaryPaths.size(); ++i ) {
+		std::remove( temporaryPaths[i].c_str() );
+	}
+
+	if( !success ) {
+		std::fprintf( stderr, "Failed to build '%s'\n", libraryPath.c_str() );
+		return 1;
+	}
+
+	// Read it back and list what went in
+	relay::GestureLibrary *library = relay::GestureLibrary::getInstance();
+	if( !library->load( libraryPath ) ) return 1;
+	for( size_t i = 0; i < library->getGestureCount(); ++i ) {
+		const relay::GESTURE_INFO &info = library->getGestureInfo( i );
+		std::printf( "%-24s weight %3d %6u frames %8.2fs\n", info.name.c_str(), info.weight, info.frameCount, info.duration );
+	}
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * JsonValueTest.cpp
+ *
+ *  Created on: Oct 25, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Regression checks for Json::Value assignments whose source lives in the container being grown:
+ *      		obj["b"] = obj["a"]     a member assigned from another member of the same object
+ *      		arr.append( arr[0u] )   an array appended with one of its own elements
+ *      		root["x"] = "s"         a heap document changed inside a ValueArena::Scope, then used after the arena is gone
+ *      	They all used to read freed memory, build with -fsanitize=address to catch a regression.
+ *      	The member case can't hold with flat objects (the reference is taken before the insertion moves the member),
+ *      	it is skipped when JSON_USE_FLAT_OBJECTS is defined, which is why that mode is opt-in.
+ *      	Exits with 1 and prints the failing check when one fails.
+ *
+ *      	Build and run from the repository root:
+ *      	g++ -g -fsanitize=address -std=gnu++98 -IInclude Tools/json/JsonValueTest.cpp Lib/lib_json/json_*.cpp -o JsonValueTest
+ *      	./JsonValueTest
+ */
+
+#include <json/json.h>
+#include <cstdio>
+#include <string>
+
+namespace {
+	int failures = 0;
+
+	void check( bool condition, const char *what ) {
+		if( !condition ) {
+			std::fprintf( stderr, "FAILED: %s\n", what );
+			++failures;
+		}
+	}
+
+	// Enough members to grow the container several times
+	const int COUNT = 100;
+}
+
+#ifndef JSON_USE_FLAT_OBJECTS
+static std::string memberName( const char *prefix, int index ) {
+	char name[32];
+	std::snprintf( name, sizeof(name), "%s%03d", prefix, index );
+	return name;
+}
+#endif
+
+void testMemberFromSameObject() {
+#ifndef JSON_USE_FLAT_OBJECTS
+	// Appended after the source, every growth of the object moves it
+	Json::Value object( Json::objectValue );
+	object["a"] = "a string long enough to live on the heap";
+	for( int i = 0; i < COUNT; ++i ) {
+		object[ memberName( "b", i ) ] = object["a"];
+	}
+	for( int i = 0; i < COUNT; ++i ) {
+		check( object[ memberName( "b", i ) ] == object["a"], "obj[\"b\"] = obj[\"a\"]" );
+	}
+
+	// Inserted before the source, every insertion shifts it
+	Json::Value shifted( Json::objectValue );
+	shifted["z"] = "a string long enough to live on the heap";
+	for( int i = 0; i < COUNT; ++i ) {
+		shifted[ memberName( "y", i ) ] = shifted["z"];
+	}
+	for( int i = 0; i < COUNT; ++i ) {
+		check( shifted[ memberName( "y", i ) ] == shifted["z"], "obj[\"y\"] = obj[\"z\"]" );
+	}
+#else
+	std::printf( "skipped obj[\"b\"] = obj[\"a\"], JSON_USE_FLAT_OBJECTS is defined\n" );
+#endif
+}
+
+void testAppendElementOfSameArray() {
+	Json::Value array( Json::arrayValue );
+	array.append( "a string long enough to live on the heap" );
+	for( int i = 0; i < COUNT; ++i ) {
+		array.append( array[0u] );
+	}
+	check( array.size() == COUNT + 1, "arr.append( arr[0u] ) size" );
+	for( Json::Value::UInt i = 0; i < array.size(); ++i ) {
+		check( array[i] == array[0u], "arr.append( arr[0u] )" );
+	}
+
+	// Nested, the element appended is itself a container
+	Json::Value nested( Json::arrayValue );
+	nested.append( array );
+	for( int i = 0; i < COUNT; ++i ) {
+		nested.append( nested[0u] );
+	}
+	for( Json::Value::UInt i = 0; i < nested.size(); ++i ) {
+		check( nested[i] == array, "arr.append( arr[0u] ) nested" );
+	}
+}
+
+void testHeapDocumentChangedInArenaScope() {
+	Json::Value root( Json::objectValue );
+	root["list"] = Json::Value( Json::arrayValue );
+	{
+		Json::ValueArena arena;
+		Json::ValueArena::Scope scope( arena );
+		root["x"] = "a string long enough to live on the heap";
+		root["nested"]["member name long enough to be copied"] = "another string long enough to live on the heap";
+		root["list"].append( "appended inside the scope" );
+
+		Json::Value parsed;
+		Json::Reader reader;
+		reader.parse( "{ \"from\" : [ \"the\", \"arena\" ] }", parsed );
+		root["copy"] = parsed;
+	}
+
+	// Every write reads back names and strings, which must not have gone with the arena
+	std::string document = Json::FastWriter().write( root );
+	check( document.find( "another string long enough to live on the heap" ) != std::string::npos, "arena scope nested member" );
+	check( document.find( "member name long enough to be copied" ) != std::string::npos, "arena scope member name" );
+	check( root["x"] == "a string long enough to live on the heap", "arena scope root[\"x\"] = \"s\"" );
+	check( root["list"][0u] == "appended inside the scope", "arena scope append" );
+	check( root["copy"]["from"][1u] == "arena", "arena scope copied document" );
+}
+
+int main( int argc, char **argv ) {
+	testMemberFromSameObject();
+	testAppendElementOfSameArray();
+	testHeapDocumentChangedInArenaScope();
+
+	if( failures ) {
+		std::fprintf( stderr, "%d check(s) failed\n", failures );
+		return 1;
+	}
+	std::printf( "all checks passed\n" );
+	return 0;
+}
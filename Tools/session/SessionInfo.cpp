@@ -0,0 +1,173 @@
+/*
+ * SessionInfo.cpp
+ *
+ *  Created on: Oct 28, 2011
+ *      Author: onedayitwillmake
+ *      Abstract:
+ *      	Summarizes session recordings (.dkx) - how long they are, how many chunks and bytes each track has
+ *      	and how well its images coded. Sessions that were never closed are recovered and say so.
+ *      	With -e every event is listed on the timeline, with -p the whole session is played through a
+ *      	UserSessionPlayback a capture at a time, decoding every track as the app would, and the time spent
+ *      	decoding each track is reported - the starting point for profiling an incident offline.
+ *      	Exits with 1 if a file could not be opened, 2 if a chunk failed to decode.
+ *
+ *      	Build from the repository root:
+ *      	g++ -O2 -DNDEBUG -std=gnu++98 -IInclude -IInclude/OpenNI -ILib -I$CINDER_PATH/include -I$CINDER_PATH/boost \
+ *      		Tools/session/SessionInfo.cpp Src/MappedFile.cpp Src/SkeletonSanitize.cpp Src/relay/UserStreamFrame.cpp \
+ *      		Src/relay/UserStreamBinary.cpp Src/relay/UserStreamDeltaCodec.cpp Src/relay/UserSessionFormat.cpp \
+ *      		Src/relay/UserSessionReader.cpp Src/relay/UserSessionPlayback.cpp Lib/lib_json/json_*.cpp \
+ *      		-L$CINDER_PATH/lib -lboost_thread -lboost_system -o SessionInfo
+ *
+ *      	./SessionInfo -e -p ~/Diskinect/_sessions/Session_*.dkx
+ */
+
+#include "UserSessionPlayback.h"
+
+#include <sys/time.h>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+	const double CAPTURE_SECONDS = 1.0 / 30.0;	// Playback steps, one Kinect frame
+
+	double getSeconds() {
+		timeval now;
+		gettimeofday( &now, NULL );
+		return now.tv_sec + now.tv_usec / 1000000.0;
+	}
+
+	void printUsage( const char *name ) {
+		std::fprintf( stderr, "Usage: %s [-e] [-p] session.dkx ...\n", name );
+		std::fprintf( stderr, "  -e  list every event\n" );
+		std::fprintf( stderr, "  -p  play the session through and time decoding each track\n" );
+	}
+
+	void printEvent( const relay::USER_SESSION_CHUNK_HEADER &chunk, const std::string &text ) {
+		std::printf( "  %9.3fs  %-15s", chunk.timestamp, relay::UserSessionFormat::getEventName( (relay::UserSessionEvent)chunk.codec ) );
+		if( chunk.user ) std::printf( " user %u", chunk.user );
+		if( !text.empty() ) std::printf( " '%s'", text.c_str() );
+		std::printf( "\n" );
+	}
+
+	void printSummary( relay::UserSessionReader &reader ) {
+		const relay::USER_SESSION_HEADER &header = reader.getHeader();
+		time_t started = (time_t)header.startTime;
+		char date[64];
+		std::strftime( date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime( &started ) );
+
+		std::printf( "%s\n  started %s, %.1f seconds%s\n", reader.getPath().c_str(), date, reader.getDuration(), reader.isRecovered() ? ", recovered from an unclosed session" : "" );
+		std::printf( "  %-10s %8s %12s %8s %8s\n", "track", "chunks", "bytes", "per sec", "coded" );
+
+		for( int track = 0; track < relay::USER_SESSION_TRACK_COUNT; ++track ) {
+			const std::vector<relay::USER_SESSION_INDEX_ENTRY> &chunks = reader.getChunks( (relay::UserSessionTrack)track );
+			if( chunks.empty() ) continue;
+
+			uint64_t bytes = 0, uncoded = 0;
+			relay::USER_SESSION_IMAGE_HEADER image;
+			for( std::vector<relay::USER_SESSION_INDEX_ENTRY>::const_iterator i = chunks.begin(); i != chunks.end(); ++i ) {
+				bytes += i->chunk.length;
+				if( reader.readImageHeader( *i, image ) ) uncoded += sizeof(image) + relay::UserSessionFormat::getImageSize( image );
+			}
+
+			double span = chunks.back().chunk.timestamp - chunks.front().chunk.timestamp;
+			std::printf( "  %-10s %8lu %12llu %8.1f", relay::UserSessionFormat::getTrackName( (relay::UserSessionTrack)track ),
+					(unsigned long)chunks.size(), (unsigned long long)bytes, span > 0 ? ( chunks.size() - 1 ) / span : 0.0 );
+			if( uncoded ) std::printf( " %7.1f%%", 100.0 * bytes / uncoded );
+			std::printf( "\n" );
+		}
+	}
+
+	struct TRACK_TIMING {
+		TRACK_TIMING() : decodes( 0 ), failures( 0 ), seconds( 0 ), lastChunkTime( -1 ) {};
+		unsigned long decodes;
+		unsigned long failures;
+		double seconds;
+		double lastChunkTime;
+	};
+
+	// Returns the number of chunks that failed to decode
+	unsigned long play( relay::UserSessionReader_ptr reader, bool shouldPrintEvents ) {
+		relay::UserSessionPlayback playback( reader );
+		if( shouldPrintEvents ) playback.signalEvent.connect( &printEvent );
+
+		TRACK_TIMING timings[relay::USER_SESSION_TRACK_COUNT];
+		double started = getSeconds();
+		while( true ) {
+			for( int track = 0; track < relay::USER_SESSION_TRACK_EVENTS; ++track ) {
+				TRACK_TIMING &timing = timings[track];
+				double chunkTime = playback.getChunkTime( (relay::UserSessionTrack)track );
+				if( chunkTime < 0 || chunkTime == timing.lastChunkTime ) continue;
+				timing.lastChunkTime = chunkTime;
+
+				double decodeStarted = getSeconds();
+				if( track == relay::USER_SESSION_TRACK_SKELETON ) {
+					playback.getSkeletons();
+				} else {
+					relay::USER_SESSION_IMAGE_HEADER image;
+					playback.getImage( (relay::UserSessionTrack)track, image );
+				}
+				timing.seconds += getSeconds() - decodeStarted;
+				timing.decodes++;
+				if( playback.isCorrupt( (relay::UserSessionTrack)track ) ) timing.failures++;
+			}
+
+			if( playback.isDone() ) break;
+			playback.advance( CAPTURE_SECONDS );
+		}
+		double elapsed = getSeconds() - started;
+
+		unsigned long failures = 0;
+		std::printf( "  played in %.2f seconds, %.1fx real time\n", elapsed, elapsed > 0 ? reader->getDuration() / elapsed : 0.0 );
+		for( int track = 0; track < relay::USER_SESSION_TRACK_EVENTS; ++track ) {
+			const TRACK_TIMING &timing = timings[track];
+			if( !timing.decodes ) continue;
+			std::printf( "  %-10s %8lu decoded %8.3f ms each", relay::UserSessionFormat::getTrackName( (relay::UserSessionTrack)track ), timing.decodes, 1000.0 * timing.seconds / timing.decodes );
+			if( timing.failures ) std::printf( ", %lu corrupt", timing.failures );
+			std::printf( "\n" );
+			failures += timing.failures;
+		}
+		return failures;
+	}
+}
+
+int main( int argc, char **argv ) {
+	bool shouldPrintEvents = false;
+	bool shouldPlay = false;
+	std::vector<std::string> paths;
+
+	for( int i = 1; i < argc; ++i ) {
+		std::string argument( argv[i] );
+		if( argument == "-e" ) shouldPrintEvents = true;
+		else if( argument == "-p" ) shouldPlay = true;
+		else if( !argument.empty() && argument[0] == '-' ) { printUsage( argv[0] ); return 1; }
+		else paths.push_back( argument );
+	}
+	if( paths.empty() ) {
+		printUsage( argv[0] );
+		return 1;
+	}
+
+	int status = 0;
+	for( std::vector<std::string>::iterator path = paths.begin(); path != paths.end(); ++path ) {
+		relay::UserSessionReader_ptr reader = relay::UserSessionReader::open( *path );
+		if( !reader ) {
+			status = 1;
+			continue;
+		}
+		printSummary( *reader );
+
+		// Played through, the events are printed as the playhead passes them
+		if( shouldPlay ) {
+			if( play( reader, shouldPrintEvents ) && status == 0 ) status = 2;
+		} else if( shouldPrintEvents ) {
+			const std::vector<relay::USER_SESSION_INDEX_ENTRY> &events = reader->getChunks( relay::USER_SESSION_TRACK_EVENTS );
+			std::string text;
+			for( std::vector<relay::USER_SESSION_INDEX_ENTRY>::const_iterator i = events.begin(); i != events.end(); ++i ) {
+				if( reader->readEvent( *i, text ) ) printEvent( i->chunk, text );
+			}
+		}
+	}
+	return status;
+}